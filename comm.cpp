@@ -1,8 +1,12 @@
+#include <algorithm>
+#include <iomanip>
 #include <sstream>
+#include <vector>
 
 #include <cstring>
 
 #include "comm.hpp"
+#include "profile.hpp"
 
 namespace caen {
 
@@ -100,9 +104,66 @@ const char* Device::WrongDevice::what() const noexcept {
   return message.c_str();
 };
 
+void RegisterCache::set_enabled(bool enabled) {
+  enabled_ = enabled;
+  if (!enabled) invalidate();
+};
+
+void RegisterCache::set_cacheable(uint32_t address, bool cacheable) {
+  if (cacheable)
+    entries.emplace(address, Entry { 0, false });
+  else
+    entries.erase(address);
+};
+
+void RegisterCache::set_cacheable(
+    uint32_t address, unsigned count, uint32_t step, bool cacheable
+) {
+  while (count--) {
+    set_cacheable(address, cacheable);
+    address += step;
+  };
+};
+
+bool RegisterCache::cacheable(uint32_t address) const {
+  return entries.find(address) != entries.end();
+};
+
+bool RegisterCache::lookup(uint32_t address, uint32_t& value) {
+  if (!enabled_) return false;
+  auto entry = entries.find(address);
+  if (entry == entries.end()) return false;
+  if (!entry->second.valid) {
+    ++statistics_.misses;
+    return false;
+  };
+  ++statistics_.hits;
+  value = entry->second.value;
+  return true;
+};
+
+void RegisterCache::store(uint32_t address, uint32_t value) {
+  if (!enabled_) return;
+  auto entry = entries.find(address);
+  if (entry == entries.end()) return;
+  entry->second.value = value;
+  entry->second.valid = true;
+};
+
+void RegisterCache::invalidate() {
+  for (auto& entry: entries) entry.second.valid = false;
+};
+
+void RegisterCache::invalidate(uint32_t address) {
+  auto entry = entries.find(address);
+  if (entry != entries.end()) entry->second.valid = false;
+};
+
 #define COMM(function, ...) \
   do { \
-    CAENComm_ErrorCode status = CAENComm_ ## function(__VA_ARGS__); \
+    CAENComm_ErrorCode status = CAEN_PROFILE( \
+        "CAENComm_" #function, transport_->function(__VA_ARGS__) \
+    ); \
     if (status != CAENComm_Success) \
       throw Error(status); \
   } while (false)
@@ -131,15 +192,18 @@ static CAENComm_ConnectionType commConnectionType(
   throw InvalidConnection(connection);
 };
 
-Device::Device(const Connection& connection) {
+Device::Device(const Connection& connection):
+  transport_(Transport::current())
+{
   const void* arg;
   if (connection.ip.empty())
     arg = &connection.link;
   else
     arg = connection.ip.c_str();
+  CAENComm_ConnectionType type = commConnectionType(connection);
   COMM(
       OpenDevice2,
-      commConnectionType(connection),
+      type,
       arg,
       connection.node,
       static_cast<uint32_t>(connection.address) << 16,
@@ -147,10 +211,19 @@ Device::Device(const Connection& connection) {
   );
   own = true;
 
+  std::ostringstream location;
+  location << '@' << connection.link << ':' << connection.node << ":0x"
+           << std::hex << std::uppercase << std::setw(4) << std::setfill('0')
+           << connection.address;
+  location_ = location.str();
+  link_ = std::to_string(type) + '@' + (
+      connection.ip.empty() ? std::to_string(connection.link) : connection.ip
+  );
+
   try {
     if (!check()) throw WrongDevice(connection, kind());
   } catch (...) {
-    CAENComm_CloseDevice(handle);
+    transport_->CloseDevice(handle);
     throw;
   };
 };
@@ -160,24 +233,71 @@ Device::Device(
     const void*             arg,
     int                     node,
     uint32_t                address
-): own(true) {
+): transport_(Transport::current()), own(true) {
   COMM(OpenDevice2, link, arg, node, address, &handle);
+  location_ = '#' + std::to_string(handle);
+  link_     = location_;
 };
 
-Device::Device(int handle, bool own): handle(handle), own(own) {};
+Device::Device(int handle, bool own):
+  transport_(Transport::current()), handle(handle), own(own)
+{
+  location_ = '#' + std::to_string(handle);
+  link_     = location_;
+};
 
 Device& Device::operator=(Device&& device) {
-  if (own) CAENComm_CloseDevice(handle);
+  if (own) transport_->CloseDevice(handle);
+  transport_ = device.transport_;
   handle = device.handle;
+  cache_ = std::move(device.cache_);
+  rom_   = std::move(device.rom_);
+  location_     = std::move(device.location_);
+  link_         = std::move(device.link_);
+  metrics_name_ = std::move(device.metrics_name_);
+  metrics_      = device.metrics_;
   own    = device.own;
   device.own = false;
   return *this;
 };
 
 Device::~Device() {
-  if (own) CAENComm_CloseDevice(handle);
+  if (own) transport_->CloseDevice(handle);
 }
 
+std::string Device::metrics_name() const {
+  if (!metrics_name_.empty()) return metrics_name_;
+  return kind() + location_;
+};
+
+void Device::set_metrics_name(const std::string& name) {
+  metrics_name_ = name;
+  metrics_      = -1;
+};
+
+void Device::account_readout(
+    unsigned size, uint32_t nwords, CAENComm_ErrorCode status, uint32_t events
+) const noexcept {
+  // The first transfer of a board and of a thread allocate; a transfer that
+  // cannot be accounted is dropped rather than failing the readout
+  try {
+    if (metrics_ < 0) metrics_ = metrics::board(metrics_name());
+    if (status == CAENComm_Success)
+      metrics::transfer(
+          metrics_, size, nwords * sizeof(uint32_t), events
+      );
+    else
+      metrics::error(metrics_);
+  } catch (...) {};
+};
+
+void Device::account_stripped(uint32_t nwords) const noexcept {
+  try {
+    if (metrics_ < 0) metrics_ = metrics::board(metrics_name());
+    metrics::stripped(metrics_, nwords);
+  } catch (...) {};
+};
+
 int Device::vme_handle() const {
   int result;
   COMM(Info, handle, CAENComm_VMELIB_handle, &result);
@@ -186,21 +306,51 @@ int Device::vme_handle() const {
 
 void Device::write32(uint32_t address, uint32_t data) {
   COMM(Write32, handle, address, data);
+  cache_.store(address, data);
 }
 
 void Device::write16(uint32_t address, uint16_t data) {
   COMM(Write16, handle, address, data);
+  cache_.store(address, data);
 }
 
+CAENComm_ErrorCode Device::try_read32(uint32_t address, uint32_t& data)
+  const noexcept
+{
+  if (cache_.lookup(address, data)) return CAENComm_Success;
+  CAENComm_ErrorCode status = CAEN_PROFILE(
+      "CAENComm_Read32", transport_->Read32(handle, address, &data)
+  );
+  if (status == CAENComm_Success) cache_.store(address, data);
+  return status;
+};
+
+CAENComm_ErrorCode Device::try_read16(uint32_t address, uint16_t& data)
+  const noexcept
+{
+  uint32_t cached;
+  if (cache_.lookup(address, cached)) {
+    data = cached;
+    return CAENComm_Success;
+  };
+  CAENComm_ErrorCode status = CAEN_PROFILE(
+      "CAENComm_Read16", transport_->Read16(handle, address, &data)
+  );
+  if (status == CAENComm_Success) cache_.store(address, data);
+  return status;
+};
+
 uint32_t Device::read32(uint32_t address) const {
   uint32_t result;
-  COMM(Read32, handle, address, &result);
+  CAENComm_ErrorCode status = try_read32(address, result);
+  if (status != CAENComm_Success) throw Error(status);
   return result;
 }
 
 uint16_t Device::read16(uint32_t address) const {
   uint16_t result;
-  COMM(Read16, handle, address, &result);
+  CAENComm_ErrorCode status = try_read16(address, result);
+  if (status != CAENComm_Success) throw Error(status);
   return result;
 }
 
@@ -220,34 +370,232 @@ template <> void Device::write<32>(uint32_t address, uint32_t data) {
   write32(address, data);
 };
 
+CAENComm_ErrorCode Device::try_blt_read(
+    uint32_t address, uint32_t* buffer, unsigned size, uint32_t& nwords
+) const noexcept {
+  int n = 0;
+  CAENComm_ErrorCode status = CAEN_PROFILE(
+      "CAENComm_BLTRead",
+      transport_->BLTRead(handle, address, buffer, size, &n)
+  );
+  if (status == CAENComm_Terminated) status = CAENComm_Success;
+  nwords = n;
+  return status;
+};
+
+CAENComm_ErrorCode Device::try_mblt_read(
+    uint32_t address, uint32_t* buffer, unsigned size, uint32_t& nwords
+) const noexcept {
+  int n = 0;
+  CAENComm_ErrorCode status = CAEN_PROFILE(
+      "CAENComm_MBLTRead",
+      transport_->MBLTRead(handle, address, buffer, size, &n)
+  );
+  if (status == CAENComm_Terminated) status = CAENComm_Success;
+  nwords = n;
+  return status;
+};
+
 uint32_t Device::blt_read(
     uint32_t address, uint32_t* buffer, unsigned size
 ) const {
-  int nwords;
-  CAENComm_ErrorCode status = CAENComm_BLTRead(
-      handle, address, buffer, size, &nwords
-  );
-  if (status != CAENComm_Success && status != CAENComm_Terminated)
-    throw Error(status);
+  uint32_t nwords;
+  CAENComm_ErrorCode status = try_blt_read(address, buffer, size, nwords);
+  if (status != CAENComm_Success) throw Error(status);
   return nwords;
 };
 
 uint32_t Device::mblt_read(
     uint32_t address, uint32_t* buffer, unsigned size
 ) const {
-  int nwords;
-  CAENComm_ErrorCode status = CAENComm_MBLTRead(
-      handle, address, buffer, size, &nwords
-  );
-  if (status != CAENComm_Success && status != CAENComm_Terminated)
-    throw Error(status);
+  uint32_t nwords;
+  CAENComm_ErrorCode status = try_mblt_read(address, buffer, size, nwords);
+  if (status != CAENComm_Success) throw Error(status);
   return nwords;
 };
 
+// Status that CAENComm never returns. Used to find cycles the library did not
+// touch when a multi-cycle call fails as a whole.
+static const CAENComm_ErrorCode unset_status
+  = static_cast<CAENComm_ErrorCode>(1);
+
+// Submits cycles [begin, end) of equal width as one CAENComm_Multi* call.
+// `Data` is the CAENComm data type for the width, `function` is the
+// corresponding Transport::Multi* function.
+template <typename Data, typename Function>
+static unsigned multi_cycle(
+    Transport* transport,
+    Function function,
+    int handle,
+    Device::Cycle* begin,
+    Device::Cycle* end,
+    bool write
+) {
+  uint32_t           addresses[Device::max_multi_cycles];
+  Data               data[Device::max_multi_cycles];
+  CAENComm_ErrorCode codes[Device::max_multi_cycles];
+
+  int n = end - begin;
+  for (int i = 0; i < n; ++i) {
+    addresses[i] = begin[i].address;
+    data[i]      = write ? begin[i].data : 0;
+    codes[i]     = unset_status;
+  };
+
+  static const unsigned sites[2] = {
+    profile::site(
+        sizeof(Data) == 2 ? "CAENComm_MultiRead16" : "CAENComm_MultiRead32"
+    ),
+    profile::site(
+        sizeof(Data) == 2 ? "CAENComm_MultiWrite16" : "CAENComm_MultiWrite32"
+    )
+  };
+
+  CAENComm_ErrorCode status;
+  {
+    profile::Timer timer(sites[write]);
+    status = (transport->*function)(handle, addresses, n, data, codes);
+  };
+
+  unsigned failed = 0;
+  for (int i = 0; i < n; ++i) {
+    if (status == CAENComm_Success)
+      codes[i] = CAENComm_Success;
+    else if (codes[i] == unset_status)
+      codes[i] = status;
+    begin[i].status = codes[i];
+    if (codes[i] != CAENComm_Success)
+      ++failed;
+    else if (!write)
+      begin[i].data = data[i];
+  };
+  return failed;
+};
+
+// Splits the batch into runs of cycles of the same width and submits them
+// in order
+template <typename Function16, typename Function32>
+static unsigned multi_cycles(
+    Transport* transport,
+    Function16 function16,
+    Function32 function32,
+    int handle,
+    Device::Cycle* cycles,
+    unsigned ncycles,
+    bool write
+) {
+  unsigned failed = 0;
+  Device::Cycle* end = cycles + ncycles;
+  while (cycles < end) {
+    Device::Cycle* run = cycles + 1;
+    while (
+        run < end
+        && run->width == cycles->width
+        && run - cycles < Device::max_multi_cycles
+    ) ++run;
+
+    if (cycles->width == 32)
+      failed += multi_cycle<uint32_t>(
+          transport, function32, handle, cycles, run, write
+      );
+    else
+      failed += multi_cycle<uint16_t>(
+          transport, function16, handle, cycles, run, write
+      );
+
+    cycles = run;
+  };
+  return failed;
+};
+
+unsigned Device::multi_read(Cycle* cycles, unsigned ncycles) const {
+  if (!cache_.enabled())
+    return multi_cycles(
+        transport_, &Transport::MultiRead16, &Transport::MultiRead32,
+        handle, cycles, ncycles, false
+    );
+
+  // Serve what we can from the cache and submit the rest
+  std::vector<Cycle*> misses;
+  std::vector<Cycle>  batch;
+  for (unsigned i = 0; i < ncycles; ++i)
+    if (cache_.lookup(cycles[i].address, cycles[i].data))
+      cycles[i].status = CAENComm_Success;
+    else {
+      misses.push_back(cycles + i);
+      batch.push_back(cycles[i]);
+    };
+
+  if (batch.empty()) return 0;
+
+  unsigned failed = multi_cycles(
+      transport_, &Transport::MultiRead16, &Transport::MultiRead32,
+      handle, batch.data(), batch.size(), false
+  );
+
+  for (size_t i = 0; i < batch.size(); ++i) {
+    *misses[i] = batch[i];
+    if (batch[i].status == CAENComm_Success)
+      cache_.store(batch[i].address, batch[i].data);
+  };
+
+  return failed;
+};
+
+unsigned Device::multi_write(Cycle* cycles, unsigned ncycles) {
+  unsigned failed = multi_cycles(
+      transport_, &Transport::MultiWrite16, &Transport::MultiWrite32,
+      handle, cycles, ncycles, true
+  );
+  if (cache_.enabled())
+    for (unsigned i = 0; i < ncycles; ++i)
+      if (cycles[i].status == CAENComm_Success)
+        cache_.store(cycles[i].address, cycles[i].data);
+  return failed;
+};
+
+static void throw_first_error(const Device::Cycle* cycles, unsigned ncycles) {
+  for (unsigned i = 0; i < ncycles; ++i)
+    if (cycles[i].status != CAENComm_Success)
+      throw Device::Error(cycles[i].status);
+};
+
+void Device::batch_read(Cycle* cycles, unsigned ncycles) const {
+  if (multi_read(cycles, ncycles)) throw_first_error(cycles, ncycles);
+};
+
+void Device::batch_write(Cycle* cycles, unsigned ncycles) {
+  if (multi_write(cycles, ncycles)) throw_first_error(cycles, ncycles);
+};
+
+void Device::load_rom(std::initializer_list<ROMRegion> regions) {
+  std::vector<Cycle> cycles;
+  for (auto& region: regions)
+    for (unsigned i = 0; i < region.nregisters; ++i)
+      cycles.emplace_back(region.address + i * region.step);
+  batch_read(cycles);
+
+  for (auto& cycle: cycles) rom_.emplace_back(cycle.address, cycle.data);
+  std::sort(rom_.begin(), rom_.end());
+};
+
+uint16_t Device::rom(uint32_t address) const {
+  auto i = std::lower_bound(
+      rom_.begin(),
+      rom_.end(),
+      address,
+      [](const std::pair<uint32_t, uint16_t>& entry, uint32_t address) {
+        return entry.first < address;
+      }
+  );
+  if (i != rom_.end() && i->first == address) return i->second;
+  return read16(address);
+};
+
 uint32_t Device::read(uint32_t address, unsigned nwords, uint32_t step) const {
   uint32_t result = 0;
   while (nwords--) {
-    result = result << 8 | read16(address) & 0xFF;
+    result = result << 8 | rom(address) & 0xFF;
     address += step;
   };
   return result;
@@ -1,10 +1,15 @@
 #pragma once
 
 #include <array>
+#include <initializer_list>
+#include <unordered_map>
+#include <vector>
 
 #include <CAENComm.h>
 
 #include "caen.hpp"
+#include "metrics.hpp"
+#include "transport.hpp"
 
 namespace caen {
 
@@ -187,6 +192,57 @@ class Buffer {
     size_t fill_;
 };
 
+// Write-through shadow copy of board registers. Remembers the last known value
+// of registers marked cacheable, so that setters flipping a few bits in a
+// register need not read it over the bus first. The cache is disabled by
+// default. Only mark registers which are not changed by the board itself
+// (configuration registers, not status or data), and invalidate the cache
+// whenever the board may have changed them behind our back (reset, clear,
+// reconnect).
+class RegisterCache {
+  public:
+    struct Statistics {
+      uint64_t hits   = 0; // reads served from the cache
+      uint64_t misses = 0; // reads of cacheable registers that went to the bus
+    };
+
+    bool enabled() const { return enabled_; };
+    // Disabling the cache also invalidates it
+    void set_enabled(bool enabled);
+
+    // Mark a register or `count` registers separated by `step` bytes starting
+    // at `address` as cacheable or not
+    void set_cacheable(uint32_t address, bool cacheable = true);
+    void set_cacheable(
+        uint32_t address, unsigned count, uint32_t step, bool cacheable = true
+    );
+    bool cacheable(uint32_t address) const;
+
+    // Look up the value of a register. Returns false if the cache is disabled
+    // or the value is unknown.
+    bool lookup(uint32_t address, uint32_t& value);
+
+    // Remember the value of a register if it is cacheable
+    void store(uint32_t address, uint32_t value);
+
+    // Forget all or one of the known values
+    void invalidate();
+    void invalidate(uint32_t address);
+
+    const Statistics& statistics() const { return statistics_; };
+    void reset_statistics() { statistics_ = Statistics(); };
+
+  private:
+    struct Entry {
+      uint32_t value;
+      bool     valid;
+    };
+
+    std::unordered_map<uint32_t, Entry> entries;
+    bool       enabled_ = false;
+    Statistics statistics_;
+};
+
 class Device {
   public:
     // CAEN device errors (with the error code)
@@ -225,7 +281,17 @@ class Device {
 
     Device(const Connection& connection);
 
-    Device(Device&& device): handle(device.handle), own(device.own) {
+    Device(Device&& device):
+      transport_(device.transport_),
+      handle(device.handle),
+      cache_(std::move(device.cache_)),
+      rom_(std::move(device.rom_)),
+      location_(std::move(device.location_)),
+      link_(std::move(device.link_)),
+      metrics_name_(std::move(device.metrics_name_)),
+      metrics_(device.metrics_),
+      own(device.own)
+    {
       device.own = false;
     };
 
@@ -241,9 +307,24 @@ class Device {
     // Device name, e.g., "V1730"
     virtual const char* kind() const { return "Device"; };
 
+    // The transport the device was opened with, see Transport::current
+    Transport* transport() const { return transport_; };
+
     int comm_handle() const { return handle; };
     int vme_handle()  const;
 
+    // Name of the board in the readout metrics (see metrics.hpp). Defaults
+    // to the kind and the location of the board, e.g., "V792@0:0:0x0012"
+    // (link, node and VME address) when opened with a Connection.
+    std::string metrics_name() const;
+    void set_metrics_name(const std::string& name);
+
+    // Key of the link the device was opened on, to group the devices sharing
+    // a link: the CAENComm connection type and the link number or the IP
+    // address of the bridge, e.g., "1@0" for the first optical link. Devices
+    // not opened from a Connection have their own key.
+    const std::string& link() const { return link_; };
+
     // These templates are implemented in terms of the functions below. They
     // are intended for generic programming; use the functions if it's more
     // convenient.
@@ -265,11 +346,105 @@ class Device {
     // Returns the number of words read.
     uint32_t mblt_read(uint32_t address, uint32_t* buffer, unsigned size) const;
 
+    // Non-throwing versions of the functions above for the readout hot path
+    // where link errors are expected and must be cheap. Return the status of
+    // the CAENComm call. Block transfers terminated by the device are reported
+    // as CAENComm_Success, as in the throwing versions. On failure the output
+    // arguments are unspecified.
+    CAENComm_ErrorCode try_read16(uint32_t address, uint16_t& data)
+      const noexcept;
+    CAENComm_ErrorCode try_read32(uint32_t address, uint32_t& data)
+      const noexcept;
+
+    CAENComm_ErrorCode try_blt_read(
+        uint32_t address, uint32_t* buffer, unsigned size, uint32_t& nwords
+    ) const noexcept;
+
+    CAENComm_ErrorCode try_mblt_read(
+        uint32_t address, uint32_t* buffer, unsigned size, uint32_t& nwords
+    ) const noexcept;
+
+    // A single register access in a batch, see `multi_read` and `multi_write`
+    struct Cycle {
+      uint32_t           address;
+      uint8_t            width;   // register width in bits: 16 or 32
+      uint32_t           data;    // the value read or to be written
+      CAENComm_ErrorCode status;  // set by `multi_read` or `multi_write`
+
+      Cycle() {};
+      Cycle(uint32_t address, uint8_t width = 16, uint32_t data = 0):
+        address(address), width(width), data(data), status(CAENComm_Success)
+      {};
+    };
+
+    // Maximum number of cycles submitted in one CAENComm transaction
+    static const unsigned max_multi_cycles = 256;
+
+    // Read or write a batch of registers. Consecutive cycles of the same width
+    // are submitted as a single CAENComm_MultiRead or CAENComm_MultiWrite
+    // call, so a batch of uniform width costs one round trip over the link
+    // (per `max_multi_cycles` cycles). Cycles are executed in order.
+    // These functions do not throw on a failed cycle: the status of each cycle
+    // is stored in its `status` field. Return the number of failed cycles.
+    unsigned multi_read(Cycle* cycles, unsigned ncycles) const;
+    unsigned multi_write(Cycle* cycles, unsigned ncycles);
+
+    // Convenience overloads for containers such as std::array or std::vector
+    template <typename Cycles> unsigned multi_read(Cycles& cycles) const {
+      return multi_read(cycles.data(), cycles.size());
+    };
+
+    template <typename Cycles> unsigned multi_write(Cycles& cycles) {
+      return multi_write(cycles.data(), cycles.size());
+    };
+
+    // Shadow register cache, see RegisterCache. Reads and writes of cacheable
+    // registers through the functions above go through the cache.
+    RegisterCache&       cache()       { return cache_; };
+    const RegisterCache& cache() const { return cache_; };
+
+    void set_cache_enabled(bool enabled) { cache_.set_enabled(enabled); };
+    void invalidate_cache() { cache_.invalidate(); };
+
   protected:
+    // A region of the configuration ROM: `nregisters` 16-bit registers
+    // separated by `step` bytes starting at `address`
+    struct ROMRegion {
+      uint32_t address;
+      unsigned nregisters;
+      uint32_t step = 4;
+    };
+
+    Transport* transport_;
     int handle;
+    mutable RegisterCache cache_;
+
+    // Configuration ROM snapshot. Identification registers never change while
+    // the board is powered, so boards read their ROM regions in a single
+    // batched transaction when opened and serve the identification getters
+    // (oui, id, version, revision, serial, ...) from memory.
+    void load_rom(std::initializer_list<ROMRegion> regions);
+
+    // Value of a ROM register from the snapshot. Registers outside the
+    // snapshot are read over the bus.
+    uint16_t rom(uint32_t address) const;
+
+    // Same as `multi_read` and `multi_write`, but throw Error with the status
+    // of the first failed cycle once the whole batch is submitted
+    void batch_read(Cycle* cycles, unsigned ncycles) const;
+    void batch_write(Cycle* cycles, unsigned ncycles);
+
+    template <typename Cycles> void batch_read(Cycles& cycles) const {
+      batch_read(cycles.data(), cycles.size());
+    };
+
+    template <typename Cycles> void batch_write(Cycles& cycles) {
+      batch_write(cycles.data(), cycles.size());
+    };
 
     // Read a number stored in big endian notation in lower 8 bits of `nwords`
-    // sequential 16 bits registers separated by 4 bytes in the address space
+    // sequential 16 bits registers separated by 4 bytes in the address space.
+    // Registers in the ROM snapshot are not read over the bus.
     uint32_t read(
         uint32_t address,
         unsigned nwords /* must be 4 or less */,
@@ -279,7 +454,27 @@ class Device {
     // have we connected to the device we expected?
     virtual bool check() const { return true; }; 
 
+    // Account a readout block transfer returning `nwords` words holding
+    // `events` events into the board metrics. `size` is the block size passed
+    // to CAENComm, which counts bytes. Readout functions call this when
+    // metrics::enabled().
+    void account_readout(
+        unsigned size, uint32_t nwords, CAENComm_ErrorCode status,
+        uint32_t events = 0
+    ) const noexcept;
+
+    // Account `nwords` filler words removed from the data read out
+    void account_stripped(uint32_t nwords) const noexcept;
+
   private:
+    // ROM snapshot sorted by address
+    std::vector<std::pair<uint32_t, uint16_t>> rom_;
+
+    std::string location_;
+    std::string link_;
+    std::string metrics_name_;
+    mutable int metrics_ = -1; // metrics::board identifier, -1 until used
+
     bool own = false;
 };
 
@@ -3,10 +3,13 @@
 #include <cstring>
 
 #include "digitizer.hpp"
+#include "profile.hpp"
 
 #define DGTZ(function, ...) \
   do { \
-    CAEN_DGTZ_ErrorCode status = CAEN_DGTZ_ ## function(__VA_ARGS__); \
+    CAEN_DGTZ_ErrorCode status = CAEN_PROFILE( \
+        "CAEN_DGTZ_" #function, CAEN_DGTZ_ ## function(__VA_ARGS__) \
+    ); \
     if (status != CAEN_DGTZ_Success) throw Error(#function, status); \
   } while (0)
 
@@ -203,7 +206,10 @@ Digitizer::Digitizer(): digitizer(-1) {};
 
 Digitizer::Digitizer(Digitizer&& digitizer):
   digitizer(digitizer.digitizer), // digitizer. digitizer? digitizer! digitizer!
-  info_(digitizer.info_)
+  info_(digitizer.info_),
+  cache_(std::move(digitizer.cache_)),
+  metricsName_(std::move(digitizer.metricsName_)),
+  metrics_(digitizer.metrics_)
 {
   digitizer.digitizer = -1;
 };
@@ -270,6 +276,17 @@ Digitizer::~Digitizer() {
   if (digitizer >= 0) CAEN_DGTZ_CloseDigitizer(digitizer);
 };
 
+std::string Digitizer::metricsName() const {
+  if (!metricsName_.empty()) return metricsName_;
+  return std::string(info_.ModelName) + '#'
+    + std::to_string(info_.SerialNumber);
+};
+
+void Digitizer::setMetricsName(const std::string& name) {
+  metricsName_ = name;
+  metrics_     = -1;
+};
+
 uint8_t Digitizer::DPPFirmwareCode(uint8_t channel) const {
   if (channel > 0xf) throw Error(CAEN_DGTZ_InvalidChannelNumber);
   uint8_t code = readRegister(0x108c | channel << 8) >> 8 & 0xff;
@@ -279,12 +296,15 @@ uint8_t Digitizer::DPPFirmwareCode(uint8_t channel) const {
 
 uint32_t Digitizer::readRegister(uint32_t address) const {
   uint32_t data;
+  if (cache_.lookup(address, data)) return data;
   DGTZ(ReadRegister, digitizer, address, &data);
+  cache_.store(address, data);
   return data;
 };
 
 void Digitizer::writeRegister(uint32_t address, uint32_t data) {
   DGTZ(WriteRegister, digitizer, address, data);
+  cache_.store(address, data);
 };
 
 uint32_t Digitizer::readRegister(uint32_t address, uint8_t start, uint8_t end) const {
@@ -301,10 +321,12 @@ void Digitizer::writeRegister(
 
 void Digitizer::reset() {
   DGTZ(Reset, digitizer);
+  cache_.invalidate();
 };
 
 void Digitizer::clearData() {
   DGTZ(ClearData, digitizer);
+  cache_.invalidate();
 };
 
 void Digitizer::disableEventAlignedReadout() {
@@ -314,14 +336,16 @@ void Digitizer::disableEventAlignedReadout() {
 DEFPROPERTY0(MaxNumEventsBLT, uint32_t);
 
 Digitizer::ReadoutBuffer::ReadoutBuffer(ReadoutBuffer&& buffer) {
-  memory = buffer.memory;
-  size   = buffer.size;
+  memory   = buffer.memory;
+  size     = buffer.size;
+  capacity = buffer.capacity;
   buffer.memory = nullptr;
 };
 
 void Digitizer::ReadoutBuffer::allocate(const Digitizer& digitizer) {
   deallocate();
   DGTZ(MallocReadoutBuffer, digitizer.handle(), &memory, &size);
+  capacity = size;
 };
 
 void Digitizer::ReadoutBuffer::deallocate() {
@@ -333,10 +357,34 @@ Digitizer::ReadoutBuffer Digitizer::mallocReadoutBuffer() const {
   return ReadoutBuffer(*this);
 };
 
+CAEN_DGTZ_ErrorCode Digitizer::tryReadData(
+    CAEN_DGTZ_ReadMode_t mode, ReadoutBuffer& buffer
+) const noexcept {
+  CAEN_DGTZ_ErrorCode status = CAEN_PROFILE(
+      "CAEN_DGTZ_ReadData",
+      CAEN_DGTZ_ReadData(digitizer, mode, buffer.memory, &buffer.size)
+  );
+  if (!metrics::enabled()) return status;
+
+  // As in Device::account_readout
+  try {
+    if (metrics_ < 0) metrics_ = metrics::board(metricsName());
+    if (status == CAEN_DGTZ_Success) {
+      uint32_t events = 0;
+      CAEN_DGTZ_GetNumEvents(digitizer, buffer.memory, buffer.size, &events);
+      metrics::transfer(metrics_, buffer.capacity, buffer.size, events);
+    } else {
+      metrics::error(metrics_);
+    };
+  } catch (...) {};
+  return status;
+};
+
 void Digitizer::readData(
     CAEN_DGTZ_ReadMode_t mode, ReadoutBuffer& buffer
 ) const {
-  DGTZ(ReadData, digitizer, mode, buffer.memory, &buffer.size);
+  CAEN_DGTZ_ErrorCode status = tryReadData(mode, buffer);
+  if (status != CAEN_DGTZ_Success) throw Error("ReadData", status);
 };
 
 uint32_t Digitizer::getNumEvents(const ReadoutBuffer& buffer) const {
@@ -40,6 +40,7 @@ class Digitizer {
       private:
         char* memory = nullptr;
         uint32_t size;
+        uint32_t capacity = 0; // allocated bytes
 
       friend class Digitizer;
     };
@@ -68,7 +69,10 @@ class Digitizer {
 
     Digitizer& operator=(Digitizer&& digitizer) {
       this->digitizer = digitizer.digitizer;
-      info_ = digitizer.info_;
+      info_  = digitizer.info_;
+      cache_ = std::move(digitizer.cache_);
+      metricsName_ = std::move(digitizer.metricsName_);
+      metrics_     = digitizer.metrics_;
       digitizer.digitizer = -1;
       return *this;
     };
@@ -76,6 +80,11 @@ class Digitizer {
     int handle() const { return digitizer; };
     const CAEN_DGTZ_BoardInfo_t& info() const { return info_; };
 
+    // Name of the board in the readout metrics (see metrics.hpp). Defaults
+    // to the model and the serial number, e.g., "V1730#123".
+    std::string metricsName() const;
+    void setMetricsName(const std::string& name);
+
     uint8_t DPPFirmwareCode(uint8_t channel = 0) const;
 
     uint32_t readRegister(uint32_t address) const;
@@ -87,6 +96,15 @@ class Digitizer {
         uint32_t address, uint32_t data, uint8_t start, uint8_t end
     );
 
+    // Shadow register cache, see RegisterCache. Register accesses through
+    // readRegister and writeRegister go through the cache. No registers are
+    // cacheable by default since the register map depends on the board family
+    // and firmware. Note that the CAEN_DGTZ_Set* functions write registers
+    // behind the cache: do not mark registers they modify, or invalidate the
+    // cache after calling them.
+    RegisterCache&       cache()       { return cache_; };
+    const RegisterCache& cache() const { return cache_; };
+
     void reset();
 
     void clearData();
@@ -100,6 +118,12 @@ class Digitizer {
 
     void readData(CAEN_DGTZ_ReadMode_t, ReadoutBuffer&) const;
 
+    // Non-throwing version of readData for the readout hot path. Returns the
+    // status of the CAEN_DGTZ_ReadData call. Readouts are accounted in the
+    // board metrics, see metrics.hpp.
+    CAEN_DGTZ_ErrorCode tryReadData(CAEN_DGTZ_ReadMode_t, ReadoutBuffer&)
+      const noexcept;
+
     uint32_t getNumEvents(const ReadoutBuffer&) const;
 
     Event* allocateEvent() const;
@@ -257,6 +281,10 @@ class Digitizer {
   private:
     int digitizer;
     CAEN_DGTZ_BoardInfo_t info_;
+    mutable RegisterCache cache_;
+
+    std::string metricsName_;
+    mutable int metrics_ = -1; // metrics::board identifier, -1 until used
 
     Digitizer();
 };
@@ -0,0 +1,240 @@
+#include <map>
+#include <stdexcept>
+
+#include "executor.hpp"
+
+namespace caen {
+
+std::shared_ptr<Executor> Executor::of(const Device& device) {
+  static std::mutex mutex;
+  static std::map<std::string, std::weak_ptr<Executor>> executors;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  std::weak_ptr<Executor>& executor = executors[device.link()];
+  std::shared_ptr<Executor> result = executor.lock();
+  if (!result) {
+    result = std::make_shared<Executor>(device.link());
+    executor = result;
+  };
+  return result;
+};
+
+Executor::Executor(const std::string& link):
+  link_(link), head_(&stub_), tail_(&stub_)
+{
+  worker_ = std::thread(&Executor::run, this);
+};
+
+Executor::~Executor() {
+  stop_ = true;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    wakeup_.notify_one();
+  };
+  worker_.join();
+};
+
+// The queue is the intrusive MPSC queue by Dmitry Vyukov. Producers only
+// exchange `head_`; the consumer owns `tail_`.
+void Executor::push(Node* node) {
+  node->next.store(nullptr, std::memory_order_relaxed);
+  Node* prev = head_.exchange(node);
+  prev->next.store(node, std::memory_order_release);
+};
+
+Executor::Node* Executor::pop() {
+  Node* tail = tail_;
+  Node* next = tail->next.load(std::memory_order_acquire);
+
+  if (tail == &stub_) {
+    if (!next) return nullptr;
+    tail_ = next;
+    tail  = next;
+    next  = next->next.load(std::memory_order_acquire);
+  };
+
+  if (next) {
+    tail_ = next;
+    return tail;
+  };
+
+  // A producer has exchanged the head but not linked its node yet
+  if (tail != head_.load()) return nullptr;
+
+  push(&stub_);
+  next = tail->next.load(std::memory_order_acquire);
+  if (next) {
+    tail_ = next;
+    return tail;
+  };
+
+  return nullptr;
+};
+
+bool Executor::pending() const {
+  return tail_ != &stub_ || head_.load() != &stub_;
+};
+
+void Executor::enqueue(Task* task) {
+  task->submitted = std::chrono::steady_clock::now();
+  submitted_.fetch_add(1, std::memory_order_relaxed);
+
+  uint64_t depth = depth_.fetch_add(1, std::memory_order_relaxed) + 1;
+  uint64_t max = max_depth_.load(std::memory_order_relaxed);
+  while (depth > max && !max_depth_.compare_exchange_weak(max, depth));
+
+  push(task);
+
+  // The worker sets `sleeping_` before checking the queue for the last time,
+  // so either it sees our task or we see it sleeping.
+  if (sleeping_.load()) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    wakeup_.notify_one();
+  };
+};
+
+static void check_link(const Device& device, const std::string& link) {
+  if (device.link() != link)
+    throw std::invalid_argument(
+        "caen::Executor: " + device.metrics_name() + " is not on link " + link
+    );
+};
+
+std::future<uint32_t> Executor::read(
+    const Device& device, uint32_t address, uint8_t width
+) {
+  check_link(device, link_);
+  Task* task = new Task;
+  task->kind = Task::Read;
+  // Only const member functions are called on devices of Read tasks
+  task->device = const_cast<Device*>(&device);
+  task->cycle  = Device::Cycle(address, width);
+  auto future = task->promise.get_future();
+  enqueue(task);
+  return future;
+};
+
+std::future<uint32_t> Executor::write(
+    Device& device, uint32_t address, uint32_t data, uint8_t width
+) {
+  check_link(device, link_);
+  Task* task = new Task;
+  task->kind   = Task::Write;
+  task->device = &device;
+  task->cycle  = Device::Cycle(address, width, data);
+  auto future = task->promise.get_future();
+  enqueue(task);
+  return future;
+};
+
+Executor::Task* Executor::take() {
+  Task* task = static_cast<Task*>(pop());
+  if (!task) return nullptr;
+
+  depth_.fetch_sub(1, std::memory_order_relaxed);
+
+  uint64_t wait = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - task->submitted
+  ).count();
+  wait_total_.fetch_add(wait, std::memory_order_relaxed);
+  if (wait > wait_max_.load(std::memory_order_relaxed))
+    wait_max_.store(wait, std::memory_order_relaxed);
+
+  return task;
+};
+
+void Executor::run() {
+  Task* next = nullptr;
+  while (true) {
+    Task* task = next ? next : take();
+    next = nullptr;
+
+    if (!task) {
+      if (stop_ && !pending()) break;
+      std::unique_lock<std::mutex> lock(mutex_);
+      sleeping_ = true;
+      wakeup_.wait(lock, [this]() { return pending() || stop_; });
+      sleeping_ = false;
+      continue;
+    };
+
+    if (task->kind == Task::Call) {
+      task->invoke(task);
+      delete task;
+      executed_.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    };
+
+    // Coalesce adjacent accesses of the same kind to the same device
+    batch_.clear();
+    batch_.push_back(task);
+    while (batch_.size() < Device::max_multi_cycles) {
+      Task* t = take();
+      if (!t) break;
+      if (t->kind != task->kind || t->device != task->device) {
+        next = t;
+        break;
+      };
+      batch_.push_back(t);
+    };
+
+    execute(batch_);
+  };
+};
+
+void Executor::execute(std::vector<Task*>& batch) {
+  cycles_.clear();
+  for (Task* task: batch) cycles_.push_back(task->cycle);
+
+  Device* device = batch.front()->device;
+  if (batch.front()->kind == Task::Read)
+    const_cast<const Device*>(device)->multi_read(cycles_);
+  else
+    device->multi_write(cycles_);
+
+  if (batch.size() > 1) {
+    batches_.fetch_add(1, std::memory_order_relaxed);
+    coalesced_.fetch_add(batch.size(), std::memory_order_relaxed);
+  };
+
+  for (size_t i = 0; i < batch.size(); ++i) {
+    if (cycles_[i].status == CAENComm_Success)
+      batch[i]->promise.set_value(cycles_[i].data);
+    else
+      batch[i]->promise.set_exception(
+          std::make_exception_ptr(Device::Error(cycles_[i].status))
+      );
+    delete batch[i];
+  };
+
+  executed_.fetch_add(batch.size(), std::memory_order_relaxed);
+};
+
+Executor::Statistics Executor::statistics() const {
+  Statistics result;
+  result.submitted  = submitted_.load(std::memory_order_relaxed);
+  result.executed   = executed_.load(std::memory_order_relaxed);
+  result.batches    = batches_.load(std::memory_order_relaxed);
+  result.coalesced  = coalesced_.load(std::memory_order_relaxed);
+  result.depth      = depth_.load(std::memory_order_relaxed);
+  result.max_depth  = max_depth_.load(std::memory_order_relaxed);
+  result.wait_total = std::chrono::nanoseconds(
+      wait_total_.load(std::memory_order_relaxed)
+  );
+  result.wait_max = std::chrono::nanoseconds(
+      wait_max_.load(std::memory_order_relaxed)
+  );
+  return result;
+};
+
+void Executor::reset_statistics() {
+  submitted_  = 0;
+  executed_   = 0;
+  batches_    = 0;
+  coalesced_  = 0;
+  max_depth_  = depth_.load();
+  wait_total_ = 0;
+  wait_max_   = 0;
+};
+
+};
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cstddef>
+
+#include "comm.hpp"
+
+namespace caen {
+
+// Serializes access to a link shared by several devices, e.g., boards in a
+// daisy chain behind one A3818/A5818 optical link. Operations are submitted
+// from any number of threads through a lock-free queue and executed in order
+// by a single worker thread that owns the link. Register accesses to the same
+// device found adjacent in the queue are coalesced into batched transactions
+// (see Device::multi_read and Device::multi_write).
+//
+// There is one executor per link (see Device::link): get it with `of`, and
+// operations on devices of other links are rejected. Once a device is handed
+// over to its executor, do not access it directly from other threads: neither
+// CAENComm handles nor Device objects are thread safe.
+//
+//   auto executor = caen::Executor::of(tdc);
+//   std::future<uint32_t> status = executor->read(tdc, 0x1002);
+class Executor {
+  public:
+    struct Statistics {
+      uint64_t submitted;  // operations submitted
+      uint64_t executed;   // operations executed
+      uint64_t batches;    // batched register transactions issued
+      uint64_t coalesced;  // register accesses executed in these batches
+      uint64_t depth;      // operations currently waiting in the queue
+      uint64_t max_depth;  // maximum queue depth observed
+
+      // Time between the submission of an operation and the start of its
+      // execution
+      std::chrono::nanoseconds wait_total;
+      std::chrono::nanoseconds wait_max;
+
+      std::chrono::nanoseconds wait_mean() const {
+        return executed ? wait_total / int64_t(executed) : wait_total;
+      };
+    };
+
+    // The executor of the link of `device`, shared by all the devices on the
+    // link. Started on first use, stopped when the last reference is gone.
+    static std::shared_ptr<Executor> of(const Device& device);
+
+    // Starts the worker thread for the devices on `link`
+    explicit Executor(const std::string& link);
+
+    // Executes pending operations and stops the worker thread
+    ~Executor();
+
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+
+    const std::string& link() const { return link_; };
+
+    // Register accesses. `width` is 16 or 32. A failed access sets the future
+    // to Device::Error. A write sets the future to the written value once
+    // done. Throw std::invalid_argument if `device` is on another link.
+    std::future<uint32_t> read(
+        const Device& device, uint32_t address, uint8_t width = 16
+    );
+
+    std::future<uint32_t> write(
+        Device& device, uint32_t address, uint32_t data, uint8_t width = 16
+    );
+
+    // Submit an arbitrary operation, e.g., a block transfer or a sequence of
+    // accesses that must not be interleaved with other threads. The future is
+    // set to the result of `function` or to the exception it throws.
+    template <typename Function>
+    auto submit(Function&& function) -> std::future<decltype(function())>;
+
+    Statistics statistics() const;
+    void reset_statistics();
+
+  private:
+    // Intrusive node of the multiple producers single consumer queue
+    struct Node {
+      std::atomic<Node*> next { nullptr };
+    };
+
+    struct Task: public Node {
+      enum Kind { Read, Write, Call };
+
+      Kind                    kind;
+      Device*                 device;
+      Device::Cycle           cycle;
+      std::promise<uint32_t>  promise;
+
+      // The std::packaged_task of a Call, constructed in place: `invoke`
+      // runs and destroys it
+      static const size_t call_size = 32;
+      alignas(std::max_align_t) unsigned char call[call_size];
+      void (*invoke)(Task*);
+
+      std::chrono::steady_clock::time_point submitted;
+    };
+
+    std::string link_;
+
+    std::atomic<Node*> head_; // producers push here
+    Node*              tail_; // the consumer pops here
+    Node               stub_;
+
+    std::atomic<bool>       stop_     { false };
+    std::atomic<bool>       sleeping_ { false };
+    std::mutex              mutex_;
+    std::condition_variable wakeup_;
+
+    std::atomic<uint64_t> submitted_  { 0 };
+    std::atomic<uint64_t> executed_   { 0 };
+    std::atomic<uint64_t> batches_    { 0 };
+    std::atomic<uint64_t> coalesced_  { 0 };
+    std::atomic<uint64_t> depth_      { 0 };
+    std::atomic<uint64_t> max_depth_  { 0 };
+    std::atomic<uint64_t> wait_total_ { 0 }; // ns
+    std::atomic<uint64_t> wait_max_   { 0 }; // ns
+
+    // Reused by the worker for coalesced batches
+    std::vector<Task*>         batch_;
+    std::vector<Device::Cycle> cycles_;
+
+    std::thread worker_;
+
+    void push(Node*);
+    Node* pop();
+    bool pending() const;
+
+    void enqueue(Task*);
+    Task* take();
+    void run();
+    void execute(std::vector<Task*>&);
+};
+
+template <typename Function>
+auto Executor::submit(Function&& function)
+  -> std::future<decltype(function())>
+{
+  typedef std::packaged_task<decltype(function())()> Call;
+  static_assert(sizeof(Call) <= Task::call_size, "Task::call too small");
+
+  Task* t = new Task;
+  t->kind = Task::Call;
+  Call* call = new (t->call) Call(std::forward<Function>(function));
+  auto future = call->get_future();
+  t->invoke = [](Task* task) {
+    Call* call = reinterpret_cast<Call*>(task->call);
+    (*call)();
+    call->~Call();
+  };
+  enqueue(t);
+
+  return future;
+};
+
+};
@@ -0,0 +1,350 @@
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "metrics.hpp"
+#include "registry.hpp"
+
+namespace caen {
+namespace metrics {
+
+std::atomic<bool> enabled_ { false };
+
+void set_enabled(bool enabled) {
+  enabled_ = enabled;
+};
+
+void Board::merge(const Board& board) {
+  transfers += board.transfers;
+  errors    += board.errors;
+  requested += board.requested;
+  bytes     += board.bytes;
+  events    += board.events;
+  stripped  += board.stripped;
+  for (unsigned i = 0; i < nsizes; ++i) sizes[i] += board.sizes[i];
+};
+
+// Counters of a board updated by one thread and read by others, see
+// registry.hpp
+struct Counters {
+  std::atomic<uint64_t> transfers { 0 };
+  std::atomic<uint64_t> errors    { 0 };
+  std::atomic<uint64_t> requested { 0 };
+  std::atomic<uint64_t> bytes     { 0 };
+  std::atomic<uint64_t> events    { 0 };
+  std::atomic<uint64_t> stripped  { 0 };
+  std::atomic<uint64_t> sizes[nsizes];
+
+  Counters() {
+    for (auto& size: sizes) size.store(0, std::memory_order_relaxed);
+  };
+
+  static void add(std::atomic<uint64_t>& counter, uint64_t value) {
+    counter.store(
+        counter.load(std::memory_order_relaxed) + value,
+        std::memory_order_relaxed
+    );
+  };
+
+  bool copy(Board& board) const {
+    board.transfers = transfers.load(std::memory_order_relaxed);
+    board.errors    = errors.load(std::memory_order_relaxed);
+    board.requested = requested.load(std::memory_order_relaxed);
+    board.bytes     = bytes.load(std::memory_order_relaxed);
+    board.events    = events.load(std::memory_order_relaxed);
+    board.stripped  = stripped.load(std::memory_order_relaxed);
+    for (unsigned i = 0; i < nsizes; ++i)
+      board.sizes[i] = sizes[i].load(std::memory_order_relaxed);
+    return true;
+  };
+
+  void clear() {
+    transfers.store(0, std::memory_order_relaxed);
+    errors.store(0, std::memory_order_relaxed);
+    requested.store(0, std::memory_order_relaxed);
+    bytes.store(0, std::memory_order_relaxed);
+    events.store(0, std::memory_order_relaxed);
+    stripped.store(0, std::memory_order_relaxed);
+    for (auto& size: sizes) size.store(0, std::memory_order_relaxed);
+  };
+};
+
+static const unsigned max_boards = 256;
+
+typedef registry::Registry<Counters, Board, max_boards> Registry;
+
+unsigned board(const std::string& name) {
+  return Registry::instance().id(name);
+};
+
+void transfer(
+    unsigned board, uint64_t requested, uint64_t bytes, uint64_t events
+) {
+  Counters* counters = Registry::instance().counters(board);
+  if (!counters) return;
+  Counters::add(counters->transfers, 1);
+  Counters::add(counters->requested, requested);
+  Counters::add(counters->bytes, bytes);
+  Counters::add(counters->events, events);
+  Counters::add(counters->sizes[Board::size_index(bytes / 4)], 1);
+};
+
+void error(unsigned board) {
+  if (Counters* counters = Registry::instance().counters(board))
+    Counters::add(counters->errors, 1);
+};
+
+void stripped(unsigned board, uint64_t nwords) {
+  if (Counters* counters = Registry::instance().counters(board))
+    Counters::add(counters->stripped, nwords);
+};
+
+Snapshot snapshot() {
+  return Registry::instance().snapshot();
+};
+
+void reset() {
+  Registry::instance().reset();
+};
+
+// Label value with the characters special to the exposition format escaped
+static std::string label(const std::string& name) {
+  std::string result = "{board=\"";
+  for (char c: name) {
+    if (c == '\\' || c == '"') result += '\\';
+    if (c == '\n') { result += "\\n"; continue; };
+    result += c;
+  };
+  return result + "\"";
+};
+
+static void family(
+    std::ostream& out, const char* name, const char* type, const char* help
+) {
+  out << "# HELP " << name << ' ' << help << '\n'
+      << "# TYPE " << name << ' ' << type << '\n';
+};
+
+std::string prometheus(
+    const Snapshot& snapshot,
+    const Snapshot* previous,
+    std::chrono::duration<double> interval
+) {
+  std::ostringstream out;
+
+  struct Counter {
+    const char* name;
+    const char* help;
+    uint64_t Board::* field;
+  };
+
+  static const Counter counters[] = {
+    { "caen_readout_transfers_total",
+      "Successful readout block transfers", &Board::transfers },
+    { "caen_readout_errors_total",
+      "Failed readout block transfers", &Board::errors },
+    { "caen_readout_requested_bytes_total",
+      "Bytes requested by the readout block transfers", &Board::requested },
+    { "caen_readout_bytes_total",
+      "Bytes returned by the readout block transfers", &Board::bytes },
+    { "caen_readout_events_total",
+      "Events read out", &Board::events },
+    { "caen_readout_stripped_words_total",
+      "Filler words removed from the data read out", &Board::stripped }
+  };
+
+  for (const Counter& counter: counters) {
+    family(out, counter.name, "counter", counter.help);
+    for (auto& board: snapshot)
+      out << counter.name << label(board.first) << "} "
+          << board.second.*counter.field << '\n';
+  };
+
+  family(
+      out, "caen_readout_fill_ratio", "gauge",
+      "Fraction of the requested words returned by the readout transfers"
+  );
+  for (auto& board: snapshot)
+    out << "caen_readout_fill_ratio" << label(board.first) << "} "
+        << board.second.fill() << '\n';
+
+  family(
+      out, "caen_readout_transfer_words", "histogram",
+      "Words returned per readout block transfer"
+  );
+  for (auto& board: snapshot) {
+    const Board& b = board.second;
+    std::string l = label(board.first);
+    uint64_t count = 0;
+    for (unsigned i = 0; i < nsizes; ++i) {
+      count += b.sizes[i];
+      out << "caen_readout_transfer_words_bucket" << l << ",le=\"";
+      if (i == nsizes - 1)
+        out << "+Inf";
+      else
+        out << (uint64_t(1) << i) - 1;
+      out << "\"} " << count << '\n';
+    };
+    out << "caen_readout_transfer_words_sum" << l << "} " << b.bytes / 4
+        << '\n'
+        << "caen_readout_transfer_words_count" << l << "} " << b.transfers
+        << '\n';
+  };
+
+  if (previous && interval.count() > 0) {
+    static const Board none;
+
+    family(
+        out, "caen_readout_bytes_per_second", "gauge",
+        "Readout throughput since the previous scrape"
+    );
+    for (auto& board: snapshot) {
+      auto p = previous->find(board.first);
+      const Board& before = p == previous->end() ? none : p->second;
+      out << "caen_readout_bytes_per_second" << label(board.first) << "} "
+          << (board.second.bytes - before.bytes) / interval.count() << '\n';
+    };
+
+    family(
+        out, "caen_readout_events_per_second", "gauge",
+        "Readout event rate since the previous scrape"
+    );
+    for (auto& board: snapshot) {
+      auto p = previous->find(board.first);
+      const Board& before = p == previous->end() ? none : p->second;
+      out << "caen_readout_events_per_second" << label(board.first) << "} "
+          << (board.second.events - before.events) / interval.count()
+          << '\n';
+    };
+  };
+
+  return out.str();
+};
+
+static void write_file(const std::string& path, const std::string& text) {
+  std::string temporary = path + ".tmp";
+  FILE* file = fopen(temporary.c_str(), "w");
+  if (!file)
+    throw Error("Cannot open " + temporary + ": " + strerror(errno));
+  bool ok = fwrite(text.data(), 1, text.size(), file) == text.size();
+  ok = fclose(file) == 0 && ok;
+  if (!ok || rename(temporary.c_str(), path.c_str()) != 0) {
+    std::string message = strerror(errno);
+    unlink(temporary.c_str());
+    throw Error("Cannot write " + path + ": " + message);
+  };
+};
+
+void write(const std::string& path) {
+  write_file(path, prometheus(snapshot()));
+};
+
+Exporter::Exporter(
+    Kind kind,
+    const std::string& path,
+    std::chrono::milliseconds period
+): kind_(kind), path_(path), period_(period) {
+  if (kind == Kind::Socket) {
+    sockaddr_un address {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+      throw Error("Socket path too long: " + path);
+    strcpy(address.sun_path, path.c_str());
+
+    socket_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (socket_ < 0)
+      throw Error(std::string("Cannot create a socket: ") + strerror(errno));
+    unlink(path.c_str());
+    if (
+        bind(socket_, reinterpret_cast<sockaddr*>(&address), sizeof(address))
+        || listen(socket_, 4)
+    ) {
+      std::string message = strerror(errno);
+      close(socket_);
+      throw Error("Cannot listen on " + path + ": " + message);
+    };
+  };
+
+  if (pipe2(wakeup_, O_CLOEXEC) != 0) {
+    std::string message = strerror(errno);
+    if (socket_ >= 0) close(socket_);
+    throw Error("Cannot create a pipe: " + message);
+  };
+
+  thread_ = std::thread(&Exporter::run, this);
+};
+
+Exporter::~Exporter() {
+  char c = 0;
+  if (::write(wakeup_[1], &c, 1) != 1) {};
+  thread_.join();
+  close(wakeup_[0]);
+  close(wakeup_[1]);
+  if (socket_ >= 0) {
+    close(socket_);
+    unlink(path_.c_str());
+  };
+};
+
+std::string Exporter::scrape() {
+  Snapshot current = snapshot();
+  auto now = std::chrono::steady_clock::now();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::string result = has_previous_
+    ? prometheus(current, &previous_, now - previous_time_)
+    : prometheus(current);
+  previous_      = std::move(current);
+  previous_time_ = now;
+  has_previous_  = true;
+  return result;
+};
+
+void Exporter::run() {
+  pollfd fds[2] = {
+    { wakeup_[0], POLLIN, 0 },
+    { socket_,    POLLIN, 0 }
+  };
+  nfds_t nfds = kind_ == Kind::Socket ? 2 : 1;
+  int timeout = kind_ == Kind::File ? period_.count() : -1;
+
+  for (;;) {
+    // Errors are not reported from the thread: a failed export is retried
+    // with the next period or connection
+    if (kind_ == Kind::File) {
+      try {
+        write_file(path_, scrape());
+      } catch (const Error&) {};
+    };
+
+    int n = poll(fds, nfds, timeout);
+    if (n < 0 && errno != EINTR) return;
+    if (fds[0].revents) return;
+
+    if (kind_ == Kind::Socket && fds[1].revents & POLLIN) {
+      int connection = accept4(socket_, nullptr, nullptr, SOCK_CLOEXEC);
+      if (connection < 0) continue;
+      std::string text = scrape();
+      const char* data = text.data();
+      size_t left = text.size();
+      while (left) {
+        ssize_t written = send(connection, data, left, MSG_NOSIGNAL);
+        if (written <= 0) break;
+        data += written;
+        left -= written;
+      };
+      close(connection);
+    };
+  };
+};
+
+} // namespace metrics
+} // namespace caen
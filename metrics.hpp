@@ -0,0 +1,151 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <cstdint>
+
+#include "caen.hpp"
+
+namespace caen {
+
+// Readout metrics of the boards. The readout functions of the boards
+// (V792::readout, V1290::readout, V1495::readout, Digitizer::readData, and
+// their non-throwing versions) account every block transfer into per-thread
+// counters; the counters of all threads are aggregated when the metrics are
+// scraped. Updating a counter is a relaxed load and store, no locks or atomic
+// read-modify-write operations are involved.
+namespace metrics {
+
+// Transfers are binned by the number of 32-bit words returned: bin 0 counts
+// empty transfers, bin i > 0 counts transfers of [2^(i-1), 2^i) words.
+static const unsigned nsizes = 34;
+
+// Counters of a board
+struct Board {
+  uint64_t transfers = 0; // successful block transfers
+  uint64_t errors    = 0; // failed block transfers
+  uint64_t requested = 0; // bytes requested by the successful transfers
+  uint64_t bytes     = 0; // bytes returned
+  uint64_t events    = 0; // events in the returned data
+  uint64_t stripped  = 0; // filler words removed from the returned data
+  uint64_t sizes[nsizes] = {};
+
+  void merge(const Board&);
+
+  double words_per_transfer() const {
+    return transfers ? bytes / 4.0 / transfers : 0;
+  };
+
+  // Transfer-fill efficiency: fraction of the requested words returned
+  double fill() const { return requested ? double(bytes) / requested : 0; };
+
+  static unsigned size_index(uint64_t nwords) {
+    if (nwords == 0) return 0;
+    return std::min<unsigned>(64 - __builtin_clzll(nwords), nsizes - 1);
+  };
+};
+
+// Counters by board name, e.g., "V1290@0:0:0x00AA"
+typedef std::map<std::string, Board> Snapshot;
+
+extern std::atomic<bool> enabled_;
+
+// Disabled by default: counting the events costs a pass over the data read
+// out (a library call for the digitizers). When disabled, the readout
+// functions neither account transfers nor count events.
+inline bool enabled() { return enabled_.load(std::memory_order_relaxed); };
+void set_enabled(bool);
+
+// Identifier of a board, registered on first use
+unsigned board(const std::string& name);
+
+// Account a block transfer of `bytes` out of `requested` bytes
+void transfer(
+    unsigned board, uint64_t requested, uint64_t bytes, uint64_t events
+);
+
+// Account a failed block transfer
+void error(unsigned board);
+
+// Account filler words removed from the data read out
+void stripped(unsigned board, uint64_t nwords);
+
+// Counters of all threads, including finished ones, merged by board
+Snapshot snapshot();
+
+// Clear the counters of all threads. Safe while other threads account:
+// each thread clears its own counters when it next updates them.
+void reset();
+
+// Prometheus text exposition format. Counters are exported as totals; if
+// `previous` is given, the byte and event rates over the `interval` between
+// the snapshots are exported as gauges too.
+std::string prometheus(
+    const Snapshot&,
+    const Snapshot* previous = nullptr,
+    std::chrono::duration<double> interval = {}
+);
+
+// Writes the current metrics to `path`. The file is replaced atomically, so
+// that a reader (e.g., the textfile collector of the node exporter) never
+// sees a partial file.
+void write(const std::string& path);
+
+class Error: public caen::Error {
+  public:
+    Error(const std::string& message): message(message) {};
+    const char* what() const throw() { return message.c_str(); };
+
+  private:
+    std::string message;
+};
+
+// Exports the metrics from a background thread, either by rewriting a file
+// every `period` or by serving every connection to a local Unix socket with a
+// scrape. Rates are computed over the time since the previous export.
+class Exporter {
+  public:
+    enum class Kind { File, Socket };
+
+    Exporter(
+        Kind kind,
+        const std::string& path,
+        std::chrono::milliseconds period = std::chrono::seconds(1)
+    );
+
+    // Stops the thread; a socket is unlinked
+    ~Exporter();
+
+    Exporter(const Exporter&) = delete;
+    Exporter& operator=(const Exporter&) = delete;
+
+    const std::string& path() const { return path_; };
+
+    // The next scrape: current metrics with the rates since the previous one
+    std::string scrape();
+
+  private:
+    Kind        kind_;
+    std::string path_;
+    std::chrono::milliseconds period_;
+
+    int  socket_ = -1;
+    int  wakeup_[2] = { -1, -1 }; // pipe waking up the thread to stop
+    std::thread thread_;
+
+    std::mutex mutex_; // of the previous snapshot
+    Snapshot   previous_;
+    std::chrono::steady_clock::time_point previous_time_;
+    bool       has_previous_ = false;
+
+    void run();
+};
+
+} // namespace metrics
+} // namespace caen
@@ -0,0 +1,142 @@
+#include <algorithm>
+
+#include "profile.hpp"
+#include "registry.hpp"
+
+namespace caen {
+namespace profile {
+
+std::atomic<bool> enabled_ { false };
+
+void set_enabled(bool enabled) {
+  enabled_ = enabled;
+};
+
+Histogram::Histogram(): count_(0), sum_(0), min_(UINT64_MAX), max_(0) {
+  std::fill(buckets, buckets + nbuckets, 0);
+};
+
+void Histogram::record(uint64_t ns) {
+  ++buckets[index(ns)];
+  ++count_;
+  sum_ += ns;
+  min_ = std::min(min_, ns);
+  max_ = std::max(max_, ns);
+};
+
+void Histogram::merge(const Histogram& histogram) {
+  for (unsigned i = 0; i < nbuckets; ++i) buckets[i] += histogram.buckets[i];
+  count_ += histogram.count_;
+  sum_   += histogram.sum_;
+  min_    = std::min(min_, histogram.min_);
+  max_    = std::max(max_, histogram.max_);
+};
+
+uint64_t Histogram::lower(unsigned i) {
+  if (i < 1 << sub_bits) return i;
+  unsigned e = (i >> sub_bits) + sub_bits - 1;
+  uint64_t sub = i & ((1 << sub_bits) - 1);
+  return ((1 << sub_bits) + sub) << (e - sub_bits);
+};
+
+uint64_t Histogram::upper(unsigned i) {
+  if (i < 1 << sub_bits) return i;
+  unsigned e = (i >> sub_bits) + sub_bits - 1;
+  return lower(i) + (uint64_t(1) << (e - sub_bits)) - 1;
+};
+
+uint64_t Histogram::quantile(double p) const {
+  if (count_ == 0) return 0;
+  uint64_t rank = std::max<uint64_t>(1, p * count_ + 0.5);
+  uint64_t n = 0;
+  for (unsigned i = 0; i < nbuckets; ++i) {
+    n += buckets[i];
+    if (n >= rank) return std::min(upper(i), max_);
+  };
+  return max_;
+};
+
+// Histogram of a site updated by one thread and read by others, see
+// registry.hpp
+struct Counters {
+  std::atomic<uint64_t> buckets[Histogram::nbuckets];
+  std::atomic<uint64_t> count { 0 };
+  std::atomic<uint64_t> sum   { 0 };
+  std::atomic<uint64_t> min   { UINT64_MAX };
+  std::atomic<uint64_t> max   { 0 };
+
+  Counters() {
+    for (auto& bucket: buckets) bucket.store(0, std::memory_order_relaxed);
+  };
+
+  static void add(std::atomic<uint64_t>& counter, uint64_t value) {
+    counter.store(
+        counter.load(std::memory_order_relaxed) + value,
+        std::memory_order_relaxed
+    );
+  };
+
+  void record(uint64_t ns) {
+    add(buckets[Histogram::index(ns)], 1);
+    add(count, 1);
+    add(sum, ns);
+    if (ns < min.load(std::memory_order_relaxed))
+      min.store(ns, std::memory_order_relaxed);
+    if (ns > max.load(std::memory_order_relaxed))
+      max.store(ns, std::memory_order_relaxed);
+  };
+
+  bool copy(Histogram& histogram) const {
+    for (unsigned i = 0; i < Histogram::nbuckets; ++i)
+      histogram.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+    histogram.count_ = count.load(std::memory_order_relaxed);
+    histogram.sum_   = sum.load(std::memory_order_relaxed);
+    histogram.min_   = min.load(std::memory_order_relaxed);
+    histogram.max_   = max.load(std::memory_order_relaxed);
+    return histogram.count_;
+  };
+
+  void clear() {
+    for (auto& bucket: buckets) bucket.store(0, std::memory_order_relaxed);
+    count.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+    min.store(UINT64_MAX, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+  };
+};
+
+static const unsigned max_sites = 512;
+
+typedef registry::Registry<Counters, Histogram, max_sites> Registry;
+
+unsigned site(const char* name) noexcept {
+  try {
+    return Registry::instance().id(name);
+  } catch (...) {
+    return max_sites - 1;
+  };
+};
+
+void record(unsigned site, uint64_t ns) noexcept {
+  if (Counters* counters = Registry::instance().counters(site))
+    counters->record(ns);
+};
+
+void merge(Snapshot& to, const Snapshot& from) {
+  Registry::merge(to, from);
+};
+
+Snapshot snapshot() {
+  return Registry::instance().snapshot();
+};
+
+Snapshot thread_snapshot() {
+  return Registry::instance().thread_snapshot();
+};
+
+void reset() {
+  Registry::instance().reset();
+};
+
+} // namespace profile
+} // namespace caen
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <string>
+
+#include <cstdint>
+#include <ctime>
+
+namespace caen {
+
+// Latency profiling of the calls to the CAEN libraries. The COMM, VME and
+// DGTZ macros time every call when profiling is enabled and record the
+// latency into per-thread, per-function histograms. When disabled, the cost
+// of a call is a relaxed load of a flag.
+namespace profile {
+
+// Log-linear latency histogram: each power of two is split into 8 linear
+// buckets, so a bucket is at most 12.5% wide. Values are in nanoseconds.
+class Histogram {
+  public:
+    static const unsigned sub_bits = 3;
+    static const unsigned nbuckets = (64 - sub_bits + 1) << sub_bits;
+
+    Histogram();
+
+    void record(uint64_t ns);
+    void merge(const Histogram&);
+
+    uint64_t count() const { return count_; };
+    uint64_t sum()   const { return sum_; };
+    uint64_t min()   const { return count_ ? min_ : 0; };
+    uint64_t max()   const { return max_; };
+    double   mean()  const { return count_ ? double(sum_) / count_ : 0; };
+
+    // Upper bound of the bucket holding the `p`-th quantile (0 <= p <= 1)
+    uint64_t quantile(double p) const;
+
+    uint64_t bucket(unsigned i) const { return buckets[i]; };
+
+    // Range of values [lower, upper] counted in bucket `i`
+    static uint64_t lower(unsigned i);
+    static uint64_t upper(unsigned i);
+
+    static unsigned index(uint64_t ns) {
+      if (ns < 1 << sub_bits) return ns;
+      unsigned e = 63 - __builtin_clzll(ns);
+      return (e - sub_bits + 1) << sub_bits
+           | ns >> (e - sub_bits) & ((1 << sub_bits) - 1);
+    };
+
+  private:
+    friend struct Counters;
+
+    uint64_t buckets[nbuckets];
+    uint64_t count_;
+    uint64_t sum_;
+    uint64_t min_;
+    uint64_t max_;
+};
+
+// Histograms by function name, e.g., "CAENComm_MBLTRead"
+typedef std::map<std::string, Histogram> Snapshot;
+
+extern std::atomic<bool> enabled_;
+
+inline bool enabled() { return enabled_.load(std::memory_order_relaxed); };
+void set_enabled(bool);
+
+// Histograms of all threads, including finished ones, merged by function
+Snapshot snapshot();
+
+// Histograms of the calling thread
+Snapshot thread_snapshot();
+
+void merge(Snapshot& to, const Snapshot& from);
+
+// Clear the histograms of all threads. Safe while other threads profile:
+// each thread clears its own histograms when it next records.
+void reset();
+
+// Identifier of an instrumented function, registered on first use. Neither
+// throws, as the non-throwing readout functions are instrumented too: a
+// function that cannot be registered for lack of memory shares the last
+// identifier, and a latency that cannot be recorded is dropped.
+unsigned site(const char* name) noexcept;
+
+void record(unsigned site, uint64_t ns) noexcept;
+
+inline uint64_t now() {
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return static_cast<uint64_t>(t.tv_sec) * 1000000000 + t.tv_nsec;
+};
+
+// Times its scope when profiling is enabled
+class Timer {
+  public:
+    Timer(unsigned site): site(site), start(enabled() ? now() : 0) {};
+    ~Timer() { if (start) record(site, now() - start); };
+
+  private:
+    unsigned site;
+    uint64_t start;
+};
+
+} // namespace profile
+} // namespace caen
+
+// Evaluates `call` and records its latency under `name`
+#define CAEN_PROFILE(name, call) \
+  ([&]() { \
+    static const unsigned site__ = ::caen::profile::site(name); \
+    ::caen::profile::Timer timer__(site__); \
+    return call; \
+  }())
@@ -0,0 +1,160 @@
+#pragma once
+
+// Per-thread counters registered by name, shared by the profile and metrics
+// modules. Internal header, not installed.
+//
+// Each thread updates its own counters with relaxed loads and stores (no
+// atomic read-modify-write), so the readers may see the counters of a
+// thread in the middle of an update. The counters of finished threads are
+// kept merged.
+//
+// Only the owner writes the counters of a thread: a reset bumps an epoch,
+// the readers skip the counters of an older epoch and the owner clears them
+// when it next updates them.
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace caen {
+namespace registry {
+
+// `Counters` are the counters of a name updated by one thread, with
+// `clear()` and `bool copy(Totals&) const`, false if there is nothing to
+// report. `Totals` are the counters read, with `merge(const Totals&)`.
+template <class Counters, class Totals, unsigned capacity>
+class Registry {
+  public:
+    typedef std::map<std::string, Totals> Snapshot;
+
+    static Registry& instance() {
+      static Registry registry;
+      return registry;
+    };
+
+    // Identifier of `name`, registered on first use. Names beyond the
+    // capacity share the last identifier.
+    unsigned id(const std::string& name) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto id = ids_.find(name);
+      if (id != ids_.end()) return id->second;
+      if (names_.size() == capacity) return capacity - 1;
+      names_.push_back(name);
+      ids_[name] = names_.size() - 1;
+      return names_.size() - 1;
+    };
+
+    // Counters of the calling thread, null if they cannot be allocated.
+    // Does not throw: the stores are linked without allocating.
+    Counters* counters(unsigned id) noexcept {
+      return store().counters(id);
+    };
+
+    // Counters of all threads, including finished ones, merged by name
+    Snapshot snapshot() {
+      std::lock_guard<std::mutex> lock(mutex_);
+      Snapshot result = retired_;
+      for (Store* store = stores_; store; store = store->next)
+        merge(result, store->snapshot(*this));
+      return result;
+    };
+
+    // Counters of the calling thread
+    Snapshot thread_snapshot() {
+      Store& s = store();
+      std::lock_guard<std::mutex> lock(mutex_);
+      return s.snapshot(*this);
+    };
+
+    // Clear the counters of all threads
+    void reset() {
+      std::lock_guard<std::mutex> lock(mutex_);
+      retired_.clear();
+      epoch_.fetch_add(1, std::memory_order_release);
+    };
+
+    static void merge(Snapshot& to, const Snapshot& from) {
+      for (auto& totals: from) to[totals.first].merge(totals.second);
+    };
+
+  private:
+    struct Slot {
+      std::atomic<unsigned> epoch;
+      Counters              counters;
+    };
+
+    // Counters of a thread by name. Allocated by the owner on first use.
+    struct Store {
+      std::atomic<Slot*> slots[capacity];
+      Store*             prev = nullptr;
+      Store*             next = nullptr;
+
+      Store() {
+        for (auto& slot: slots) slot.store(nullptr, std::memory_order_relaxed);
+        Registry& r = instance();
+        std::lock_guard<std::mutex> lock(r.mutex_);
+        next = r.stores_;
+        if (next) next->prev = this;
+        r.stores_ = this;
+      };
+
+      ~Store() {
+        Registry& r = instance();
+        std::lock_guard<std::mutex> lock(r.mutex_);
+        try {
+          merge(r.retired_, snapshot(r));
+        } catch (...) {};
+        (prev ? prev->next : r.stores_) = next;
+        if (next) next->prev = prev;
+        for (auto& slot: slots) delete slot.load();
+      };
+
+      // The registry mutex must be held
+      Snapshot snapshot(const Registry& r) const {
+        Snapshot result;
+        unsigned epoch = r.epoch_.load(std::memory_order_relaxed);
+        for (unsigned i = 0; i < r.names_.size(); ++i) {
+          Slot* slot = slots[i].load(std::memory_order_acquire);
+          if (!slot || slot->epoch.load(std::memory_order_acquire) != epoch)
+            continue;
+          Totals totals;
+          if (slot->counters.copy(totals)) result[r.names_[i]].merge(totals);
+        };
+        return result;
+      };
+
+      Counters* counters(unsigned id) noexcept {
+        unsigned epoch = instance().epoch_.load(std::memory_order_acquire);
+        Slot* slot = slots[id].load(std::memory_order_relaxed);
+        if (!slot) {
+          slot = new (std::nothrow) Slot { { epoch }, {} };
+          if (!slot) return nullptr;
+          slots[id].store(slot, std::memory_order_release);
+        } else if (slot->epoch.load(std::memory_order_relaxed) != epoch) {
+          slot->counters.clear();
+          slot->epoch.store(epoch, std::memory_order_release);
+        };
+        return &slot->counters;
+      };
+    };
+
+    std::mutex                       mutex_;
+    std::vector<std::string>         names_;
+    std::map<std::string, unsigned>  ids_;
+    Store*                           stores_ = nullptr; // of live threads
+    Snapshot                         retired_; // of finished threads
+    std::atomic<unsigned>            epoch_ { 0 }; // bumped by reset()
+
+    Registry() {};
+
+    static Store& store() {
+      thread_local Store store;
+      return store;
+    };
+};
+
+} // namespace registry
+} // namespace caen
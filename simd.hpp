@@ -0,0 +1,441 @@
+#pragma once
+
+// Thin wrappers over the SIMD instruction sets used by the data decoders.
+// Internal header, not installed. The instruction set is chosen at compile
+// time from the target flags (the Makefile builds with -march=native):
+// AVX-512, AVX2, SSE4.1 or plain scalar code, in order of preference.
+//
+// A Vector holds `width` 32-bit lanes, a Mask has one bit per lane. Stores
+// write all `width` lanes, so destinations need `width` elements of slack
+// past the last one used.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX512F__) || defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+namespace caen {
+namespace simd {
+
+typedef uint32_t Mask;
+
+inline unsigned count(Mask mask) { return __builtin_popcount(mask); };
+
+// Index of the lowest lane set in a non-empty mask
+inline unsigned first(Mask mask) { return __builtin_ctz(mask); };
+
+// Lanes set at or below each lane, one row per mask of 8 lanes
+struct CountTable {
+  uint32_t count[256][8];
+};
+
+constexpr CountTable make_count_table() {
+  CountTable table {};
+  for (unsigned mask = 0; mask < 256; ++mask) {
+    unsigned n = 0;
+    for (unsigned i = 0; i < 8; ++i) {
+      n += mask >> i & 1;
+      table.count[mask][i] = n;
+    };
+  };
+  return table;
+};
+
+alignas(32) inline constexpr CountTable count_table = make_count_table();
+
+#if defined(__AVX512F__)
+
+static const unsigned width = 16;
+static const char* const instruction_set = "AVX-512";
+
+typedef __m512i Vector;
+
+inline Vector load(const uint32_t* p) { return _mm512_loadu_si512(p); };
+inline Vector broadcast(uint32_t x) { return _mm512_set1_epi32(x); };
+
+// Load `width` bytes, zero-extended
+inline Vector load_bytes(const uint8_t* p) {
+  return _mm512_cvtepu8_epi32(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(p))
+  );
+};
+
+// Gather the bytes at `base` + each lane, sign-extended. Reads 4 bytes at
+// each offset, so the table needs 3 bytes of slack past the last one.
+inline Vector gather_bytes(const int8_t* base, Vector offsets) {
+  Vector v = _mm512_i32gather_epi32(offsets, base, 1);
+  return _mm512_srai_epi32(_mm512_slli_epi32(v, 24), 24);
+};
+
+template <unsigned N> inline Vector shift_left(Vector v) {
+  return _mm512_slli_epi32(v, N);
+};
+
+template <unsigned N> inline Vector shift_right(Vector v) {
+  return _mm512_srli_epi32(v, N);
+};
+
+inline Vector add(Vector a, Vector b) { return _mm512_add_epi32(a, b); };
+
+inline Vector bit_and(Vector a, Vector b) {
+  return _mm512_and_si512(a, b);
+};
+
+// Low 32 bits of the products
+inline Vector multiply(Vector a, Vector b) {
+  return _mm512_mullo_epi32(a, b);
+};
+
+inline Mask equal(Vector a, Vector b) { return _mm512_cmpeq_epi32_mask(a, b); };
+
+// Number of lanes set in `mask` at or below each lane
+inline Vector prefix_count(Mask mask) {
+  __m256i low = _mm256_load_si256(
+      reinterpret_cast<const __m256i*>(count_table.count[mask & 0xFF])
+  );
+  __m256i high = _mm256_add_epi32(
+      _mm256_load_si256(
+          reinterpret_cast<const __m256i*>(count_table.count[mask >> 8])
+      ),
+      _mm256_set1_epi32(count(mask & 0xFF))
+  );
+  return _mm512_inserti64x4(_mm512_castsi256_si512(low), high, 1);
+};
+
+// Entry of an 8-entry table at each lane, for indices below 8
+inline Vector lookup(const uint32_t* table, Vector index) {
+  return _mm512_permutexvar_epi32(
+      index,
+      _mm512_zextsi256_si512(
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(table))
+      )
+  );
+};
+
+// Move the lanes selected by `mask` to the lowest lanes, in order
+inline Vector left_pack(Vector v, Mask mask) {
+  return _mm512_maskz_compress_epi32(mask, v);
+};
+
+inline void store(uint32_t* p, Vector v) { _mm512_storeu_si512(p, v); };
+
+// Store each lane at `base` + its index. Of lanes with equal indices, the
+// highest one is stored.
+inline void scatter(uint32_t* base, Vector index, Vector v) {
+  _mm512_i32scatter_epi32(base, index, v, 4);
+};
+
+// Store the least significant byte of each lane
+inline void store_bytes(uint8_t* p, Vector v) {
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm512_cvtepi32_epi8(v));
+};
+
+// Store the 16 least significant bits of each lane
+inline void store_halves(uint16_t* p, Vector v) {
+  _mm256_storeu_si256(
+      reinterpret_cast<__m256i*>(p), _mm512_cvtepi32_epi16(v)
+  );
+};
+
+#elif defined(__AVX2__)
+
+static const unsigned width = 8;
+static const char* const instruction_set = "AVX2";
+
+typedef __m256i Vector;
+
+// Lane permutations for left_pack, one per mask
+struct PackTable {
+  uint32_t index[256][8];
+};
+
+constexpr PackTable make_pack_table() {
+  PackTable table {};
+  for (unsigned mask = 0; mask < 256; ++mask) {
+    unsigned n = 0;
+    for (unsigned i = 0; i < 8; ++i)
+      if (mask >> i & 1) table.index[mask][n++] = i;
+  };
+  return table;
+};
+
+alignas(32) inline constexpr PackTable pack_table = make_pack_table();
+
+inline Vector load(const uint32_t* p) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+};
+
+inline Vector broadcast(uint32_t x) { return _mm256_set1_epi32(x); };
+
+inline Vector load_bytes(const uint8_t* p) {
+  return _mm256_cvtepu8_epi32(
+      _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p))
+  );
+};
+
+inline Vector gather_bytes(const int8_t* base, Vector offsets) {
+  Vector v = _mm256_i32gather_epi32(
+      reinterpret_cast<const int*>(base), offsets, 1
+  );
+  return _mm256_srai_epi32(_mm256_slli_epi32(v, 24), 24);
+};
+
+template <unsigned N> inline Vector shift_left(Vector v) {
+  return _mm256_slli_epi32(v, N);
+};
+
+template <unsigned N> inline Vector shift_right(Vector v) {
+  return _mm256_srli_epi32(v, N);
+};
+
+inline Vector add(Vector a, Vector b) { return _mm256_add_epi32(a, b); };
+
+inline Vector bit_and(Vector a, Vector b) {
+  return _mm256_and_si256(a, b);
+};
+
+inline Vector multiply(Vector a, Vector b) {
+  return _mm256_mullo_epi32(a, b);
+};
+
+inline Mask equal(Vector a, Vector b) {
+  return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b)));
+};
+
+inline Vector prefix_count(Mask mask) { return load(count_table.count[mask]); };
+
+inline Vector lookup(const uint32_t* table, Vector index) {
+  return _mm256_permutevar8x32_epi32(load(table), index);
+};
+
+inline Vector left_pack(Vector v, Mask mask) {
+  return _mm256_permutevar8x32_epi32(v, load(pack_table.index[mask]));
+};
+
+inline void store(uint32_t* p, Vector v) {
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+};
+
+// No scatter instruction: one lane at a time, taken out of the registers
+// two by two. Going through memory stalls the stores on the reloads.
+inline void scatter(uint32_t* base, Vector index, Vector v) {
+  __m128i i = _mm256_castsi256_si128(index);
+  __m128i x = _mm256_castsi256_si128(v);
+  for (unsigned half = 0; half < 2; ++half) {
+    uint64_t i01 = _mm_cvtsi128_si64(i), i23 = _mm_extract_epi64(i, 1);
+    uint64_t x01 = _mm_cvtsi128_si64(x), x23 = _mm_extract_epi64(x, 1);
+    base[uint32_t(i01)] = uint32_t(x01);
+    base[i01 >> 32]     = x01 >> 32;
+    base[uint32_t(i23)] = uint32_t(x23);
+    base[i23 >> 32]     = x23 >> 32;
+    i = _mm256_extracti128_si256(index, 1);
+    x = _mm256_extracti128_si256(v, 1);
+  };
+};
+
+inline void store_bytes(uint8_t* p, Vector v) {
+  // Gather the low bytes within each 128-bit half, then join the halves
+  const __m256i bytes = _mm256_setr_epi8(
+      0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+      0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+  );
+  __m256i b = _mm256_permutevar8x32_epi32(
+      _mm256_shuffle_epi8(v, bytes), _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0)
+  );
+  _mm_storel_epi64(
+      reinterpret_cast<__m128i*>(p), _mm256_castsi256_si128(b)
+  );
+};
+
+inline void store_halves(uint16_t* p, Vector v) {
+  // Gather the low halves within each 128-bit half, then join the halves
+  const __m256i halves = _mm256_setr_epi8(
+      0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1,
+      0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1
+  );
+  __m256i h = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(v, halves), 0x8);
+  _mm_storeu_si128(
+      reinterpret_cast<__m128i*>(p), _mm256_castsi256_si128(h)
+  );
+};
+
+#elif defined(__SSE4_1__)
+
+static const unsigned width = 4;
+static const char* const instruction_set = "SSE4.1";
+
+typedef __m128i Vector;
+
+// Byte shuffles for left_pack, one per mask
+struct PackTable {
+  uint8_t index[16][16];
+};
+
+constexpr PackTable make_pack_table() {
+  PackTable table {};
+  for (unsigned mask = 0; mask < 16; ++mask) {
+    unsigned n = 0;
+    for (unsigned i = 0; i < 4; ++i)
+      if (mask >> i & 1) {
+        for (unsigned b = 0; b < 4; ++b)
+          table.index[mask][n * 4 + b] = i * 4 + b;
+        ++n;
+      };
+  };
+  return table;
+};
+
+alignas(16) inline constexpr PackTable pack_table = make_pack_table();
+
+inline Vector load(const uint32_t* p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+};
+
+inline Vector broadcast(uint32_t x) { return _mm_set1_epi32(x); };
+
+inline Vector load_bytes(const uint8_t* p) {
+  uint32_t b;
+  std::memcpy(&b, p, sizeof(b));
+  return _mm_cvtepu8_epi32(_mm_cvtsi32_si128(b));
+};
+
+// No gather instruction: one lane at a time
+inline Vector gather_bytes(const int8_t* base, Vector offsets) {
+  return _mm_setr_epi32(
+      base[_mm_extract_epi32(offsets, 0)],
+      base[_mm_extract_epi32(offsets, 1)],
+      base[_mm_extract_epi32(offsets, 2)],
+      base[_mm_extract_epi32(offsets, 3)]
+  );
+};
+
+template <unsigned N> inline Vector shift_left(Vector v) {
+  return _mm_slli_epi32(v, N);
+};
+
+template <unsigned N> inline Vector shift_right(Vector v) {
+  return _mm_srli_epi32(v, N);
+};
+
+inline Vector add(Vector a, Vector b) { return _mm_add_epi32(a, b); };
+
+inline Vector bit_and(Vector a, Vector b) { return _mm_and_si128(a, b); };
+inline Vector multiply(Vector a, Vector b) { return _mm_mullo_epi32(a, b); };
+
+inline Mask equal(Vector a, Vector b) {
+  return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a, b)));
+};
+
+inline Vector prefix_count(Mask mask) { return load(count_table.count[mask]); };
+
+inline Vector lookup(const uint32_t* table, Vector index) {
+  return _mm_setr_epi32(
+      table[_mm_extract_epi32(index, 0)],
+      table[_mm_extract_epi32(index, 1)],
+      table[_mm_extract_epi32(index, 2)],
+      table[_mm_extract_epi32(index, 3)]
+  );
+};
+
+inline Vector left_pack(Vector v, Mask mask) {
+  const uint8_t* index = pack_table.index[mask];
+  return _mm_shuffle_epi8(
+      v, _mm_load_si128(reinterpret_cast<const __m128i*>(index))
+  );
+};
+
+inline void store(uint32_t* p, Vector v) {
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+};
+
+inline void scatter(uint32_t* base, Vector index, Vector v) {
+  base[_mm_extract_epi32(index, 0)] = _mm_extract_epi32(v, 0);
+  base[_mm_extract_epi32(index, 1)] = _mm_extract_epi32(v, 1);
+  base[_mm_extract_epi32(index, 2)] = _mm_extract_epi32(v, 2);
+  base[_mm_extract_epi32(index, 3)] = _mm_extract_epi32(v, 3);
+};
+
+inline void store_bytes(uint8_t* p, Vector v) {
+  const __m128i bytes = _mm_setr_epi8(
+      0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+  );
+  uint32_t b = _mm_cvtsi128_si32(_mm_shuffle_epi8(v, bytes));
+  std::memcpy(p, &b, sizeof(b));
+};
+
+inline void store_halves(uint16_t* p, Vector v) {
+  const __m128i halves = _mm_setr_epi8(
+      0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1
+  );
+  _mm_storel_epi64(
+      reinterpret_cast<__m128i*>(p), _mm_shuffle_epi8(v, halves)
+  );
+};
+
+#else
+
+static const unsigned width = 1;
+static const char* const instruction_set = "scalar";
+
+typedef uint32_t Vector;
+
+inline Vector load(const uint32_t* p) { return *p; };
+inline Vector broadcast(uint32_t x) { return x; };
+inline Vector load_bytes(const uint8_t* p) { return *p; };
+inline Vector gather_bytes(const int8_t* base, Vector offset) {
+  return base[offset];
+};
+template <unsigned N> inline Vector shift_left(Vector v) { return v << N; };
+template <unsigned N> inline Vector shift_right(Vector v) { return v >> N; };
+inline Vector add(Vector a, Vector b) { return a + b; };
+inline Vector bit_and(Vector a, Vector b) { return a & b; };
+inline Vector multiply(Vector a, Vector b) { return a * b; };
+inline Mask equal(Vector a, Vector b) { return a == b; };
+inline Vector prefix_count(Mask mask) { return mask; };
+inline Vector lookup(const uint32_t* table, Vector index) {
+  return table[index];
+};
+inline Vector left_pack(Vector v, Mask) { return v; };
+inline void store(uint32_t* p, Vector v) { *p = v; };
+inline void scatter(uint32_t* base, Vector index, Vector v) {
+  base[index] = v;
+};
+inline void store_bytes(uint8_t* p, Vector v) { *p = v; };
+inline void store_halves(uint16_t* p, Vector v) { *p = v; };
+
+#endif
+
+// All lanes set
+static const Mask all = width == 32 ? ~Mask(0) : (Mask(1) << width) - 1;
+
+// Remove the words whose bits selected by `mask` equal `value`, in place,
+// keeping the order of the others. Returns the number of words kept.
+inline size_t remove_matching(
+    uint32_t* data, size_t nwords, uint32_t mask, uint32_t value
+) {
+  const Vector m = broadcast(mask);
+  const Vector v = broadcast(value);
+
+  // The stores never reach past the words already loaded
+  size_t n = 0;
+  size_t i = 0;
+  for (; i + width <= nwords; i += width) {
+    Vector words = load(data + i);
+    Mask keep = ~equal(bit_and(words, m), v) & all;
+    if (keep == all && n == i) {
+      n += width;
+      continue;
+    };
+    store(data + n, left_pack(words, keep));
+    n += count(keep);
+  };
+  for (; i < nwords; ++i)
+    if ((data[i] & mask) != value) data[n++] = data[i];
+  return n;
+};
+
+} // namespace simd
+} // namespace caen
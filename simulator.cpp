@@ -0,0 +1,690 @@
+#include <algorithm>
+
+#include <cstring>
+
+#include "simulator.hpp"
+
+namespace caen {
+
+Simulator::Board& Simulator::Board::set(uint32_t offset, uint32_t value) {
+  registers[offset] = value;
+  return *this;
+};
+
+uint32_t Simulator::Board::get(uint32_t offset) const {
+  auto r = registers.find(offset);
+  return r == registers.end() ? 0 : r->second;
+};
+
+bool Simulator::Board::has(uint32_t offset) const {
+  return registers.count(offset) || readers.count(offset);
+};
+
+Simulator::Board& Simulator::Board::on_read(uint32_t offset, Reader reader) {
+  readers[offset] = std::move(reader);
+  return *this;
+};
+
+Simulator::Board& Simulator::Board::on_write(uint32_t offset, Writer writer) {
+  writers[offset] = std::move(writer);
+  return *this;
+};
+
+Simulator::Board& Simulator::Board::set_data_window(
+    uint32_t begin, uint32_t end
+) {
+  window_begin = begin;
+  window_end   = end;
+  return *this;
+};
+
+void Simulator::Board::push_data(const uint32_t* words, size_t nwords) {
+  data.insert(data.end(), words, words + nwords);
+};
+
+CAENComm_ErrorCode Simulator::Board::read(uint32_t offset, uint32_t& value) {
+  auto reader = readers.find(offset);
+  if (reader != readers.end()) {
+    value = reader->second();
+    return CAENComm_Success;
+  };
+
+  // Single cycles in the data window take a word from the data queue
+  if (in_window(offset) && !registers.count(offset)) {
+    if (data.empty()) return CAENComm_VMEBusError;
+    value = data.front();
+    data.pop_front();
+    return CAENComm_Success;
+  };
+
+  auto r = registers.find(offset);
+  if (r == registers.end()) return CAENComm_VMEBusError;
+  value = r->second;
+  return CAENComm_Success;
+};
+
+CAENComm_ErrorCode Simulator::Board::write(uint32_t offset, uint32_t value) {
+  auto writer = writers.find(offset);
+  if (writer == writers.end() && !registers.count(offset))
+    return CAENComm_VMEBusError;
+  registers[offset] = value;
+  if (writer != writers.end()) writer->second(value);
+  return CAENComm_Success;
+};
+
+unsigned Simulator::Board::read_block(uint32_t* buffer, unsigned size) {
+  unsigned n = std::min<size_t>(size, data.size());
+  std::copy(data.begin(), data.begin() + n, buffer);
+  data.erase(data.begin(), data.begin() + n);
+  return n;
+};
+
+uint64_t Simulator::key(uint16_t address, uint32_t link, short node) {
+  return static_cast<uint64_t>(link) << 32
+       | static_cast<uint64_t>(static_cast<uint16_t>(node)) << 16
+       | address;
+};
+
+Simulator::Board& Simulator::add_board(
+    uint16_t address, uint32_t link, short node
+) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return boards_[key(address, link, node)];
+};
+
+Simulator::Board* Simulator::board(
+    uint16_t address, uint32_t link, short node
+) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto board = boards_.find(key(address, link, node));
+  return board == boards_.end() ? nullptr : &board->second;
+};
+
+void Simulator::set_timing(const Timing& timing) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  timing_ = timing;
+};
+
+Simulator::Statistics Simulator::statistics() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return statistics_;
+};
+
+void Simulator::reset_statistics() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  statistics_ = Statistics {};
+};
+
+int Simulator::open(bool vme, uint32_t link, short node, uint16_t address) {
+  sessions_.push_back({ true, vme, link, node, address });
+  return handle_base + sessions_.size() - 1;
+};
+
+Simulator::Session* Simulator::session(int handle, bool vme) {
+  size_t i = handle - handle_base;
+  if (handle < handle_base || i >= sessions_.size()) return nullptr;
+  Session* s = &sessions_[i];
+  if (!s->open || s->vme != vme) return nullptr;
+  return s;
+};
+
+Simulator::Board* Simulator::device(int handle) {
+  Session* s = session(handle, false);
+  if (!s) return nullptr;
+  auto board = boards_.find(key(s->address, s->link, s->node));
+  return board == boards_.end() ? nullptr : &board->second;
+};
+
+Simulator::Board* Simulator::device(int32_t handle, uint32_t address) {
+  Session* s = session(handle, true);
+  if (!s) return nullptr;
+  auto board = boards_.find(key(address >> 16, s->link, s->node));
+  return board == boards_.end() ? nullptr : &board->second;
+};
+
+void Simulator::transaction(uint64_t cycles, uint64_t bytes) {
+  std::chrono::nanoseconds time =
+      timing_.latency + timing_.cycle * static_cast<int64_t>(cycles);
+  if (timing_.bandwidth > 0)
+    time += std::chrono::nanoseconds(
+        static_cast<int64_t>(bytes * 1e9 / timing_.bandwidth)
+    );
+
+  ++statistics_.transactions;
+  statistics_.cycles += cycles;
+  statistics_.bytes  += bytes;
+  statistics_.busy   += time;
+
+  if (time.count() == 0) return;
+  auto deadline = std::chrono::steady_clock::now() + time;
+  while (std::chrono::steady_clock::now() < deadline);
+};
+
+// CAENComm
+
+CAENComm_ErrorCode Simulator::OpenDevice2(
+    CAENComm_ConnectionType type,
+    const void*             arg,
+    int                     node,
+    uint32_t                address,
+    int*                    handle
+) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Ethernet connections are identified by the IP address; put them on link 0
+  uint32_t link = type == CAENComm_ETH_V4718
+                ? 0
+                : *static_cast<const uint32_t*>(arg);
+  if (!boards_.count(key(address >> 16, link, node)))
+    return CAENComm_DeviceNotFound;
+  *handle = open(false, link, node, address >> 16);
+  transaction(0, 0);
+  return CAENComm_Success;
+};
+
+CAENComm_ErrorCode Simulator::CloseDevice(int handle) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Session* s = session(handle, false);
+  if (!s) return CAENComm_InvalidHandler;
+  s->open = false;
+  return CAENComm_Success;
+};
+
+CAENComm_ErrorCode Simulator::Info(int handle, CAENCOMM_INFO info, void* data) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Session* s = session(handle, false);
+  if (!s) return CAENComm_InvalidHandler;
+  if (info != CAENComm_VMELIB_handle) return CAENComm_NotSupported;
+
+  // The bridge of a link is opened once, as CAENComm does
+  int& vme = vme_handles_[key(0, s->link, s->node)];
+  if (!session(vme, true)) vme = open(true, s->link, s->node, 0);
+  *static_cast<int*>(data) = vme;
+  return CAENComm_Success;
+};
+
+template <typename Data>
+CAENComm_ErrorCode Simulator::read(int handle, uint32_t address, Data* data) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Board* board = device(handle);
+  if (!board) return CAENComm_InvalidHandler;
+  transaction(1, sizeof(Data));
+  uint32_t value;
+  CAENComm_ErrorCode status = board->read(address, value);
+  *data = value;
+  return status;
+};
+
+template <typename Data>
+CAENComm_ErrorCode Simulator::write(int handle, uint32_t address, Data data) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Board* board = device(handle);
+  if (!board) return CAENComm_InvalidHandler;
+  transaction(1, sizeof(Data));
+  return board->write(address, data);
+};
+
+CAENComm_ErrorCode Simulator::Read16(
+    int handle, uint32_t address, uint16_t* data
+) {
+  return read(handle, address, data);
+};
+
+CAENComm_ErrorCode Simulator::Read32(
+    int handle, uint32_t address, uint32_t* data
+) {
+  return read(handle, address, data);
+};
+
+CAENComm_ErrorCode Simulator::Write16(
+    int handle, uint32_t address, uint16_t data
+) {
+  return write(handle, address, data);
+};
+
+CAENComm_ErrorCode Simulator::Write32(
+    int handle, uint32_t address, uint32_t data
+) {
+  return write(handle, address, data);
+};
+
+// A multi-cycle transaction fails as a whole if any of its cycles fails, as
+// in CAENComm
+template <typename Data>
+CAENComm_ErrorCode Simulator::multi_read(
+    int                 handle,
+    uint32_t*           addresses,
+    int                 ncycles,
+    Data*               data,
+    CAENComm_ErrorCode* codes
+) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Board* board = device(handle);
+  if (!board) return CAENComm_InvalidHandler;
+  transaction(ncycles, ncycles * sizeof(Data));
+  CAENComm_ErrorCode status = CAENComm_Success;
+  for (int i = 0; i < ncycles; ++i) {
+    uint32_t value = 0;
+    codes[i] = board->read(addresses[i], value);
+    data[i]  = value;
+    if (codes[i] != CAENComm_Success) status = codes[i];
+  };
+  return status;
+};
+
+template <typename Data>
+CAENComm_ErrorCode Simulator::multi_write(
+    int                 handle,
+    uint32_t*           addresses,
+    int                 ncycles,
+    Data*               data,
+    CAENComm_ErrorCode* codes
+) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Board* board = device(handle);
+  if (!board) return CAENComm_InvalidHandler;
+  transaction(ncycles, ncycles * sizeof(Data));
+  CAENComm_ErrorCode status = CAENComm_Success;
+  for (int i = 0; i < ncycles; ++i) {
+    codes[i] = board->write(addresses[i], data[i]);
+    if (codes[i] != CAENComm_Success) status = codes[i];
+  };
+  return status;
+};
+
+CAENComm_ErrorCode Simulator::MultiRead16(
+    int handle,
+    uint32_t* addresses,
+    int ncycles,
+    uint16_t* data,
+    CAENComm_ErrorCode* codes
+) {
+  return multi_read(handle, addresses, ncycles, data, codes);
+};
+
+CAENComm_ErrorCode Simulator::MultiRead32(
+    int handle,
+    uint32_t* addresses,
+    int ncycles,
+    uint32_t* data,
+    CAENComm_ErrorCode* codes
+) {
+  return multi_read(handle, addresses, ncycles, data, codes);
+};
+
+CAENComm_ErrorCode Simulator::MultiWrite16(
+    int handle,
+    uint32_t* addresses,
+    int ncycles,
+    uint16_t* data,
+    CAENComm_ErrorCode* codes
+) {
+  return multi_write(handle, addresses, ncycles, data, codes);
+};
+
+CAENComm_ErrorCode Simulator::MultiWrite32(
+    int handle,
+    uint32_t* addresses,
+    int ncycles,
+    uint32_t* data,
+    CAENComm_ErrorCode* codes
+) {
+  return multi_write(handle, addresses, ncycles, data, codes);
+};
+
+CAENComm_ErrorCode Simulator::block_read(
+    int handle, uint32_t address, uint32_t* buffer, int size, int* nwords
+) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Board* board = device(handle);
+  if (!board) return CAENComm_InvalidHandler;
+  if (!board->in_window(address)) {
+    transaction(1, 0);
+    return CAENComm_VMEBusError;
+  };
+  unsigned size_words = size / sizeof(uint32_t);
+  *nwords = board->read_block(buffer, size_words);
+  transaction(0, *nwords * sizeof(uint32_t));
+  if (*nwords < size_words) return CAENComm_Terminated;
+  return CAENComm_Success;
+};
+
+CAENComm_ErrorCode Simulator::BLTRead(
+    int handle, uint32_t address, uint32_t* buffer, int size, int* nwords
+) {
+  return block_read(handle, address, buffer, size, nwords);
+};
+
+CAENComm_ErrorCode Simulator::MBLTRead(
+    int handle, uint32_t address, uint32_t* buffer, int size, int* nwords
+) {
+  return block_read(handle, address, buffer, size, nwords);
+};
+
+// CAENVME
+
+static CVErrorCodes vme_status(CAENComm_ErrorCode status) {
+  switch (status) {
+    case CAENComm_Success:
+      return cvSuccess;
+    case CAENComm_VMEBusError:
+    case CAENComm_Terminated:
+      return cvBusError;
+    case CAENComm_InvalidHandler:
+      return cvInvalidParam;
+    default:
+      return cvGenericError;
+  };
+};
+
+// Number of bytes in a data unit of the width
+static unsigned width_bytes(CVDataWidth width) {
+  return width & 0xF;
+};
+
+// Bytes moved by `ncycles` cycles of the widths
+static uint64_t cycle_bytes(const CVDataWidth* widths, int ncycles) {
+  uint64_t bytes = 0;
+  for (int i = 0; i < ncycles; ++i) bytes += width_bytes(widths[i]);
+  return bytes;
+};
+
+CVErrorCodes Simulator::Init2(
+    CVBoardTypes type, const void* arg, short node, int32_t* handle
+) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  uint32_t link = type == cvETH_V4718 || type == cvETH_V4718_LOCAL
+                ? 0
+                : *static_cast<const uint32_t*>(arg);
+  *handle = open(true, link, node, 0);
+  transaction(0, 0);
+  return cvSuccess;
+};
+
+CVErrorCodes Simulator::End(int32_t handle) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Session* s = session(handle, true);
+  if (!s) return cvInvalidParam;
+  s->open = false;
+  return cvSuccess;
+};
+
+CVErrorCodes Simulator::vme_read(
+    int32_t handle, uint32_t address, void* data, CVDataWidth width
+) {
+  Board* board = device(handle, address);
+  if (!board) return cvBusError;
+  uint32_t value;
+  CAENComm_ErrorCode status = board->read(address & 0xFFFF, value);
+  switch (width_bytes(width)) {
+    case 1:
+      *static_cast<uint8_t*>(data) = value;
+      break;
+    case 2:
+      *static_cast<uint16_t*>(data) = value;
+      break;
+    default:
+      *static_cast<uint32_t*>(data) = value;
+  };
+  return vme_status(status);
+};
+
+CVErrorCodes Simulator::vme_write(
+    int32_t handle, uint32_t address, void* data, CVDataWidth width
+) {
+  Board* board = device(handle, address);
+  if (!board) return cvBusError;
+  uint32_t value;
+  switch (width_bytes(width)) {
+    case 1:
+      value = *static_cast<uint8_t*>(data);
+      break;
+    case 2:
+      value = *static_cast<uint16_t*>(data);
+      break;
+    default:
+      value = *static_cast<uint32_t*>(data);
+  };
+  return vme_status(board->write(address & 0xFFFF, value));
+};
+
+CVErrorCodes Simulator::ReadCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             data,
+    CVAddressModifier,
+    CVDataWidth       width
+) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!session(handle, true)) return cvInvalidParam;
+  transaction(1, width_bytes(width));
+  return vme_read(handle, address, data, width);
+};
+
+CVErrorCodes Simulator::WriteCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             data,
+    CVAddressModifier,
+    CVDataWidth       width
+) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!session(handle, true)) return cvInvalidParam;
+  transaction(1, width_bytes(width));
+  return vme_write(handle, address, data, width);
+};
+
+// Writes `data` and returns the previous value in it
+CVErrorCodes Simulator::RMWCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             data,
+    CVAddressModifier,
+    CVDataWidth       width
+) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!session(handle, true)) return cvInvalidParam;
+  transaction(2, 2 * width_bytes(width));
+  uint32_t previous;
+  CVErrorCodes status = vme_read(handle, address, &previous, width);
+  if (status != cvSuccess) return status;
+  status = vme_write(handle, address, data, width);
+  std::memcpy(data, &previous, width_bytes(width));
+  return status;
+};
+
+CVErrorCodes Simulator::MultiRead(
+    int32_t            handle,
+    uint32_t*          addresses,
+    uint32_t*          buffer,
+    int                ncycles,
+    CVAddressModifier*,
+    CVDataWidth*       widths,
+    CVErrorCodes*      codes
+) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!session(handle, true)) return cvInvalidParam;
+  transaction(ncycles, cycle_bytes(widths, ncycles));
+  CVErrorCodes status = cvSuccess;
+  for (int i = 0; i < ncycles; ++i) {
+    buffer[i] = 0;
+    codes[i] = vme_read(handle, addresses[i], buffer + i, widths[i]);
+    if (codes[i] != cvSuccess) status = codes[i];
+  };
+  return status;
+};
+
+CVErrorCodes Simulator::MultiWrite(
+    int32_t            handle,
+    uint32_t*          addresses,
+    uint32_t*          buffer,
+    int                ncycles,
+    CVAddressModifier*,
+    CVDataWidth*       widths,
+    CVErrorCodes*      codes
+) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!session(handle, true)) return cvInvalidParam;
+  transaction(ncycles, cycle_bytes(widths, ncycles));
+  CVErrorCodes status = cvSuccess;
+  for (int i = 0; i < ncycles; ++i) {
+    // Data units narrower than 32 bits are in the low bits of the words
+    uint32_t value = buffer[i];
+    CVDataWidth width = width_bytes(widths[i]) < 4 ? widths[i] : cvD32;
+    uint16_t value16 = value;
+    uint8_t  value8  = value;
+    void* data = width_bytes(width) == 1 ? static_cast<void*>(&value8)
+               : width_bytes(width) == 2 ? static_cast<void*>(&value16)
+               : static_cast<void*>(&value);
+    codes[i] = vme_write(handle, addresses[i], data, width);
+    if (codes[i] != cvSuccess) status = codes[i];
+  };
+  return status;
+};
+
+// Block reads take words from the data queue of the board. `size` and `count`
+// are in bytes.
+CVErrorCodes Simulator::vme_block_read(
+    int32_t handle, uint32_t address, void* buffer, int size, int* count
+) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  *count = 0;
+  if (!session(handle, true)) return cvInvalidParam;
+  Board* board = device(handle, address);
+  if (!board || !board->in_window(address & 0xFFFF)) return cvBusError;
+  unsigned size_words = size / sizeof(uint32_t);
+  unsigned nwords = board->read_block(
+      static_cast<uint32_t*>(buffer), size_words
+  );
+  *count = nwords * sizeof(uint32_t);
+  transaction(0, *count);
+  return nwords < size_words ? cvBusError : cvSuccess;
+};
+
+// Block writes store consecutive data units in consecutive registers or, for
+// FIFO cycles, in the same register
+CVErrorCodes Simulator::vme_block_write(
+    int32_t  handle,
+    uint32_t address,
+    void*    buffer,
+    int      size,
+    unsigned width,
+    bool     fifo,
+    int*     count
+) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  *count = 0;
+  if (!session(handle, true)) return cvInvalidParam;
+  Board* board = device(handle, address);
+  if (!board) return cvBusError;
+
+  const uint8_t* data = static_cast<const uint8_t*>(buffer);
+  uint32_t offset = address & 0xFFFF;
+  for (int i = 0; i + width <= size; i += width) {
+    uint32_t value = 0;
+    std::memcpy(&value, data + i, std::min(width, 4u));
+    if (board->write(offset, value) != CAENComm_Success) break;
+    *count += width;
+    if (!fifo) offset += width;
+  };
+
+  transaction(0, *count);
+  return *count < size ? cvBusError : cvSuccess;
+};
+
+CVErrorCodes Simulator::BLTReadCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             buffer,
+    int               size,
+    CVAddressModifier,
+    CVDataWidth,
+    int*              count
+) {
+  return vme_block_read(handle, address, buffer, size, count);
+};
+
+CVErrorCodes Simulator::BLTWriteCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             buffer,
+    int               size,
+    CVAddressModifier,
+    CVDataWidth       width,
+    int*              count
+) {
+  return vme_block_write(
+      handle, address, buffer, size, width_bytes(width), false, count
+  );
+};
+
+CVErrorCodes Simulator::MBLTReadCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             buffer,
+    int               size,
+    CVAddressModifier,
+    int*              count
+) {
+  return vme_block_read(handle, address, buffer, size, count);
+};
+
+CVErrorCodes Simulator::MBLTWriteCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             buffer,
+    int               size,
+    CVAddressModifier,
+    int*              count
+) {
+  return vme_block_write(handle, address, buffer, size, 4, false, count);
+};
+
+CVErrorCodes Simulator::FIFOBLTReadCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             buffer,
+    int               size,
+    CVAddressModifier,
+    CVDataWidth,
+    int*              count
+) {
+  return vme_block_read(handle, address, buffer, size, count);
+};
+
+CVErrorCodes Simulator::FIFOBLTWriteCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             buffer,
+    int               size,
+    CVAddressModifier,
+    CVDataWidth       width,
+    int*              count
+) {
+  return vme_block_write(
+      handle, address, buffer, size, width_bytes(width), true, count
+  );
+};
+
+CVErrorCodes Simulator::FIFOMBLTReadCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             buffer,
+    int               size,
+    CVAddressModifier,
+    int*              count
+) {
+  return vme_block_read(handle, address, buffer, size, count);
+};
+
+CVErrorCodes Simulator::FIFOMBLTWriteCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             buffer,
+    int               size,
+    CVAddressModifier,
+    int*              count
+) {
+  return vme_block_write(handle, address, buffer, size, 4, true, count);
+};
+
+} // namespace caen
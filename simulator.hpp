@@ -0,0 +1,240 @@
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "transport.hpp"
+
+namespace caen {
+
+// In-process model of VME crates for measuring the overhead and throughput of
+// the library without hardware. Make the simulator current (see
+// Transport::set_current) before opening devices and bridges.
+//
+// Boards are identified by the link, the conet node and the most significant
+// 16 bits of their VME address, as in Connection. Registers hold scripted
+// contents; block transfers are served from a queue of words per board. The
+// simulator models a single bus: calls from several threads are serialized.
+class Simulator: public Transport {
+  public:
+    // Cost of bus transactions. Every call to the transport costs `latency`,
+    // plus `cycle` per register cycle it carries, plus 1/`bandwidth` seconds
+    // per byte transferred, the data of the register cycles included. The
+    // time is spent busy waiting so that microsecond latencies are reproduced
+    // accurately.
+    struct Timing {
+      std::chrono::nanoseconds latency { 0 };
+      std::chrono::nanoseconds cycle   { 0 };
+      double bandwidth = 0; // bytes per second, 0 means unlimited
+    };
+
+    struct Statistics {
+      uint64_t transactions; // calls to the transport
+      uint64_t cycles;       // single register accesses
+      uint64_t bytes;        // bytes moved by cycles and block transfers
+      std::chrono::nanoseconds busy; // simulated bus time
+    };
+
+    class Board {
+      public:
+        using Reader = std::function<uint32_t ()>;
+        using Writer = std::function<void (uint32_t)>;
+
+        // Register contents. Accessing a register that was never set gives
+        // a VME bus error. Writes store the value.
+        Board& set(uint32_t offset, uint32_t value);
+        uint32_t get(uint32_t offset) const;
+        bool has(uint32_t offset) const;
+
+        // Custom behaviour: `reader` provides the value of the register
+        // instead of the stored one; `writer` is called after a write stores
+        // the value.
+        Board& on_read(uint32_t offset, Reader reader);
+        Board& on_write(uint32_t offset, Writer writer);
+
+        // Block transfers and single reads from addresses in [begin, end)
+        // take words from the data queue, unless a register is set there. A
+        // transfer that drains the queue terminates with a bus error, like
+        // the boards do when their output buffer is empty. The default window
+        // is the output buffer of most CAEN boards, 0x0000-0x0FFC.
+        Board& set_data_window(uint32_t begin, uint32_t end);
+
+        void push_data(const uint32_t* words, size_t nwords);
+
+        template <typename Words> void push_data(const Words& words) {
+          push_data(words.data(), words.size());
+        };
+
+        size_t data_size() const { return data.size(); };
+        void clear_data() { data.clear(); };
+
+      private:
+        friend class Simulator;
+
+        std::unordered_map<uint32_t, uint32_t> registers;
+        std::unordered_map<uint32_t, Reader>   readers;
+        std::unordered_map<uint32_t, Writer>   writers;
+
+        std::deque<uint32_t> data;
+        uint32_t window_begin = 0;
+        uint32_t window_end   = 0x1000;
+
+        CAENComm_ErrorCode read(uint32_t offset, uint32_t& value);
+        CAENComm_ErrorCode write(uint32_t offset, uint32_t value);
+
+        bool in_window(uint32_t offset) const {
+          return offset >= window_begin && offset < window_end;
+        };
+
+        // Returns the number of words read
+        unsigned read_block(uint32_t* buffer, unsigned size);
+    };
+
+    Simulator() {};
+    Simulator(const Timing& timing): timing_(timing) {};
+
+    // Add a board at VME address `address << 16` or get the existing one
+    Board& add_board(uint16_t address, uint32_t link = 0, short node = 0);
+
+    // Returns nullptr if there is no such board
+    Board* board(uint16_t address, uint32_t link = 0, short node = 0);
+
+    const Timing& timing() const { return timing_; };
+    void set_timing(const Timing& timing);
+
+    Statistics statistics() const;
+    void reset_statistics();
+
+    CAENComm_ErrorCode OpenDevice2(
+        CAENComm_ConnectionType, const void*, int, uint32_t, int*
+    );
+    CAENComm_ErrorCode CloseDevice(int);
+    CAENComm_ErrorCode Info(int, CAENCOMM_INFO, void*);
+    CAENComm_ErrorCode Read16(int, uint32_t, uint16_t*);
+    CAENComm_ErrorCode Read32(int, uint32_t, uint32_t*);
+    CAENComm_ErrorCode Write16(int, uint32_t, uint16_t);
+    CAENComm_ErrorCode Write32(int, uint32_t, uint32_t);
+    CAENComm_ErrorCode MultiRead16(
+        int, uint32_t*, int, uint16_t*, CAENComm_ErrorCode*
+    );
+    CAENComm_ErrorCode MultiRead32(
+        int, uint32_t*, int, uint32_t*, CAENComm_ErrorCode*
+    );
+    CAENComm_ErrorCode MultiWrite16(
+        int, uint32_t*, int, uint16_t*, CAENComm_ErrorCode*
+    );
+    CAENComm_ErrorCode MultiWrite32(
+        int, uint32_t*, int, uint32_t*, CAENComm_ErrorCode*
+    );
+    CAENComm_ErrorCode BLTRead(int, uint32_t, uint32_t*, int, int*);
+    CAENComm_ErrorCode MBLTRead(int, uint32_t, uint32_t*, int, int*);
+
+    CVErrorCodes Init2(CVBoardTypes, const void*, short, int32_t*);
+    CVErrorCodes End(int32_t);
+    CVErrorCodes ReadCycle(
+        int32_t, uint32_t, void*, CVAddressModifier, CVDataWidth
+    );
+    CVErrorCodes WriteCycle(
+        int32_t, uint32_t, void*, CVAddressModifier, CVDataWidth
+    );
+    CVErrorCodes RMWCycle(
+        int32_t, uint32_t, void*, CVAddressModifier, CVDataWidth
+    );
+    CVErrorCodes MultiRead(
+        int32_t, uint32_t*, uint32_t*, int,
+        CVAddressModifier*, CVDataWidth*, CVErrorCodes*
+    );
+    CVErrorCodes MultiWrite(
+        int32_t, uint32_t*, uint32_t*, int,
+        CVAddressModifier*, CVDataWidth*, CVErrorCodes*
+    );
+    CVErrorCodes BLTReadCycle(
+        int32_t, uint32_t, void*, int, CVAddressModifier, CVDataWidth, int*
+    );
+    CVErrorCodes BLTWriteCycle(
+        int32_t, uint32_t, void*, int, CVAddressModifier, CVDataWidth, int*
+    );
+    CVErrorCodes MBLTReadCycle(
+        int32_t, uint32_t, void*, int, CVAddressModifier, int*
+    );
+    CVErrorCodes MBLTWriteCycle(
+        int32_t, uint32_t, void*, int, CVAddressModifier, int*
+    );
+    CVErrorCodes FIFOBLTReadCycle(
+        int32_t, uint32_t, void*, int, CVAddressModifier, CVDataWidth, int*
+    );
+    CVErrorCodes FIFOBLTWriteCycle(
+        int32_t, uint32_t, void*, int, CVAddressModifier, CVDataWidth, int*
+    );
+    CVErrorCodes FIFOMBLTReadCycle(
+        int32_t, uint32_t, void*, int, CVAddressModifier, int*
+    );
+    CVErrorCodes FIFOMBLTWriteCycle(
+        int32_t, uint32_t, void*, int, CVAddressModifier, int*
+    );
+
+  private:
+    // An open CAENComm device (`vme` is false) or CAENVME bridge. Handles are
+    // indices in `sessions_` offset by `handle_base`.
+    struct Session {
+      bool     open;
+      bool     vme;
+      uint32_t link;
+      short    node;
+      uint16_t address; // of the device
+    };
+
+    static const int handle_base = 0x5100;
+
+    std::map<uint64_t, Board> boards_;
+    std::vector<Session>      sessions_;
+
+    // CAENVME handles given out by Info, by link and node
+    std::map<uint64_t, int>   vme_handles_;
+
+    Timing     timing_;
+    Statistics statistics_ {};
+
+    mutable std::mutex mutex_;
+
+    static uint64_t key(uint16_t address, uint32_t link, short node);
+
+    int open(bool vme, uint32_t link, short node, uint16_t address);
+    Session* session(int handle, bool vme);
+
+    // Board addressed by a CAENComm handle or by a full VME address through
+    // a CAENVME handle. Return nullptr if there is none.
+    Board* device(int handle);
+    Board* device(int32_t handle, uint32_t address);
+
+    // Account for a transaction and spend its time on the bus
+    void transaction(uint64_t cycles, uint64_t bytes);
+
+    template <typename Data>
+    CAENComm_ErrorCode read(int handle, uint32_t address, Data* data);
+    template <typename Data>
+    CAENComm_ErrorCode write(int handle, uint32_t address, Data data);
+    template <typename Data>
+    CAENComm_ErrorCode multi_read(
+        int, uint32_t*, int, Data*, CAENComm_ErrorCode*
+    );
+    template <typename Data>
+    CAENComm_ErrorCode multi_write(
+        int, uint32_t*, int, Data*, CAENComm_ErrorCode*
+    );
+    CAENComm_ErrorCode block_read(int, uint32_t, uint32_t*, int, int*);
+
+    CVErrorCodes vme_read(int32_t, uint32_t, void*, CVDataWidth);
+    CVErrorCodes vme_write(int32_t, uint32_t, void*, CVDataWidth);
+    CVErrorCodes vme_block_read(int32_t, uint32_t, void*, int, int*);
+    CVErrorCodes vme_block_write(
+        int32_t, uint32_t, void*, int, unsigned width, bool fifo, int*
+    );
+};
+
+} // namespace caen
@@ -0,0 +1,196 @@
+// Benchmarks of the data paths and of the bus transactions of the boards,
+// on generated data and on the simulator. Run with `make bench`; build with
+// CXXFLAGS selecting the instruction set to compare the SIMD paths, e.g.,
+// `make bench CXXFLAGS="-O2 -mavx2"`.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include "boards.hpp"
+
+using namespace caen;
+
+typedef std::chrono::steady_clock Clock;
+
+// Best time of `repeats` runs of `run`, in seconds
+template <class Run>
+static double best(Run run, unsigned repeats = 20) {
+  double result = 1e9;
+  for (unsigned i = 0; i < repeats; ++i) {
+    Clock::time_point start = Clock::now();
+    run();
+    std::chrono::duration<double> time = Clock::now() - start;
+    result = std::min(result, time.count());
+  };
+  return result;
+};
+
+static void report(const char* name, size_t nwords, double seconds) {
+  std::printf("  %-24s %8.2f GB/s\n", name, nwords * 4 / seconds / 1e9);
+};
+
+static void report(
+    const char* name, size_t nwords, double seconds, double reference
+) {
+  std::printf(
+      "  %-24s %8.2f GB/s  %5.2fx\n",
+      name, nwords * 4 / seconds / 1e9, reference / seconds
+  );
+};
+
+static void bench_v1290() {
+  std::printf("V1290\n");
+  V1290::Generator::Settings settings;
+  settings.multiplicity = 12;
+  settings.ettt_enabled = true;
+  V1290::Generator generator(settings);
+  V1290::Buffer buffer;
+  report("Generator", buffer.max_size(), best([&]() {
+    generator.generate(buffer);
+  }));
+  std::vector<uint32_t> data(buffer.raw(), buffer.raw() + buffer.size());
+
+  V1290::Decoded decoded;
+  double scalar = best([&]() {
+    decoded.clear();
+    V1290::decode_scalar(data.data(), data.size(), decoded);
+  });
+  report("decode_scalar", data.size(), scalar);
+  report("decode", data.size(), best([&]() {
+    decoded.clear();
+    V1290::decode(data.data(), data.size(), decoded);
+  }), scalar);
+  V1290::Resolution resolution { 25e-12, 25e-12 };
+  report("decode_pairs", data.size(), best([&]() {
+    decoded.clear();
+    V1290::decode_pairs(data.data(), data.size(), resolution, decoded);
+  }));
+
+  V1290::Parser parser;
+  V1290::Event event;
+  report("Parser", data.size(), best([&]() {
+    parser.feed(data.data(), data.size());
+    while (parser.next(event));
+  }));
+
+  // One word out of four is a filler
+  Simulator simulator;
+  std::deque<uint32_t> fifo;
+  test::add_v1290(simulator, 0x0020, fifo);
+  Transport::set_current(&simulator);
+  V1290 tdc(test::connection(0x0020));
+  std::vector<uint32_t> padded;
+  for (size_t i = 0; i < data.size(); ++i) {
+    if (i % 3 == 0) padded.push_back(uint32_t(V1290::Packet::filler));
+    padded.push_back(data[i]);
+  };
+  std::vector<uint32_t> work;
+  report("strip_fillers", padded.size(), best([&]() {
+    work = padded;
+    uint32_t nwords = work.size();
+    tdc.strip_fillers(work.data(), nwords);
+  }));
+  Transport::set_current(nullptr);
+};
+
+template <V792::Version version>
+static void bench_v792(const char* name) {
+  std::printf("%s\n", name);
+  std::mt19937 random(1);
+  std::vector<uint32_t> data = test::v792_events(version, 20000, random);
+
+  V792::Decoded decoded;
+  double scalar = best([&]() {
+    decoded.clear();
+    V792::decode_scalar<version>(data.data(), data.size(), decoded);
+  });
+  report("decode_scalar", data.size(), scalar);
+  report("decode", data.size(), best([&]() {
+    decoded.clear();
+    V792::decode<version>(data.data(), data.size(), decoded);
+  }), scalar);
+};
+
+static void bench_strip_invalid() {
+  Simulator simulator;
+  uint32_t counter = 0;
+  test::add_v792(simulator, 0x0030, counter);
+  Transport::set_current(&simulator);
+  V792 qdc(test::connection(0x0030));
+
+  std::mt19937 random(2);
+  std::vector<uint32_t> data = test::v792_events(V792::V792A, 20000, random);
+  std::vector<uint32_t> padded;
+  for (size_t i = 0; i < data.size(); ++i) {
+    if (i % 3 == 0) padded.push_back(6U << 24);
+    padded.push_back(data[i]);
+  };
+  std::vector<uint32_t> work;
+  report("strip_invalid", padded.size(), best([&]() {
+    work = padded;
+    uint32_t nwords = work.size();
+    qdc.strip_invalid(work.data(), nwords);
+  }));
+  Transport::set_current(nullptr);
+};
+
+// Transactions and simulated bus time of the configuration paths, on a bus
+// with the latency of a USB or optical bridge
+static void bench_transactions() {
+  std::printf("Bus transactions (latency 5 us, cycle 0.5 us)\n");
+  Simulator::Timing timing;
+  timing.latency = std::chrono::microseconds(5);
+  timing.cycle   = std::chrono::nanoseconds(500);
+  Simulator simulator(timing);
+  uint32_t counter = 0;
+  test::add_v792(simulator, 0x0030, counter);
+  Transport::set_current(&simulator);
+  V792 qdc(test::connection(0x0030));
+
+  auto measure = [&](const char* name, std::function<void ()> run) {
+    simulator.reset_statistics();
+    run();
+    Simulator::Statistics statistics = simulator.statistics();
+    std::printf(
+        "  %-32s %4llu transactions %8.1f us\n", name,
+        (unsigned long long)statistics.transactions,
+        statistics.busy.count() / 1e3
+    );
+  };
+
+  std::array<uint8_t, 32> thresholds;
+  for (uint8_t i = 0; i < 32; ++i) thresholds[i] = i + 1;
+  measure("thresholds, batched", [&]() { qdc.set_thresholds(thresholds); });
+  measure("thresholds, per channel", [&]() {
+    for (uint8_t i = 0; i < 32; ++i) qdc.set_channel_threshold(i, i + 2);
+  });
+
+  // Writing the settings just read: only the read is left, and nothing
+  // with the register cache
+
+  std::array<V792::ChannelSettings, 32> settings = qdc.channel_settings_all();
+  measure("unchanged settings", [&]() {
+    qdc.set_channel_settings_all(settings);
+  });
+  qdc.set_cache_enabled(true);
+  qdc.set_channel_settings_all(settings);
+  measure("unchanged settings, cached", [&]() {
+    qdc.set_channel_settings_all(settings);
+  });
+  Transport::set_current(nullptr);
+};
+
+int main() {
+  std::printf("SIMD: %s\n", V1290::simd_instruction_set());
+  bench_v1290();
+  bench_v792<V792::V792A>("V792A");
+  bench_v792<V792::V792N>("V792N");
+  bench_strip_invalid();
+  bench_transactions();
+  return 0;
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+// Simulated boards shared by the tests and the benchmarks
+
+#include <deque>
+#include <vector>
+
+#include "simulator.hpp"
+#include "v1290.hpp"
+#include "v792.hpp"
+
+namespace test {
+
+inline caen::Connection connection(uint16_t address) {
+  caen::Connection result;
+  result.bridge  = caen::Connection::Bridge::V1718;
+  result.address = address;
+  return result;
+};
+
+// V1290A with an Event FIFO served from `fifo`. Make the simulator current
+// before opening the board.
+inline caen::Simulator::Board& add_v1290(
+    caen::Simulator& simulator, uint16_t address, std::deque<uint32_t>& fifo
+) {
+  caen::Simulator::Board& board = simulator.add_board(address);
+  for (uint32_t offset = 0x4000; offset < 0x4088; offset += 4)
+    board.set(offset, 0);
+  board.set(0x4024, 0x00).set(0x4028, 0x40).set(0x402C, 0xE6); // OUI
+  board.set(0x4034, 0x00).set(0x4038, 0x05).set(0x403C, 0x0A); // 1290
+  board.set(0x1038, 0).set(0x103C, 0);
+  board.on_read(0x1038, [&fifo]() {
+    uint32_t entry = fifo.front();
+    fifo.pop_front();
+    return entry;
+  });
+  board.on_read(0x103C, [&fifo]() { return uint32_t(fifo.size()); });
+  return board;
+};
+
+// V792AA with its channel settings at 0, served the event counter `counter`
+inline caen::Simulator::Board& add_v792(
+    caen::Simulator& simulator, uint16_t address, const uint32_t& counter
+) {
+  caen::Simulator::Board& board = simulator.add_board(address);
+  for (uint32_t offset = 0x8026; offset < 0x8052; offset += 4)
+    board.set(offset, 0);
+  board.set(0x8F02, 0).set(0x8F06, 0);
+  board.set(0x8026, 0x00).set(0x802A, 0x40).set(0x802E, 0xE6); // OUI
+  board.set(0x8032, 0x11);                                     // V792AA
+  board.set(0x8036, 0x00).set(0x803A, 0x03).set(0x803E, 0x18); // 792
+  for (uint32_t offset = 0x1080; offset < 0x10C0; offset += 2)
+    board.set(offset, 0);
+  board.set(0x1024, 0).set(0x1026, 0);
+  board.on_read(0x1024, [&counter]() { return counter & 0xFFFF; });
+  board.on_read(0x1026, [&counter]() { return counter >> 16 & 0xFF; });
+  return board;
+};
+
+// Events of a V792 of the given version: a header, up to 32 (16) channels,
+// the end of block, with an invalid word now and then. `stray` words of data
+// precede the first header.
+template <class Random>
+std::vector<uint32_t> v792_events(
+    caen::V792::Version version, unsigned nevents, Random& random,
+    unsigned stray = 0
+) {
+  unsigned nchannels = version == caen::V792::V792A ? 32 : 16;
+  unsigned shift     = version == caen::V792::V792A ? 16 : 17;
+  std::vector<uint32_t> result;
+  for (unsigned i = 0; i < stray; ++i) result.push_back(random() & 0xF8FFFFFF);
+  for (unsigned event = 0; event < nevents; ++event) {
+    unsigned n = random() % (nchannels + 1);
+    result.push_back(
+        2U << 24 | random() % 32 << 27 | random() % 256 << 16 | n << 8
+    );
+    for (unsigned channel = 0; channel < n; ++channel)
+      result.push_back(channel << shift | (random() & 0x3FFF));
+    if (random() % 50 == 0) result.push_back(6U << 24);
+    result.push_back(4U << 24 | event);
+  };
+  return result;
+};
+
+} // namespace test
@@ -0,0 +1,342 @@
+// Tests of the logic that needs no hardware: decoders, parser, clocks, and
+// the bus transactions the boards issue, counted by the simulator. Run with
+// `make check`.
+
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "boards.hpp"
+
+using namespace caen;
+
+static unsigned failures = 0;
+
+#define CHECK(condition) \
+  do { \
+    if (!(condition)) { \
+      ++failures; \
+      std::cerr << __FILE__ << ':' << __LINE__ << ": CHECK(" #condition \
+                << ") failed\n"; \
+    }; \
+  } while (false)
+
+static V1290::Generator::Settings generator_settings() {
+  V1290::Generator::Settings settings;
+  settings.multiplicity = 12;
+  settings.error_rate   = 0.05;
+  settings.ettt_enabled = true;
+  return settings;
+};
+
+typedef std::vector<std::vector<uint32_t>> Events;
+
+// Events parsed out of `data` fed in chunks of `chunk` words
+static Events parse(
+    V1290::Parser& parser, const std::vector<uint32_t>& data, size_t chunk
+) {
+  Events result;
+  V1290::Event event;
+  for (size_t i = 0; i < data.size(); i += chunk) {
+    parser.feed(data.data() + i, std::min(chunk, data.size() - i));
+    while (parser.next(event)) result.emplace_back(event.begin, event.end);
+  };
+  return result;
+};
+
+static void test_parser() {
+  V1290::Generator generator(generator_settings());
+  V1290::Buffer buffer;
+  generator.generate(buffer);
+  std::vector<uint32_t> data(buffer.raw(), buffer.raw() + buffer.size());
+
+  V1290::Parser parser;
+  Events whole = parse(parser, data, data.size());
+  CHECK(whole.size() == generator.events());
+  CHECK(parser.statistics().corrupted == 0);
+  CHECK(parser.statistics().stray_words == 0);
+
+  // Events spanning the chunks come out the same
+  for (size_t chunk: { 1, 7, 333 }) {
+    V1290::Parser split;
+    CHECK(parse(split, data, chunk) == whole);
+    CHECK(split.statistics().corrupted == 0);
+  };
+
+  // The view of an event completed from a split readout stays valid until
+  // the next call
+  V1290::Parser split;
+  V1290::Event event;
+  split.feed(data.data(), 3);
+  CHECK(!split.next(event));
+  split.feed(data.data() + 3, data.size() - 3);
+  CHECK(split.next(event));
+  CHECK(std::vector<uint32_t>(event.begin, event.end) == whole[0]);
+
+  // A header before the trailer truncates the event; words outside events
+  // other than fillers are stray
+  std::vector<uint32_t> words = {
+    V1290::TDCMeasurement(1, 2, false).value_,
+    V1290::Packet::filler,
+    V1290::GlobalHeader(0, 1).value_,
+    V1290::TDCMeasurement(1, 2, false).value_,
+  };
+  words.insert(words.end(), whole[0].begin(), whole[0].end());
+  V1290::Parser damaged;
+  Events events = parse(damaged, words, words.size());
+  CHECK(events.size() == 2);
+  CHECK(damaged.statistics().truncated == 1);
+  CHECK(damaged.statistics().stray_words == 1);
+  CHECK(events[1] == whole[0]);
+
+  // An event longer than max_event spanning readouts is dropped
+  std::vector<uint32_t> shortest = whole[0], longest = whole[0];
+  for (const auto& e: whole) {
+    if (e.size() < shortest.size()) shortest = e;
+    if (e.size() > longest.size()) longest = e;
+  };
+  CHECK(shortest.size() + 4 < longest.size());
+  V1290::Parser small(shortest.size() + 4);
+  longest.insert(longest.end(), shortest.begin(), shortest.end());
+  events = parse(small, longest, 4);
+  CHECK(small.statistics().oversized == 1);
+  CHECK(events.size() == 1 && events[0] == shortest);
+};
+
+static void test_trigger_clock() {
+  typedef V1290::ExtendedTriggerTimeTag Tag;
+  typedef V1290::GlobalTrailer Trailer;
+
+  V1290::TriggerClock clock;
+  uint64_t before = clock(Tag(0x7FFFFFF, 0), Trailer(31, 0, 0, 0, 0));
+  CHECK(before == 0xFFFFFFFF);
+  uint64_t after = clock(Tag(0, 0), Trailer(1, 0, 0, 0, 0));
+  CHECK(after == (uint64_t(1) << 32 | 1));
+  CHECK(clock.rollovers() == 1);
+
+  // Events without a time tag or a trailer leave the clock alone
+  V1290::Event event {};
+  CHECK(clock(event) == V1290::TriggerClock::invalid);
+  event.has_ettt = true;
+  event.ettt     = Tag(1, 0);
+  event.problems = V1290::Event::Truncated;
+  CHECK(clock(event) == V1290::TriggerClock::invalid);
+  CHECK(clock.rollovers() == 1);
+  event.problems = 0;
+  CHECK(clock(event) == (uint64_t(1) << 32 | 1 << 5));
+
+  V1290::TriggerClock coarse(false);
+  CHECK(coarse(Tag(3, 0), Trailer(7, 0, 0, 0, 0)) == 3 << 5);
+};
+
+static bool equal(const V1290::Decoded& a, const V1290::Decoded& b) {
+  return a.hits.event == b.hits.event
+      && a.hits.channel == b.hits.channel
+      && a.hits.trailing == b.hits.trailing
+      && a.hits.time == b.hits.time
+      && a.events.count == b.events.count
+      && a.events.geo == b.events.geo
+      && a.events.ettt == b.events.ettt
+      && a.events.nwords == b.events.nwords
+      && a.events.status == b.events.status
+      && a.errors.event == b.errors.event
+      && a.errors.tdc == b.errors.tdc
+      && a.errors.errors == b.errors.errors;
+};
+
+static void test_v1290_decode() {
+  V1290::Generator generator(generator_settings());
+  V1290::Buffer buffer;
+  generator.generate(buffer);
+
+  V1290::Decoded scalar;
+  V1290::decode_scalar(buffer.raw(), buffer.size(), scalar);
+  CHECK(scalar.events.size() == generator.events());
+
+  for (size_t chunk: { size_t(5), size_t(64), buffer.size() }) {
+    V1290::Decoded decoded;
+    for (size_t i = 0; i < buffer.size(); i += chunk)
+      V1290::decode(
+          buffer.raw() + i, std::min(chunk, buffer.size() - i), decoded
+      );
+    CHECK(equal(decoded, scalar));
+  };
+};
+
+static void test_decode_pairs() {
+  std::vector<uint32_t> words = { V1290::GlobalHeader(0, 1).value_ };
+  for (uint32_t i = 0; i < 100; ++i) {
+    uint32_t leading = i * 37 & 0xFFF, width = i & 0x7F;
+    words.push_back(
+        V1290::TDCMeasurement(width << 12 | leading, i % 32, false).value_
+    );
+  };
+
+  // 200 ps edges, 800 ps widths
+  V1290::Decoded decoded;
+  V1290::Resolution resolution { 200e-12, 800e-12 };
+  V1290::decode_pairs(words.data(), words.size(), resolution, decoded);
+  CHECK(decoded.pulses.size() == 100);
+  CHECK(decoded.events.size() == 1);
+  for (uint32_t i = 0; i < decoded.pulses.size(); ++i) {
+    CHECK(decoded.pulses.event[i] == 0);
+    CHECK(decoded.pulses.channel[i] == i % 32);
+    CHECK(decoded.pulses.leading[i] == (i * 37 & 0xFFF) * 200);
+    CHECK(decoded.pulses.width[i] == (i & 0x7F) * 800);
+  };
+};
+
+static void test_strip() {
+  Simulator simulator;
+  std::deque<uint32_t> fifo;
+  uint32_t counter = 0;
+  test::add_v1290(simulator, 0x0020, fifo);
+  test::add_v792(simulator, 0x0030, counter);
+  Transport::set_current(&simulator);
+  V1290 tdc(test::connection(0x0020));
+  V792  qdc(test::connection(0x0030));
+
+  // Padding words anywhere, in runs of any length
+  std::mt19937 random(1);
+  auto pad = [&](uint32_t padding, std::vector<uint32_t>& data) {
+    std::vector<uint32_t> padded;
+    for (uint32_t word: data) {
+      while (random() % 3 == 0) padded.push_back(padding);
+      padded.push_back(word);
+    };
+    for (unsigned i = 0; i < 40; ++i) padded.push_back(padding);
+    return padded;
+  };
+
+  V1290::Generator generator(generator_settings());
+  V1290::Buffer buffer;
+  generator.generate(buffer);
+  std::vector<uint32_t> data(buffer.raw(), buffer.raw() + 5000);
+  std::vector<uint32_t> padded = pad(V1290::Packet::filler, data);
+  uint32_t nwords = padded.size();
+  uint32_t stripped = tdc.strip_fillers(padded.data(), nwords);
+  CHECK(stripped == padded.size() - data.size());
+  CHECK(std::vector<uint32_t>(padded.data(), padded.data() + nwords) == data);
+
+  data = test::v792_events(V792::V792A, 200, random);
+  data.erase(std::remove(data.begin(), data.end(), 6U << 24), data.end());
+  padded = pad(6U << 24, data);
+  nwords = padded.size();
+  stripped = qdc.strip_invalid(padded.data(), nwords);
+  CHECK(stripped == padded.size() - data.size());
+  CHECK(std::vector<uint32_t>(padded.data(), padded.data() + nwords) == data);
+
+  Transport::set_current(nullptr);
+};
+
+static bool equal(const V792::Decoded& a, const V792::Decoded& b) {
+  return a.channels == b.channels
+      && a.geo == b.geo
+      && a.crate == b.crate
+      && a.count == b.count
+      && a.event == b.event;
+};
+
+template <V792::Version version>
+static void test_v792_decode() {
+  std::mt19937 random(version + 1);
+  std::vector<uint32_t> data = test::v792_events(version, 1000, random, 3);
+
+  V792::Decoded scalar;
+  V792::decode_scalar<version>(data.data(), data.size(), scalar);
+  CHECK(scalar.size() == 1000);
+
+  // Events spanning the calls, at random points
+  V792::Decoded decoded;
+  for (size_t i = 0; i < data.size();) {
+    size_t n = std::min<size_t>(random() % 300, data.size() - i);
+    V792::decode<version>(data.data() + i, n, decoded);
+    i += n;
+  };
+  CHECK(equal(decoded, scalar));
+};
+
+// Bus transactions counted by the simulator
+static void test_transactions() {
+  Simulator simulator;
+  std::deque<uint32_t> fifo;
+  uint32_t counter = 0;
+  Simulator::Board& board = test::add_v1290(simulator, 0x0020, fifo);
+  test::add_v792(simulator, 0x0030, counter);
+  Transport::set_current(&simulator);
+  V1290 tdc(test::connection(0x0020));
+  V792  qdc(test::connection(0x0030));
+
+  // The thresholds of all channels: a batched read and a batched write
+  // instead of a read and a write per channel
+  std::array<uint8_t, 32> thresholds;
+  for (uint8_t i = 0; i < 32; ++i) thresholds[i] = i + 1;
+  simulator.reset_statistics();
+  qdc.set_thresholds(thresholds);
+  CHECK(simulator.statistics().transactions == 2);
+  CHECK(qdc.thresholds() == thresholds);
+
+  simulator.reset_statistics();
+  for (uint8_t i = 0; i < 32; ++i) qdc.set_channel_threshold(i, i + 2);
+  CHECK(simulator.statistics().transactions == 64);
+
+  // Unchanged settings cost nothing with the register cache
+  qdc.set_cache_enabled(true);
+  std::array<V792::ChannelSettings, 32> settings = qdc.channel_settings_all();
+  simulator.reset_statistics();
+  qdc.set_channel_settings_all(settings);
+  CHECK(simulator.statistics().transactions == 0);
+  qdc.set_cache_enabled(false);
+
+  // Exact-size readout: the Event FIFO entries in one transaction, the
+  // events in one block transfer and a single cycle for an odd word
+  std::vector<uint32_t> data;
+  uint32_t nwords = 0;
+  for (uint32_t event = 0; event < 10; ++event) {
+    uint32_t size = 3 + event;
+    for (uint32_t i = 0; i < size; ++i) data.push_back(event << 16 | i);
+    fifo.push_back(event << 16 | size);
+    nwords += size;
+  };
+  board.push_data(data);
+  std::vector<uint32_t> buffer(nwords);
+  std::vector<uint16_t> sizes;
+  simulator.reset_statistics();
+  CHECK(tdc.readout_events(buffer.data(), nwords, sizes) == nwords);
+  CHECK(simulator.statistics().transactions == 4);
+  CHECK(sizes.size() == 10);
+  CHECK(buffer == data);
+
+  // A batched transaction costs its latency plus the work of its cycles
+  Simulator::Timing timing;
+  timing.latency = std::chrono::microseconds(2);
+  timing.cycle   = std::chrono::nanoseconds(100);
+  simulator.set_timing(timing);
+  simulator.reset_statistics();
+  qdc.thresholds();
+  Simulator::Statistics statistics = simulator.statistics();
+  CHECK(statistics.transactions == 1);
+  CHECK(statistics.cycles == 32);
+  CHECK(statistics.busy == timing.latency + 32 * timing.cycle);
+
+  Transport::set_current(nullptr);
+};
+
+int main() {
+  test_parser();
+  test_trigger_clock();
+  test_v1290_decode();
+  test_decode_pairs();
+  test_strip();
+  test_v792_decode<V792::V792A>();
+  test_v792_decode<V792::V792N>();
+  test_transactions();
+
+  if (failures) {
+    std::cerr << failures << " checks failed\n";
+    return 1;
+  };
+  std::cout << "All checks passed (" << V1290::simd_instruction_set()
+            << ")\n";
+  return 0;
+};
@@ -0,0 +1,1320 @@
+#include <algorithm>
+#include <iterator>
+
+#include <cstring>
+
+#include "trace.hpp"
+
+namespace caen {
+
+static const char magic[8] = { 'C', 'A', 'E', 'N', 'T', 'R', 'C', '1' };
+
+// Records are accumulated in memory and written in chunks of this size
+static const size_t flush_size = 1 << 20;
+
+// Size of the buffer of the string items of CAENComm_Info
+static const uint32_t info_size = 30;
+
+// Number of bytes in a data unit of the width
+static unsigned width_bytes(CVDataWidth width) {
+  return width & 0xF;
+};
+
+// Number of words of a block read to record. The count is unspecified unless
+// the transfer succeeded or was terminated by a bus error, and never exceeds
+// the buffer.
+static uint32_t block_words(CAENComm_ErrorCode status, int nwords, int size) {
+  if (status != CAENComm_Success && status != CAENComm_Terminated) return 0;
+  return std::min<uint32_t>(std::max(nwords, 0), size / sizeof(uint32_t));
+};
+
+// The same for the bytes of a CAENVME block transfer
+static uint32_t block_bytes(CVErrorCodes status, int count, int size) {
+  if (status != cvSuccess && status != cvBusError) return 0;
+  return std::min(std::max(count, 0), std::max(size, 0));
+};
+
+static uint32_t connection_link(bool ethernet, const void* arg) {
+  // Ethernet connections are identified by the IP address; record them as
+  // link 0
+  return ethernet ? 0 : *static_cast<const uint32_t*>(arg);
+};
+
+Recorder::Recorder(const std::string& path, Transport* transport):
+  transport(transport ? transport : Transport::current()),
+  file(path, std::ios::binary | std::ios::trunc)
+{
+  if (!file) throw trace::Error("caen: cannot open trace file " + path);
+
+  buffer.reserve(flush_size + 4096);
+  put(magic, sizeof(magic));
+  uint64_t start = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::system_clock::now().time_since_epoch()
+  ).count();
+  put(&start, sizeof(start));
+  last = std::chrono::steady_clock::now();
+};
+
+Recorder::~Recorder() {
+  try {
+    flush();
+  } catch (...) {
+  };
+};
+
+void Recorder::flush() {
+  std::lock_guard<std::mutex> lock(mutex);
+  file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+  buffer.clear();
+  file.flush();
+};
+
+void Recorder::put(const void* data, size_t size) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  buffer.insert(buffer.end(), bytes, bytes + size);
+  bytes_ += size;
+};
+
+void Recorder::put8(uint8_t value) {
+  buffer.push_back(value);
+  ++bytes_;
+};
+
+void Recorder::put32(uint32_t value) {
+  put(&value, sizeof(value));
+};
+
+void Recorder::begin(trace::Operation operation, int status, int32_t handle) {
+  auto now = std::chrono::steady_clock::now();
+  uint64_t time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      now - last
+  ).count();
+  last = now;
+
+  put8(operation);
+  put8(static_cast<int8_t>(status));
+  do {
+    put8(time & 0x7F | (time > 0x7F ? 0x80 : 0));
+    time >>= 7;
+  } while (time);
+  put32(handle);
+};
+
+void Recorder::end() {
+  ++records_;
+  if (buffer.size() >= flush_size) {
+    file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+    buffer.clear();
+  };
+};
+
+CAENComm_ErrorCode Recorder::OpenDevice2(
+    CAENComm_ConnectionType type,
+    const void*             arg,
+    int                     node,
+    uint32_t                address,
+    int*                    handle
+) {
+  CAENComm_ErrorCode status = transport->OpenDevice2(
+      type, arg, node, address, handle
+  );
+  std::lock_guard<std::mutex> lock(mutex);
+  begin(trace::OpenDevice2, status, status == CAENComm_Success ? *handle : -1);
+  put32(type);
+  put32(connection_link(type == CAENComm_ETH_V4718, arg));
+  put32(node);
+  put32(address);
+  end();
+  return status;
+};
+
+CAENComm_ErrorCode Recorder::CloseDevice(int handle) {
+  CAENComm_ErrorCode status = transport->CloseDevice(handle);
+  std::lock_guard<std::mutex> lock(mutex);
+  begin(trace::CloseDevice, status, handle);
+  end();
+  return status;
+};
+
+CAENComm_ErrorCode Recorder::Info(int handle, CAENCOMM_INFO info, void* data) {
+  CAENComm_ErrorCode status = transport->Info(handle, info, data);
+  std::lock_guard<std::mutex> lock(mutex);
+  begin(trace::Info, status, handle);
+  put32(info);
+  if (info == CAENComm_VMELIB_handle)
+    put32(status == CAENComm_Success ? *static_cast<int*>(data) : -1);
+  else {
+    // Other items are strings
+    uint32_t length = status == CAENComm_Success
+                    ? std::strlen(static_cast<char*>(data)) + 1
+                    : 0;
+    put32(length);
+    put(data, length);
+  };
+  end();
+  return status;
+};
+
+CAENComm_ErrorCode Recorder::Read16(
+    int handle, uint32_t address, uint16_t* data
+) {
+  CAENComm_ErrorCode status = transport->Read16(handle, address, data);
+  std::lock_guard<std::mutex> lock(mutex);
+  begin(trace::Read16, status, handle);
+  put32(address);
+  put(data, sizeof(*data));
+  end();
+  return status;
+};
+
+CAENComm_ErrorCode Recorder::Read32(
+    int handle, uint32_t address, uint32_t* data
+) {
+  CAENComm_ErrorCode status = transport->Read32(handle, address, data);
+  std::lock_guard<std::mutex> lock(mutex);
+  begin(trace::Read32, status, handle);
+  put32(address);
+  put(data, sizeof(*data));
+  end();
+  return status;
+};
+
+CAENComm_ErrorCode Recorder::Write16(
+    int handle, uint32_t address, uint16_t data
+) {
+  CAENComm_ErrorCode status = transport->Write16(handle, address, data);
+  std::lock_guard<std::mutex> lock(mutex);
+  begin(trace::Write16, status, handle);
+  put32(address);
+  put(&data, sizeof(data));
+  end();
+  return status;
+};
+
+CAENComm_ErrorCode Recorder::Write32(
+    int handle, uint32_t address, uint32_t data
+) {
+  CAENComm_ErrorCode status = transport->Write32(handle, address, data);
+  std::lock_guard<std::mutex> lock(mutex);
+  begin(trace::Write32, status, handle);
+  put32(address);
+  put(&data, sizeof(data));
+  end();
+  return status;
+};
+
+// Payload: the number of cycles and address, data, status of each
+template <typename Data>
+void Recorder::multi(
+    trace::Operation    operation,
+    CAENComm_ErrorCode  status,
+    int                 handle,
+    uint32_t*           addresses,
+    int                 ncycles,
+    Data*               data,
+    CAENComm_ErrorCode* codes
+) {
+  std::lock_guard<std::mutex> lock(mutex);
+  begin(operation, status, handle);
+  put32(ncycles);
+  for (int i = 0; i < ncycles; ++i) {
+    put32(addresses[i]);
+    put(data + i, sizeof(Data));
+    put8(static_cast<int8_t>(codes[i]));
+  };
+  end();
+};
+
+CAENComm_ErrorCode Recorder::MultiRead16(
+    int                 handle,
+    uint32_t*           addresses,
+    int                 ncycles,
+    uint16_t*           data,
+    CAENComm_ErrorCode* codes
+) {
+  CAENComm_ErrorCode status = transport->MultiRead16(
+      handle, addresses, ncycles, data, codes
+  );
+  multi(trace::MultiRead16, status, handle, addresses, ncycles, data, codes);
+  return status;
+};
+
+CAENComm_ErrorCode Recorder::MultiRead32(
+    int                 handle,
+    uint32_t*           addresses,
+    int                 ncycles,
+    uint32_t*           data,
+    CAENComm_ErrorCode* codes
+) {
+  CAENComm_ErrorCode status = transport->MultiRead32(
+      handle, addresses, ncycles, data, codes
+  );
+  multi(trace::MultiRead32, status, handle, addresses, ncycles, data, codes);
+  return status;
+};
+
+CAENComm_ErrorCode Recorder::MultiWrite16(
+    int                 handle,
+    uint32_t*           addresses,
+    int                 ncycles,
+    uint16_t*           data,
+    CAENComm_ErrorCode* codes
+) {
+  CAENComm_ErrorCode status = transport->MultiWrite16(
+      handle, addresses, ncycles, data, codes
+  );
+  multi(trace::MultiWrite16, status, handle, addresses, ncycles, data, codes);
+  return status;
+};
+
+CAENComm_ErrorCode Recorder::MultiWrite32(
+    int                 handle,
+    uint32_t*           addresses,
+    int                 ncycles,
+    uint32_t*           data,
+    CAENComm_ErrorCode* codes
+) {
+  CAENComm_ErrorCode status = transport->MultiWrite32(
+      handle, addresses, ncycles, data, codes
+  );
+  multi(trace::MultiWrite32, status, handle, addresses, ncycles, data, codes);
+  return status;
+};
+
+// Payload: address, size, number of words read and the words
+CAENComm_ErrorCode Recorder::BLTRead(
+    int handle, uint32_t address, uint32_t* buffer, int size, int* nwords
+) {
+  CAENComm_ErrorCode status = transport->BLTRead(
+      handle, address, buffer, size, nwords
+  );
+  std::lock_guard<std::mutex> lock(mutex);
+  uint32_t n = block_words(status, *nwords, size);
+  begin(trace::BLTRead, status, handle);
+  put32(address);
+  put32(size);
+  put32(n);
+  put(buffer, n * sizeof(uint32_t));
+  end();
+  return status;
+};
+
+CAENComm_ErrorCode Recorder::MBLTRead(
+    int handle, uint32_t address, uint32_t* buffer, int size, int* nwords
+) {
+  CAENComm_ErrorCode status = transport->MBLTRead(
+      handle, address, buffer, size, nwords
+  );
+  std::lock_guard<std::mutex> lock(mutex);
+  uint32_t n = block_words(status, *nwords, size);
+  begin(trace::MBLTRead, status, handle);
+  put32(address);
+  put32(size);
+  put32(n);
+  put(buffer, n * sizeof(uint32_t));
+  end();
+  return status;
+};
+
+CVErrorCodes Recorder::Init2(
+    CVBoardTypes type, const void* arg, short node, int32_t* handle
+) {
+  CVErrorCodes status = transport->Init2(type, arg, node, handle);
+  std::lock_guard<std::mutex> lock(mutex);
+  begin(trace::Init2, status, status == cvSuccess ? *handle : -1);
+  put32(type);
+  put32(
+      connection_link(type == cvETH_V4718 || type == cvETH_V4718_LOCAL, arg)
+  );
+  put32(node);
+  end();
+  return status;
+};
+
+CVErrorCodes Recorder::End(int32_t handle) {
+  CVErrorCodes status = transport->End(handle);
+  std::lock_guard<std::mutex> lock(mutex);
+  begin(trace::End, status, handle);
+  end();
+  return status;
+};
+
+// Payload: address, address modifier, width, data. The mutex must be held.
+void Recorder::cycle(
+    trace::Operation  operation,
+    CVErrorCodes      status,
+    int32_t           handle,
+    uint32_t          address,
+    CVAddressModifier modifier,
+    CVDataWidth       width,
+    const void*       data
+) {
+  begin(operation, status, handle);
+  put32(address);
+  put8(modifier);
+  put8(width);
+  put(data, width_bytes(width));
+};
+
+CVErrorCodes Recorder::ReadCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             data,
+    CVAddressModifier modifier,
+    CVDataWidth       width
+) {
+  CVErrorCodes status = transport->ReadCycle(
+      handle, address, data, modifier, width
+  );
+  std::lock_guard<std::mutex> lock(mutex);
+  cycle(trace::ReadCycle, status, handle, address, modifier, width, data);
+  end();
+  return status;
+};
+
+CVErrorCodes Recorder::WriteCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             data,
+    CVAddressModifier modifier,
+    CVDataWidth       width
+) {
+  CVErrorCodes status = transport->WriteCycle(
+      handle, address, data, modifier, width
+  );
+  std::lock_guard<std::mutex> lock(mutex);
+  cycle(trace::WriteCycle, status, handle, address, modifier, width, data);
+  end();
+  return status;
+};
+
+// The payload is followed by the value written
+CVErrorCodes Recorder::RMWCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             data,
+    CVAddressModifier modifier,
+    CVDataWidth       width
+) {
+  uint64_t written = 0;
+  std::memcpy(&written, data, width_bytes(width));
+  CVErrorCodes status = transport->RMWCycle(
+      handle, address, data, modifier, width
+  );
+  std::lock_guard<std::mutex> lock(mutex);
+  cycle(trace::RMWCycle, status, handle, address, modifier, width, data);
+  put(&written, width_bytes(width));
+  end();
+  return status;
+};
+
+// Payload: the number of cycles and address, address modifier, width, data,
+// status of each
+void Recorder::vme_multi(
+    trace::Operation   operation,
+    CVErrorCodes       status,
+    int32_t            handle,
+    uint32_t*          addresses,
+    uint32_t*          buffer,
+    int                ncycles,
+    CVAddressModifier* modifiers,
+    CVDataWidth*       widths,
+    CVErrorCodes*      codes
+) {
+  std::lock_guard<std::mutex> lock(mutex);
+  begin(operation, status, handle);
+  put32(ncycles);
+  for (int i = 0; i < ncycles; ++i) {
+    put32(addresses[i]);
+    put8(modifiers[i]);
+    put8(widths[i]);
+    put32(buffer[i]);
+    put8(static_cast<int8_t>(codes[i]));
+  };
+  end();
+};
+
+CVErrorCodes Recorder::MultiRead(
+    int32_t            handle,
+    uint32_t*          addresses,
+    uint32_t*          buffer,
+    int                ncycles,
+    CVAddressModifier* modifiers,
+    CVDataWidth*       widths,
+    CVErrorCodes*      codes
+) {
+  CVErrorCodes status = transport->MultiRead(
+      handle, addresses, buffer, ncycles, modifiers, widths, codes
+  );
+  vme_multi(
+      trace::MultiRead, status, handle,
+      addresses, buffer, ncycles, modifiers, widths, codes
+  );
+  return status;
+};
+
+CVErrorCodes Recorder::MultiWrite(
+    int32_t            handle,
+    uint32_t*          addresses,
+    uint32_t*          buffer,
+    int                ncycles,
+    CVAddressModifier* modifiers,
+    CVDataWidth*       widths,
+    CVErrorCodes*      codes
+) {
+  CVErrorCodes status = transport->MultiWrite(
+      handle, addresses, buffer, ncycles, modifiers, widths, codes
+  );
+  vme_multi(
+      trace::MultiWrite, status, handle,
+      addresses, buffer, ncycles, modifiers, widths, codes
+  );
+  return status;
+};
+
+// Payload: address, size, address modifier, width (0 for MBLT), the number
+// of bytes transferred (0 if the transfer failed) and the data: the bytes
+// read or all bytes offered for writing
+void Recorder::vme_block(
+    trace::Operation  operation,
+    CVErrorCodes      status,
+    int32_t           handle,
+    uint32_t          address,
+    const void*       buffer,
+    int               size,
+    CVAddressModifier modifier,
+    CVDataWidth       width,
+    int               count,
+    bool              write
+) {
+  count = block_bytes(status, count, size);
+  std::lock_guard<std::mutex> lock(mutex);
+  begin(operation, status, handle);
+  put32(address);
+  put32(size);
+  put8(modifier);
+  put8(width);
+  put32(count);
+  put(buffer, write ? std::max(size, 0) : count);
+  end();
+};
+
+CVErrorCodes Recorder::BLTReadCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             buffer,
+    int               size,
+    CVAddressModifier modifier,
+    CVDataWidth       width,
+    int*              count
+) {
+  CVErrorCodes status = transport->BLTReadCycle(
+      handle, address, buffer, size, modifier, width, count
+  );
+  vme_block(
+      trace::BLTReadCycle, status, handle,
+      address, buffer, size, modifier, width, *count, false
+  );
+  return status;
+};
+
+CVErrorCodes Recorder::BLTWriteCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             buffer,
+    int               size,
+    CVAddressModifier modifier,
+    CVDataWidth       width,
+    int*              count
+) {
+  CVErrorCodes status = transport->BLTWriteCycle(
+      handle, address, buffer, size, modifier, width, count
+  );
+  vme_block(
+      trace::BLTWriteCycle, status, handle,
+      address, buffer, size, modifier, width, *count, true
+  );
+  return status;
+};
+
+CVErrorCodes Recorder::MBLTReadCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             buffer,
+    int               size,
+    CVAddressModifier modifier,
+    int*              count
+) {
+  CVErrorCodes status = transport->MBLTReadCycle(
+      handle, address, buffer, size, modifier, count
+  );
+  vme_block(
+      trace::MBLTReadCycle, status, handle,
+      address, buffer, size, modifier, CVDataWidth(0), *count, false
+  );
+  return status;
+};
+
+CVErrorCodes Recorder::MBLTWriteCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             buffer,
+    int               size,
+    CVAddressModifier modifier,
+    int*              count
+) {
+  CVErrorCodes status = transport->MBLTWriteCycle(
+      handle, address, buffer, size, modifier, count
+  );
+  vme_block(
+      trace::MBLTWriteCycle, status, handle,
+      address, buffer, size, modifier, CVDataWidth(0), *count, true
+  );
+  return status;
+};
+
+CVErrorCodes Recorder::FIFOBLTReadCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             buffer,
+    int               size,
+    CVAddressModifier modifier,
+    CVDataWidth       width,
+    int*              count
+) {
+  CVErrorCodes status = transport->FIFOBLTReadCycle(
+      handle, address, buffer, size, modifier, width, count
+  );
+  vme_block(
+      trace::FIFOBLTReadCycle, status, handle,
+      address, buffer, size, modifier, width, *count, false
+  );
+  return status;
+};
+
+CVErrorCodes Recorder::FIFOBLTWriteCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             buffer,
+    int               size,
+    CVAddressModifier modifier,
+    CVDataWidth       width,
+    int*              count
+) {
+  CVErrorCodes status = transport->FIFOBLTWriteCycle(
+      handle, address, buffer, size, modifier, width, count
+  );
+  vme_block(
+      trace::FIFOBLTWriteCycle, status, handle,
+      address, buffer, size, modifier, width, *count, true
+  );
+  return status;
+};
+
+CVErrorCodes Recorder::FIFOMBLTReadCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             buffer,
+    int               size,
+    CVAddressModifier modifier,
+    int*              count
+) {
+  CVErrorCodes status = transport->FIFOMBLTReadCycle(
+      handle, address, buffer, size, modifier, count
+  );
+  vme_block(
+      trace::FIFOMBLTReadCycle, status, handle,
+      address, buffer, size, modifier, CVDataWidth(0), *count, false
+  );
+  return status;
+};
+
+CVErrorCodes Recorder::FIFOMBLTWriteCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             buffer,
+    int               size,
+    CVAddressModifier modifier,
+    int*              count
+) {
+  CVErrorCodes status = transport->FIFOMBLTWriteCycle(
+      handle, address, buffer, size, modifier, count
+  );
+  vme_block(
+      trace::FIFOMBLTWriteCycle, status, handle,
+      address, buffer, size, modifier, CVDataWidth(0), *count, true
+  );
+  return status;
+};
+
+Player::Player(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) throw trace::Error("caen: cannot open trace file " + path);
+  trace.assign(
+      std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()
+  );
+  if (
+      trace.size() < sizeof(magic) + sizeof(uint64_t)
+      || !std::equal(magic, magic + sizeof(magic), trace.begin())
+  )
+    throw trace::Error("caen: not a trace file: " + path);
+  rewind();
+};
+
+void Player::rewind() {
+  std::lock_guard<std::mutex> lock(mutex);
+  offset    = sizeof(magic) + sizeof(uint64_t);
+  time      = 0;
+  position_ = 0;
+};
+
+// Reading past the end of the trace gives zeros and leaves the cursor at the
+// end, so a truncated trace ends with its last complete record
+void Player::get(void* data, size_t size) {
+  if (cursor + size > trace.size()) {
+    std::memset(data, 0, size);
+    cursor = trace.size();
+    return;
+  };
+  std::memcpy(data, trace.data() + cursor, size);
+  cursor += size;
+};
+
+uint8_t Player::get8() {
+  uint8_t value;
+  get(&value, sizeof(value));
+  return value;
+};
+
+uint32_t Player::get32() {
+  uint32_t value;
+  get(&value, sizeof(value));
+  return value;
+};
+
+bool Player::expect(uint32_t value) {
+  if (get32() == value) return true;
+  ++mismatches_;
+  return false;
+};
+
+bool Player::compare(const void* data, size_t size) {
+  bool equal = cursor + size <= trace.size()
+            && std::memcmp(trace.data() + cursor, data, size) == 0;
+  cursor = std::min(cursor + size, trace.size());
+  if (!equal) ++mismatches_;
+  return equal;
+};
+
+bool Player::next(
+    trace::Operation operation, int32_t handle, int& status, uint64_t key
+) {
+  size_t   record = offset;
+  uint64_t dt     = 0; // of the record and the ones skipped
+  for (unsigned nskipped = 0;; ++nskipped) {
+    if (record >= trace.size() || nskipped > resync_records) {
+      ++mismatches_;
+      return false;
+    };
+
+    cursor = record;
+    uint8_t op = get8();
+    status = static_cast<int8_t>(get8());
+
+    unsigned shift = 0;
+    uint8_t byte;
+    do {
+      byte = get8();
+      dt |= static_cast<uint64_t>(byte & 0x7F) << shift;
+      shift += 7;
+    } while (byte & 0x80 && shift < 64);
+
+    record_handle = get32();
+
+    size_t payload = cursor;
+    if (
+        op == operation
+        && (handle == any_handle || handle == record_handle)
+        && (key == no_key || get32() == key)
+    ) {
+      if (nskipped) {
+        ++mismatches_;
+        skipped_ += nskipped;
+        offset = record;
+      };
+      break;
+    };
+
+    cursor = payload;
+    if (!skip(op)) {
+      ++mismatches_;
+      return false;
+    };
+    record = cursor;
+  };
+
+  if (paced_) {
+    if (position_ == 0) start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::nanoseconds(time + dt);
+    while (std::chrono::steady_clock::now() < deadline);
+  };
+  time += dt;
+
+  return true;
+};
+
+bool Player::skip(uint8_t operation) {
+  uint64_t size;
+  switch (operation) {
+    case trace::CloseDevice:
+    case trace::End:
+      size = 0;
+      break;
+    case trace::Init2:
+      size = 12;
+      break;
+    case trace::OpenDevice2:
+      size = 16;
+      break;
+    case trace::Info:
+      size = get32() == CAENComm_VMELIB_handle ? 4 : get32();
+      break;
+    case trace::Read16:
+    case trace::Write16:
+      size = 4 + sizeof(uint16_t);
+      break;
+    case trace::Read32:
+    case trace::Write32:
+      size = 4 + sizeof(uint32_t);
+      break;
+    case trace::MultiRead16:
+    case trace::MultiWrite16:
+      size = get32() * uint64_t(4 + sizeof(uint16_t) + 1);
+      break;
+    case trace::MultiRead32:
+    case trace::MultiWrite32:
+      size = get32() * uint64_t(4 + sizeof(uint32_t) + 1);
+      break;
+    case trace::BLTRead:
+    case trace::MBLTRead:
+      get32(); // address
+      get32(); // size
+      size = get32() * uint64_t(sizeof(uint32_t));
+      break;
+    case trace::ReadCycle:
+    case trace::WriteCycle:
+    case trace::RMWCycle:
+      get32(); // address
+      get8();  // address modifier
+      size = width_bytes(static_cast<CVDataWidth>(get8()));
+      if (operation == trace::RMWCycle) size *= 2;
+      break;
+    case trace::MultiRead:
+    case trace::MultiWrite:
+      size = get32() * uint64_t(4 + 1 + 1 + 4 + 1);
+      break;
+    case trace::BLTReadCycle:
+    case trace::MBLTReadCycle:
+    case trace::FIFOBLTReadCycle:
+    case trace::FIFOMBLTReadCycle:
+      get32(); // address
+      get32(); // size
+      get8();  // address modifier
+      get8();  // width
+      size = get32();
+      break;
+    case trace::BLTWriteCycle:
+    case trace::MBLTWriteCycle:
+    case trace::FIFOBLTWriteCycle:
+    case trace::FIFOMBLTWriteCycle:
+      get32(); // address
+      size = std::max<int32_t>(get32(), 0);
+      get8();  // address modifier
+      get8();  // width
+      get32(); // count
+      break;
+    default:
+      return false;
+  };
+  cursor += std::min<uint64_t>(size, trace.size() - cursor);
+  return true;
+};
+
+void Player::commit() {
+  offset = cursor;
+  ++position_;
+};
+
+CAENComm_ErrorCode Player::OpenDevice2(
+    CAENComm_ConnectionType, const void*, int, uint32_t address, int* handle
+) {
+  std::lock_guard<std::mutex> lock(mutex);
+  int status;
+  if (!next(trace::OpenDevice2, any_handle, status))
+    return CAENComm_GenericError;
+  get32(); // type
+  get32(); // link
+  get32(); // node
+  if (!expect(address)) return CAENComm_GenericError;
+  *handle = record_handle;
+  commit();
+  return static_cast<CAENComm_ErrorCode>(status);
+};
+
+CAENComm_ErrorCode Player::CloseDevice(int handle) {
+  std::lock_guard<std::mutex> lock(mutex);
+  int status;
+  if (!next(trace::CloseDevice, handle, status)) return CAENComm_GenericError;
+  commit();
+  return static_cast<CAENComm_ErrorCode>(status);
+};
+
+CAENComm_ErrorCode Player::Info(int handle, CAENCOMM_INFO info, void* data) {
+  std::lock_guard<std::mutex> lock(mutex);
+  int status;
+  if (!next(trace::Info, handle, status, info)) return CAENComm_GenericError;
+  if (info == CAENComm_VMELIB_handle)
+    *static_cast<int*>(data) = get32();
+  else {
+    // At most the size of the string items, always terminated
+    uint32_t length = get32();
+    get(data, std::min(length, info_size));
+    if (length > info_size) {
+      static_cast<char*>(data)[info_size - 1] = '\0';
+      cursor = std::min<size_t>(cursor + length - info_size, trace.size());
+    };
+  };
+  commit();
+  return static_cast<CAENComm_ErrorCode>(status);
+};
+
+template <typename Data>
+CAENComm_ErrorCode Player::read(
+    trace::Operation operation, int handle, uint32_t address, Data* data
+) {
+  std::lock_guard<std::mutex> lock(mutex);
+  int status;
+  if (!next(operation, handle, status, address)) return CAENComm_GenericError;
+  get(data, sizeof(Data));
+  commit();
+  return static_cast<CAENComm_ErrorCode>(status);
+};
+
+template <typename Data>
+CAENComm_ErrorCode Player::write(
+    trace::Operation operation, int handle, uint32_t address, Data data
+) {
+  std::lock_guard<std::mutex> lock(mutex);
+  int status;
+  if (!next(operation, handle, status, address)) return CAENComm_GenericError;
+  compare(&data, sizeof(data));
+  commit();
+  return static_cast<CAENComm_ErrorCode>(status);
+};
+
+CAENComm_ErrorCode Player::Read16(
+    int handle, uint32_t address, uint16_t* data
+) {
+  return read(trace::Read16, handle, address, data);
+};
+
+CAENComm_ErrorCode Player::Read32(
+    int handle, uint32_t address, uint32_t* data
+) {
+  return read(trace::Read32, handle, address, data);
+};
+
+CAENComm_ErrorCode Player::Write16(
+    int handle, uint32_t address, uint16_t data
+) {
+  return write(trace::Write16, handle, address, data);
+};
+
+CAENComm_ErrorCode Player::Write32(
+    int handle, uint32_t address, uint32_t data
+) {
+  return write(trace::Write32, handle, address, data);
+};
+
+template <typename Data>
+CAENComm_ErrorCode Player::multi(
+    trace::Operation    operation,
+    int                 handle,
+    uint32_t*           addresses,
+    int                 ncycles,
+    Data*               data,
+    CAENComm_ErrorCode* codes,
+    bool                write
+) {
+  std::lock_guard<std::mutex> lock(mutex);
+  int status;
+  if (!next(operation, handle, status, uint32_t(ncycles)))
+    return CAENComm_GenericError;
+  for (int i = 0; i < ncycles; ++i) {
+    if (!expect(addresses[i])) return CAENComm_GenericError;
+    if (write)
+      compare(data + i, sizeof(Data));
+    else
+      get(data + i, sizeof(Data));
+    codes[i] = static_cast<CAENComm_ErrorCode>(static_cast<int8_t>(get8()));
+  };
+  commit();
+  return static_cast<CAENComm_ErrorCode>(status);
+};
+
+CAENComm_ErrorCode Player::MultiRead16(
+    int                 handle,
+    uint32_t*           addresses,
+    int                 ncycles,
+    uint16_t*           data,
+    CAENComm_ErrorCode* codes
+) {
+  return multi(
+      trace::MultiRead16, handle, addresses, ncycles, data, codes, false
+  );
+};
+
+CAENComm_ErrorCode Player::MultiRead32(
+    int                 handle,
+    uint32_t*           addresses,
+    int                 ncycles,
+    uint32_t*           data,
+    CAENComm_ErrorCode* codes
+) {
+  return multi(
+      trace::MultiRead32, handle, addresses, ncycles, data, codes, false
+  );
+};
+
+CAENComm_ErrorCode Player::MultiWrite16(
+    int                 handle,
+    uint32_t*           addresses,
+    int                 ncycles,
+    uint16_t*           data,
+    CAENComm_ErrorCode* codes
+) {
+  return multi(
+      trace::MultiWrite16, handle, addresses, ncycles, data, codes, true
+  );
+};
+
+CAENComm_ErrorCode Player::MultiWrite32(
+    int                 handle,
+    uint32_t*           addresses,
+    int                 ncycles,
+    uint32_t*           data,
+    CAENComm_ErrorCode* codes
+) {
+  return multi(
+      trace::MultiWrite32, handle, addresses, ncycles, data, codes, true
+  );
+};
+
+CAENComm_ErrorCode Player::block(
+    trace::Operation operation,
+    int              handle,
+    uint32_t         address,
+    uint32_t*        buffer,
+    int              size,
+    int*             nwords
+) {
+  std::lock_guard<std::mutex> lock(mutex);
+  int status;
+  if (!next(operation, handle, status, address)) return CAENComm_GenericError;
+  get32(); // size
+  uint32_t n = get32();
+  if (n * sizeof(uint32_t) > static_cast<uint32_t>(size)) {
+    ++mismatches_;
+    return CAENComm_GenericError;
+  };
+  get(buffer, n * sizeof(uint32_t));
+  *nwords = n;
+  commit();
+  return static_cast<CAENComm_ErrorCode>(status);
+};
+
+// The recorded transfer must fit into the buffer
+CAENComm_ErrorCode Player::BLTRead(
+    int handle, uint32_t address, uint32_t* buffer, int size, int* nwords
+) {
+  return block(trace::BLTRead, handle, address, buffer, size, nwords);
+};
+
+CAENComm_ErrorCode Player::MBLTRead(
+    int handle, uint32_t address, uint32_t* buffer, int size, int* nwords
+) {
+  return block(trace::MBLTRead, handle, address, buffer, size, nwords);
+};
+
+CVErrorCodes Player::Init2(CVBoardTypes, const void*, short, int32_t* handle) {
+  std::lock_guard<std::mutex> lock(mutex);
+  int status;
+  if (!next(trace::Init2, any_handle, status)) return cvGenericError;
+  get32(); // type
+  get32(); // link
+  get32(); // node
+  *handle = record_handle;
+  commit();
+  return static_cast<CVErrorCodes>(status);
+};
+
+CVErrorCodes Player::End(int32_t handle) {
+  std::lock_guard<std::mutex> lock(mutex);
+  int status;
+  if (!next(trace::End, handle, status)) return cvGenericError;
+  commit();
+  return static_cast<CVErrorCodes>(status);
+};
+
+CVErrorCodes Player::cycle(
+    trace::Operation operation,
+    int32_t          handle,
+    uint32_t         address,
+    void*            data,
+    CVDataWidth      width,
+    bool             write
+) {
+  std::lock_guard<std::mutex> lock(mutex);
+  int status;
+  if (!next(operation, handle, status, address)) return cvGenericError;
+  get8(); // address modifier
+  if (get8() != width) {
+    ++mismatches_;
+    return cvGenericError;
+  };
+  // Read-modify-write records the value read, then the value written
+  uint64_t value;
+  if (write)
+    compare(data, width_bytes(width));
+  else
+    get(&value, width_bytes(width));
+  if (operation == trace::RMWCycle) compare(data, width_bytes(width));
+  if (!write) std::memcpy(data, &value, width_bytes(width));
+  commit();
+  return static_cast<CVErrorCodes>(status);
+};
+
+CVErrorCodes Player::ReadCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             data,
+    CVAddressModifier,
+    CVDataWidth       width
+) {
+  return cycle(trace::ReadCycle, handle, address, data, width, false);
+};
+
+CVErrorCodes Player::WriteCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             data,
+    CVAddressModifier,
+    CVDataWidth       width
+) {
+  return cycle(trace::WriteCycle, handle, address, data, width, true);
+};
+
+CVErrorCodes Player::RMWCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             data,
+    CVAddressModifier,
+    CVDataWidth       width
+) {
+  return cycle(trace::RMWCycle, handle, address, data, width, false);
+};
+
+CVErrorCodes Player::vme_multi(
+    trace::Operation operation,
+    int32_t          handle,
+    uint32_t*        addresses,
+    uint32_t*        buffer,
+    int              ncycles,
+    CVErrorCodes*    codes,
+    bool             write
+) {
+  std::lock_guard<std::mutex> lock(mutex);
+  int status;
+  if (!next(operation, handle, status, uint32_t(ncycles)))
+    return cvGenericError;
+  for (int i = 0; i < ncycles; ++i) {
+    if (!expect(addresses[i])) return cvGenericError;
+    get8(); // address modifier
+    get8(); // width
+    if (write)
+      compare(buffer + i, sizeof(uint32_t));
+    else
+      buffer[i] = get32();
+    codes[i] = static_cast<CVErrorCodes>(static_cast<int8_t>(get8()));
+  };
+  commit();
+  return static_cast<CVErrorCodes>(status);
+};
+
+CVErrorCodes Player::MultiRead(
+    int32_t            handle,
+    uint32_t*          addresses,
+    uint32_t*          buffer,
+    int                ncycles,
+    CVAddressModifier*,
+    CVDataWidth*,
+    CVErrorCodes*      codes
+) {
+  return vme_multi(
+      trace::MultiRead, handle, addresses, buffer, ncycles, codes, false
+  );
+};
+
+CVErrorCodes Player::MultiWrite(
+    int32_t            handle,
+    uint32_t*          addresses,
+    uint32_t*          buffer,
+    int                ncycles,
+    CVAddressModifier*,
+    CVDataWidth*,
+    CVErrorCodes*      codes
+) {
+  return vme_multi(
+      trace::MultiWrite, handle, addresses, buffer, ncycles, codes, true
+  );
+};
+
+CVErrorCodes Player::vme_block(
+    trace::Operation operation,
+    int32_t          handle,
+    uint32_t         address,
+    void*            buffer,
+    int              size,
+    int*             count,
+    bool             write
+) {
+  std::lock_guard<std::mutex> lock(mutex);
+  int status;
+  if (!next(operation, handle, status, address) || !expect(size))
+    return cvGenericError;
+  get8(); // address modifier
+  get8(); // width
+  // The recorded transfer must fit into the buffer
+  uint32_t n = get32();
+  if (n > static_cast<uint32_t>(std::max(size, 0))) {
+    ++mismatches_;
+    return cvGenericError;
+  };
+  *count = n;
+  if (write)
+    compare(buffer, size);
+  else
+    get(buffer, n);
+  commit();
+  return static_cast<CVErrorCodes>(status);
+};
+
+CVErrorCodes Player::BLTReadCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             buffer,
+    int               size,
+    CVAddressModifier,
+    CVDataWidth,
+    int*              count
+) {
+  return vme_block(
+      trace::BLTReadCycle, handle, address, buffer, size, count, false
+  );
+};
+
+CVErrorCodes Player::BLTWriteCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             buffer,
+    int               size,
+    CVAddressModifier,
+    CVDataWidth,
+    int*              count
+) {
+  return vme_block(
+      trace::BLTWriteCycle, handle, address, buffer, size, count, true
+  );
+};
+
+CVErrorCodes Player::MBLTReadCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             buffer,
+    int               size,
+    CVAddressModifier,
+    int*              count
+) {
+  return vme_block(
+      trace::MBLTReadCycle, handle, address, buffer, size, count, false
+  );
+};
+
+CVErrorCodes Player::MBLTWriteCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             buffer,
+    int               size,
+    CVAddressModifier,
+    int*              count
+) {
+  return vme_block(
+      trace::MBLTWriteCycle, handle, address, buffer, size, count, true
+  );
+};
+
+CVErrorCodes Player::FIFOBLTReadCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             buffer,
+    int               size,
+    CVAddressModifier,
+    CVDataWidth,
+    int*              count
+) {
+  return vme_block(
+      trace::FIFOBLTReadCycle, handle, address, buffer, size, count, false
+  );
+};
+
+CVErrorCodes Player::FIFOBLTWriteCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             buffer,
+    int               size,
+    CVAddressModifier,
+    CVDataWidth,
+    int*              count
+) {
+  return vme_block(
+      trace::FIFOBLTWriteCycle, handle, address, buffer, size, count, true
+  );
+};
+
+CVErrorCodes Player::FIFOMBLTReadCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             buffer,
+    int               size,
+    CVAddressModifier,
+    int*              count
+) {
+  return vme_block(
+      trace::FIFOMBLTReadCycle, handle, address, buffer, size, count, false
+  );
+};
+
+CVErrorCodes Player::FIFOMBLTWriteCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             buffer,
+    int               size,
+    CVAddressModifier,
+    int*              count
+) {
+  return vme_block(
+      trace::FIFOMBLTWriteCycle, handle, address, buffer, size, count, true
+  );
+};
+
+} // namespace caen
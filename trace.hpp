@@ -0,0 +1,373 @@
+#pragma once
+
+#include <chrono>
+#include <climits>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "caen.hpp"
+#include "transport.hpp"
+
+namespace caen {
+
+// Transaction traces. Recorder sits between devices and a transport (usually
+// the native one) and writes every call with its arguments, results, status
+// and time into a compact binary file. Player serves the calls from such a
+// file without hardware, so that decoding and event building can be profiled
+// on production data and rate dependent problems reproduced exactly.
+//
+// The trace file starts with the 8 bytes "CAENTRC1" followed by the start
+// time of the recording (nanoseconds since the epoch, 8 bytes). Each record
+// is
+//   operation (1 byte, see trace::Operation)
+//   status    (1 byte, the signed CAENComm or CAENVME status)
+//   time      (LEB128, nanoseconds since the previous record)
+//   handle    (4 bytes)
+//   payload   (depends on the operation)
+// Multibyte numbers are in the host byte order (little endian on every
+// platform the CAEN libraries support).
+namespace trace {
+  enum Operation: uint8_t {
+    // CAENComm
+    OpenDevice2 = 1,
+    CloseDevice,
+    Info,
+    Read16,
+    Read32,
+    Write16,
+    Write32,
+    MultiRead16,
+    MultiRead32,
+    MultiWrite16,
+    MultiWrite32,
+    BLTRead,
+    MBLTRead,
+
+    // CAENVME
+    Init2 = 0x40,
+    End,
+    ReadCycle,
+    WriteCycle,
+    RMWCycle,
+    MultiRead,
+    MultiWrite,
+    BLTReadCycle,
+    BLTWriteCycle,
+    MBLTReadCycle,
+    MBLTWriteCycle,
+    FIFOBLTReadCycle,
+    FIFOBLTWriteCycle,
+    FIFOMBLTReadCycle,
+    FIFOMBLTWriteCycle
+  };
+
+  class Error: public caen::Error {
+    public:
+      Error(const std::string& message): message(message) {};
+      const char* what() const throw() { return message.c_str(); };
+
+    private:
+      std::string message;
+  };
+};
+
+// Records the transactions performed through `transport` into `path`. Make
+// the recorder current (see Transport::set_current) before opening devices.
+class Recorder: public Transport {
+  public:
+    Recorder(const std::string& path, Transport* transport = nullptr);
+    ~Recorder();
+
+    // Write buffered records to the file
+    void flush();
+
+    // Number of records and bytes written so far
+    uint64_t records() const { return records_; };
+    uint64_t bytes()   const { return bytes_; };
+
+    bool native() const { return transport->native(); };
+
+    CAENComm_ErrorCode OpenDevice2(
+        CAENComm_ConnectionType, const void*, int, uint32_t, int*
+    );
+    CAENComm_ErrorCode CloseDevice(int);
+    CAENComm_ErrorCode Info(int, CAENCOMM_INFO, void*);
+    CAENComm_ErrorCode Read16(int, uint32_t, uint16_t*);
+    CAENComm_ErrorCode Read32(int, uint32_t, uint32_t*);
+    CAENComm_ErrorCode Write16(int, uint32_t, uint16_t);
+    CAENComm_ErrorCode Write32(int, uint32_t, uint32_t);
+    CAENComm_ErrorCode MultiRead16(
+        int, uint32_t*, int, uint16_t*, CAENComm_ErrorCode*
+    );
+    CAENComm_ErrorCode MultiRead32(
+        int, uint32_t*, int, uint32_t*, CAENComm_ErrorCode*
+    );
+    CAENComm_ErrorCode MultiWrite16(
+        int, uint32_t*, int, uint16_t*, CAENComm_ErrorCode*
+    );
+    CAENComm_ErrorCode MultiWrite32(
+        int, uint32_t*, int, uint32_t*, CAENComm_ErrorCode*
+    );
+    CAENComm_ErrorCode BLTRead(int, uint32_t, uint32_t*, int, int*);
+    CAENComm_ErrorCode MBLTRead(int, uint32_t, uint32_t*, int, int*);
+
+    CVErrorCodes Init2(CVBoardTypes, const void*, short, int32_t*);
+    CVErrorCodes End(int32_t);
+    CVErrorCodes ReadCycle(
+        int32_t, uint32_t, void*, CVAddressModifier, CVDataWidth
+    );
+    CVErrorCodes WriteCycle(
+        int32_t, uint32_t, void*, CVAddressModifier, CVDataWidth
+    );
+    CVErrorCodes RMWCycle(
+        int32_t, uint32_t, void*, CVAddressModifier, CVDataWidth
+    );
+    CVErrorCodes MultiRead(
+        int32_t, uint32_t*, uint32_t*, int,
+        CVAddressModifier*, CVDataWidth*, CVErrorCodes*
+    );
+    CVErrorCodes MultiWrite(
+        int32_t, uint32_t*, uint32_t*, int,
+        CVAddressModifier*, CVDataWidth*, CVErrorCodes*
+    );
+    CVErrorCodes BLTReadCycle(
+        int32_t, uint32_t, void*, int, CVAddressModifier, CVDataWidth, int*
+    );
+    CVErrorCodes BLTWriteCycle(
+        int32_t, uint32_t, void*, int, CVAddressModifier, CVDataWidth, int*
+    );
+    CVErrorCodes MBLTReadCycle(
+        int32_t, uint32_t, void*, int, CVAddressModifier, int*
+    );
+    CVErrorCodes MBLTWriteCycle(
+        int32_t, uint32_t, void*, int, CVAddressModifier, int*
+    );
+    CVErrorCodes FIFOBLTReadCycle(
+        int32_t, uint32_t, void*, int, CVAddressModifier, CVDataWidth, int*
+    );
+    CVErrorCodes FIFOBLTWriteCycle(
+        int32_t, uint32_t, void*, int, CVAddressModifier, CVDataWidth, int*
+    );
+    CVErrorCodes FIFOMBLTReadCycle(
+        int32_t, uint32_t, void*, int, CVAddressModifier, int*
+    );
+    CVErrorCodes FIFOMBLTWriteCycle(
+        int32_t, uint32_t, void*, int, CVAddressModifier, int*
+    );
+
+  private:
+    Transport*    transport;
+    std::ofstream file;
+    std::mutex    mutex;
+
+    std::vector<uint8_t> buffer;
+    uint64_t records_ = 0;
+    uint64_t bytes_   = 0;
+
+    std::chrono::steady_clock::time_point last;
+
+    // Start a record. The mutex must be held until the record is complete.
+    void begin(trace::Operation, int status, int32_t handle);
+    void put(const void* data, size_t size);
+    void put8(uint8_t);
+    void put32(uint32_t);
+    void end();
+
+    template <typename Data>
+    void multi(
+        trace::Operation, CAENComm_ErrorCode, int, uint32_t*, int, Data*,
+        CAENComm_ErrorCode*
+    );
+    void cycle(
+        trace::Operation, CVErrorCodes, int32_t, uint32_t, CVAddressModifier,
+        CVDataWidth, const void*
+    );
+    void vme_multi(
+        trace::Operation, CVErrorCodes, int32_t, uint32_t*, uint32_t*, int,
+        CVAddressModifier*, CVDataWidth*, CVErrorCodes*
+    );
+    void vme_block(
+        trace::Operation, CVErrorCodes, int32_t, uint32_t, const void*, int,
+        CVAddressModifier, CVDataWidth, int count, bool write
+    );
+};
+
+// Replays a trace recorded with Recorder. Calls are matched against the
+// records in order. A call that does not match the next record (another
+// operation, handle or address) is looked for in the following records: if
+// found within `resync_records`, the records before it are skipped, as calls
+// no longer made, and counted in `skipped`. Otherwise the call fails with
+// CAENComm_GenericError or cvGenericError and leaves the record in place, as
+// a call not recorded. Either way it is counted in `mismatches`. Calls past
+// the end of the trace fail the same way. Writes of data other than the
+// recorded are replayed, but counted in `mismatches` as well.
+class Player: public Transport {
+  public:
+    // Reads the whole trace into memory. Throws trace::Error if the file is
+    // not a trace.
+    Player(const std::string& path);
+
+    // By default the trace is replayed at full speed. When paced, each call
+    // waits until the time of its record relative to the first call.
+    void set_paced(bool paced) { paced_ = paced; };
+
+    // Records looked through to resynchronize after a mismatched call
+    static const unsigned resync_records = 64;
+
+    // Number of records replayed, records skipped, mismatched calls
+    uint64_t position()   const { return position_; };
+    uint64_t skipped()    const { return skipped_; };
+    uint64_t mismatches() const { return mismatches_; };
+    bool     finished()   const { return offset >= trace.size(); };
+
+    // Start over
+    void rewind();
+
+    CAENComm_ErrorCode OpenDevice2(
+        CAENComm_ConnectionType, const void*, int, uint32_t, int*
+    );
+    CAENComm_ErrorCode CloseDevice(int);
+    CAENComm_ErrorCode Info(int, CAENCOMM_INFO, void*);
+    CAENComm_ErrorCode Read16(int, uint32_t, uint16_t*);
+    CAENComm_ErrorCode Read32(int, uint32_t, uint32_t*);
+    CAENComm_ErrorCode Write16(int, uint32_t, uint16_t);
+    CAENComm_ErrorCode Write32(int, uint32_t, uint32_t);
+    CAENComm_ErrorCode MultiRead16(
+        int, uint32_t*, int, uint16_t*, CAENComm_ErrorCode*
+    );
+    CAENComm_ErrorCode MultiRead32(
+        int, uint32_t*, int, uint32_t*, CAENComm_ErrorCode*
+    );
+    CAENComm_ErrorCode MultiWrite16(
+        int, uint32_t*, int, uint16_t*, CAENComm_ErrorCode*
+    );
+    CAENComm_ErrorCode MultiWrite32(
+        int, uint32_t*, int, uint32_t*, CAENComm_ErrorCode*
+    );
+    CAENComm_ErrorCode BLTRead(int, uint32_t, uint32_t*, int, int*);
+    CAENComm_ErrorCode MBLTRead(int, uint32_t, uint32_t*, int, int*);
+
+    CVErrorCodes Init2(CVBoardTypes, const void*, short, int32_t*);
+    CVErrorCodes End(int32_t);
+    CVErrorCodes ReadCycle(
+        int32_t, uint32_t, void*, CVAddressModifier, CVDataWidth
+    );
+    CVErrorCodes WriteCycle(
+        int32_t, uint32_t, void*, CVAddressModifier, CVDataWidth
+    );
+    CVErrorCodes RMWCycle(
+        int32_t, uint32_t, void*, CVAddressModifier, CVDataWidth
+    );
+    CVErrorCodes MultiRead(
+        int32_t, uint32_t*, uint32_t*, int,
+        CVAddressModifier*, CVDataWidth*, CVErrorCodes*
+    );
+    CVErrorCodes MultiWrite(
+        int32_t, uint32_t*, uint32_t*, int,
+        CVAddressModifier*, CVDataWidth*, CVErrorCodes*
+    );
+    CVErrorCodes BLTReadCycle(
+        int32_t, uint32_t, void*, int, CVAddressModifier, CVDataWidth, int*
+    );
+    CVErrorCodes BLTWriteCycle(
+        int32_t, uint32_t, void*, int, CVAddressModifier, CVDataWidth, int*
+    );
+    CVErrorCodes MBLTReadCycle(
+        int32_t, uint32_t, void*, int, CVAddressModifier, int*
+    );
+    CVErrorCodes MBLTWriteCycle(
+        int32_t, uint32_t, void*, int, CVAddressModifier, int*
+    );
+    CVErrorCodes FIFOBLTReadCycle(
+        int32_t, uint32_t, void*, int, CVAddressModifier, CVDataWidth, int*
+    );
+    CVErrorCodes FIFOBLTWriteCycle(
+        int32_t, uint32_t, void*, int, CVAddressModifier, CVDataWidth, int*
+    );
+    CVErrorCodes FIFOMBLTReadCycle(
+        int32_t, uint32_t, void*, int, CVAddressModifier, int*
+    );
+    CVErrorCodes FIFOMBLTWriteCycle(
+        int32_t, uint32_t, void*, int, CVAddressModifier, int*
+    );
+
+  private:
+    std::vector<uint8_t> trace;
+    size_t   offset; // of the next record in `trace`
+    uint64_t time;   // of the last replayed record since the first one, ns
+
+    uint64_t position_   = 0;
+    uint64_t skipped_    = 0;
+    uint64_t mismatches_ = 0;
+    bool     paced_      = false;
+
+    std::chrono::steady_clock::time_point start;
+    std::mutex mutex;
+
+    // Cursor over the payload of the record being replayed
+    size_t cursor;
+
+    // Handle of the record being replayed
+    int32_t record_handle;
+
+    // Matches any handle or any record without a key in `next`
+    static const int32_t  any_handle = INT32_MIN;
+    static const uint64_t no_key     = UINT64_MAX;
+
+    // Take the next record that is `operation` on `handle` with the first
+    // word of its payload equal to `key` (the address, or the number of
+    // cycles), skipping up to `resync_records` records. Returns false and
+    // counts a mismatch if there is none. On success `status` is set and the
+    // cursor points to the payload after the key. The mutex must be held.
+    bool next(
+        trace::Operation operation, int32_t handle, int& status,
+        uint64_t key = no_key
+    );
+
+    // Move the cursor over the payload of a record of `operation`. Returns
+    // false if the operation is unknown.
+    bool skip(uint8_t operation);
+
+    // Consume the record. The cursor must be at its end.
+    void commit();
+
+    void get(void* data, size_t size);
+    uint8_t  get8();
+    uint32_t get32();
+
+    // Compare the next word in the payload with `value`. Counts a mismatch
+    // if they differ.
+    bool expect(uint32_t value);
+
+    // Compare the next `size` bytes in the payload with `data`. Counts a
+    // mismatch if they differ.
+    bool compare(const void* data, size_t size);
+
+    template <typename Data>
+    CAENComm_ErrorCode read(trace::Operation, int, uint32_t, Data*);
+    template <typename Data>
+    CAENComm_ErrorCode write(trace::Operation, int, uint32_t, Data);
+    template <typename Data>
+    CAENComm_ErrorCode multi(
+        trace::Operation, int, uint32_t*, int, Data*, CAENComm_ErrorCode*,
+        bool write
+    );
+    CAENComm_ErrorCode block(
+        trace::Operation, int, uint32_t, uint32_t*, int, int*
+    );
+
+    CVErrorCodes cycle(
+        trace::Operation, int32_t, uint32_t, void*, CVDataWidth, bool write
+    );
+    CVErrorCodes vme_multi(
+        trace::Operation, int32_t, uint32_t*, uint32_t*, int, CVErrorCodes*,
+        bool write
+    );
+    CVErrorCodes vme_block(
+        trace::Operation, int32_t, uint32_t, void*, int, int*, bool write
+    );
+};
+
+} // namespace caen
@@ -0,0 +1,286 @@
+#include <atomic>
+
+#include "transport.hpp"
+
+namespace caen {
+
+static NativeTransport native_transport;
+static std::atomic<Transport*> current_transport { &native_transport };
+
+Transport* Transport::current() {
+  return current_transport.load();
+};
+
+void Transport::set_current(Transport* transport) {
+  current_transport = transport ? transport : &native_transport;
+};
+
+CAENComm_ErrorCode NativeTransport::OpenDevice2(
+    CAENComm_ConnectionType type,
+    const void*             arg,
+    int                     node,
+    uint32_t                address,
+    int*                    handle
+) {
+  return CAENComm_OpenDevice2(type, arg, node, address, handle);
+};
+
+CAENComm_ErrorCode NativeTransport::CloseDevice(int handle) {
+  return CAENComm_CloseDevice(handle);
+};
+
+CAENComm_ErrorCode NativeTransport::Info(
+    int handle, CAENCOMM_INFO info, void* data
+) {
+  return CAENComm_Info(handle, info, data);
+};
+
+CAENComm_ErrorCode NativeTransport::Read16(
+    int handle, uint32_t address, uint16_t* data
+) {
+  return CAENComm_Read16(handle, address, data);
+};
+
+CAENComm_ErrorCode NativeTransport::Read32(
+    int handle, uint32_t address, uint32_t* data
+) {
+  return CAENComm_Read32(handle, address, data);
+};
+
+CAENComm_ErrorCode NativeTransport::Write16(
+    int handle, uint32_t address, uint16_t data
+) {
+  return CAENComm_Write16(handle, address, data);
+};
+
+CAENComm_ErrorCode NativeTransport::Write32(
+    int handle, uint32_t address, uint32_t data
+) {
+  return CAENComm_Write32(handle, address, data);
+};
+
+CAENComm_ErrorCode NativeTransport::MultiRead16(
+    int                 handle,
+    uint32_t*           addresses,
+    int                 ncycles,
+    uint16_t*           data,
+    CAENComm_ErrorCode* codes
+) {
+  return CAENComm_MultiRead16(handle, addresses, ncycles, data, codes);
+};
+
+CAENComm_ErrorCode NativeTransport::MultiRead32(
+    int                 handle,
+    uint32_t*           addresses,
+    int                 ncycles,
+    uint32_t*           data,
+    CAENComm_ErrorCode* codes
+) {
+  return CAENComm_MultiRead32(handle, addresses, ncycles, data, codes);
+};
+
+CAENComm_ErrorCode NativeTransport::MultiWrite16(
+    int                 handle,
+    uint32_t*           addresses,
+    int                 ncycles,
+    uint16_t*           data,
+    CAENComm_ErrorCode* codes
+) {
+  return CAENComm_MultiWrite16(handle, addresses, ncycles, data, codes);
+};
+
+CAENComm_ErrorCode NativeTransport::MultiWrite32(
+    int                 handle,
+    uint32_t*           addresses,
+    int                 ncycles,
+    uint32_t*           data,
+    CAENComm_ErrorCode* codes
+) {
+  return CAENComm_MultiWrite32(handle, addresses, ncycles, data, codes);
+};
+
+CAENComm_ErrorCode NativeTransport::BLTRead(
+    int handle, uint32_t address, uint32_t* buffer, int size, int* nwords
+) {
+  return CAENComm_BLTRead(handle, address, buffer, size, nwords);
+};
+
+CAENComm_ErrorCode NativeTransport::MBLTRead(
+    int handle, uint32_t address, uint32_t* buffer, int size, int* nwords
+) {
+  return CAENComm_MBLTRead(handle, address, buffer, size, nwords);
+};
+
+CVErrorCodes NativeTransport::Init2(
+    CVBoardTypes type, const void* arg, short node, int32_t* handle
+) {
+  return CAENVME_Init2(type, arg, node, handle);
+};
+
+CVErrorCodes NativeTransport::End(int32_t handle) {
+  return CAENVME_End(handle);
+};
+
+CVErrorCodes NativeTransport::ReadCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             data,
+    CVAddressModifier modifier,
+    CVDataWidth       width
+) {
+  return CAENVME_ReadCycle(handle, address, data, modifier, width);
+};
+
+CVErrorCodes NativeTransport::WriteCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             data,
+    CVAddressModifier modifier,
+    CVDataWidth       width
+) {
+  return CAENVME_WriteCycle(handle, address, data, modifier, width);
+};
+
+CVErrorCodes NativeTransport::RMWCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             data,
+    CVAddressModifier modifier,
+    CVDataWidth       width
+) {
+  return CAENVME_RMWCycle(handle, address, data, modifier, width);
+};
+
+CVErrorCodes NativeTransport::MultiRead(
+    int32_t            handle,
+    uint32_t*          addresses,
+    uint32_t*          buffer,
+    int                ncycles,
+    CVAddressModifier* modifiers,
+    CVDataWidth*       widths,
+    CVErrorCodes*      codes
+) {
+  return CAENVME_MultiRead(
+      handle, addresses, buffer, ncycles, modifiers, widths, codes
+  );
+};
+
+CVErrorCodes NativeTransport::MultiWrite(
+    int32_t            handle,
+    uint32_t*          addresses,
+    uint32_t*          buffer,
+    int                ncycles,
+    CVAddressModifier* modifiers,
+    CVDataWidth*       widths,
+    CVErrorCodes*      codes
+) {
+  return CAENVME_MultiWrite(
+      handle, addresses, buffer, ncycles, modifiers, widths, codes
+  );
+};
+
+CVErrorCodes NativeTransport::BLTReadCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             buffer,
+    int               size,
+    CVAddressModifier modifier,
+    CVDataWidth       width,
+    int*              count
+) {
+  return CAENVME_BLTReadCycle(
+      handle, address, buffer, size, modifier, width, count
+  );
+};
+
+CVErrorCodes NativeTransport::BLTWriteCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             buffer,
+    int               size,
+    CVAddressModifier modifier,
+    CVDataWidth       width,
+    int*              count
+) {
+  return CAENVME_BLTWriteCycle(
+      handle, address, buffer, size, modifier, width, count
+  );
+};
+
+CVErrorCodes NativeTransport::MBLTReadCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             buffer,
+    int               size,
+    CVAddressModifier modifier,
+    int*              count
+) {
+  return CAENVME_MBLTReadCycle(handle, address, buffer, size, modifier, count);
+};
+
+CVErrorCodes NativeTransport::MBLTWriteCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             buffer,
+    int               size,
+    CVAddressModifier modifier,
+    int*              count
+) {
+  return CAENVME_MBLTWriteCycle(handle, address, buffer, size, modifier, count);
+};
+
+CVErrorCodes NativeTransport::FIFOBLTReadCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             buffer,
+    int               size,
+    CVAddressModifier modifier,
+    CVDataWidth       width,
+    int*              count
+) {
+  return CAENVME_FIFOBLTReadCycle(
+      handle, address, buffer, size, modifier, width, count
+  );
+};
+
+CVErrorCodes NativeTransport::FIFOBLTWriteCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             buffer,
+    int               size,
+    CVAddressModifier modifier,
+    CVDataWidth       width,
+    int*              count
+) {
+  return CAENVME_FIFOBLTWriteCycle(
+      handle, address, buffer, size, modifier, width, count
+  );
+};
+
+CVErrorCodes NativeTransport::FIFOMBLTReadCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             buffer,
+    int               size,
+    CVAddressModifier modifier,
+    int*              count
+) {
+  return CAENVME_FIFOMBLTReadCycle(
+      handle, address, buffer, size, modifier, count
+  );
+};
+
+CVErrorCodes NativeTransport::FIFOMBLTWriteCycle(
+    int32_t           handle,
+    uint32_t          address,
+    void*             buffer,
+    int               size,
+    CVAddressModifier modifier,
+    int*              count
+) {
+  return CAENVME_FIFOMBLTWriteCycle(
+      handle, address, buffer, size, modifier, count
+  );
+};
+
+} // namespace caen
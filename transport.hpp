@@ -0,0 +1,304 @@
+#pragma once
+
+#include <CAENComm.h>
+#include <CAENVMElib.h>
+
+namespace caen {
+
+// Backend beneath Device and Bridge. The member functions mirror the CAENComm
+// and CAENVME functions of the same name (without the prefix) used for the
+// data path. NativeTransport forwards them to the CAEN libraries; Simulator
+// (see simulator.hpp) serves them from an in-process model of the crate.
+//
+// Devices and bridges use the transport that is current when they are opened,
+// see `Transport::current`. The transport must outlive them.
+class Transport {
+  public:
+    virtual ~Transport() {};
+
+    // Does this transport talk to the CAEN libraries? Bridge functions that
+    // have no counterpart below (pulsers, scalers, I/O registers, ...) are
+    // only available on native transports.
+    virtual bool native() const { return false; };
+
+    // CAENComm
+    virtual CAENComm_ErrorCode OpenDevice2(
+        CAENComm_ConnectionType type,
+        const void*             arg,
+        int                     node,
+        uint32_t                address,
+        int*                    handle
+    ) = 0;
+
+    virtual CAENComm_ErrorCode CloseDevice(int handle) = 0;
+
+    virtual CAENComm_ErrorCode Info(
+        int handle, CAENCOMM_INFO info, void* data
+    ) = 0;
+
+    virtual CAENComm_ErrorCode Read16(
+        int handle, uint32_t address, uint16_t* data
+    ) = 0;
+
+    virtual CAENComm_ErrorCode Read32(
+        int handle, uint32_t address, uint32_t* data
+    ) = 0;
+
+    virtual CAENComm_ErrorCode Write16(
+        int handle, uint32_t address, uint16_t data
+    ) = 0;
+
+    virtual CAENComm_ErrorCode Write32(
+        int handle, uint32_t address, uint32_t data
+    ) = 0;
+
+    virtual CAENComm_ErrorCode MultiRead16(
+        int handle,
+        uint32_t* addresses,
+        int ncycles,
+        uint16_t* data,
+        CAENComm_ErrorCode* codes
+    ) = 0;
+
+    virtual CAENComm_ErrorCode MultiRead32(
+        int handle,
+        uint32_t* addresses,
+        int ncycles,
+        uint32_t* data,
+        CAENComm_ErrorCode* codes
+    ) = 0;
+
+    virtual CAENComm_ErrorCode MultiWrite16(
+        int handle,
+        uint32_t* addresses,
+        int ncycles,
+        uint16_t* data,
+        CAENComm_ErrorCode* codes
+    ) = 0;
+
+    virtual CAENComm_ErrorCode MultiWrite32(
+        int handle,
+        uint32_t* addresses,
+        int ncycles,
+        uint32_t* data,
+        CAENComm_ErrorCode* codes
+    ) = 0;
+
+    // `size` is in bytes, `nwords` is set to the number of 32-bit words read
+    virtual CAENComm_ErrorCode BLTRead(
+        int handle, uint32_t address, uint32_t* buffer, int size, int* nwords
+    ) = 0;
+
+    virtual CAENComm_ErrorCode MBLTRead(
+        int handle, uint32_t address, uint32_t* buffer, int size, int* nwords
+    ) = 0;
+
+    // CAENVME
+    virtual CVErrorCodes Init2(
+        CVBoardTypes type, const void* arg, short node, int32_t* handle
+    ) = 0;
+
+    virtual CVErrorCodes End(int32_t handle) = 0;
+
+    virtual CVErrorCodes ReadCycle(
+        int32_t handle,
+        uint32_t address,
+        void* data,
+        CVAddressModifier modifier,
+        CVDataWidth width
+    ) = 0;
+
+    virtual CVErrorCodes WriteCycle(
+        int32_t handle,
+        uint32_t address,
+        void* data,
+        CVAddressModifier modifier,
+        CVDataWidth width
+    ) = 0;
+
+    virtual CVErrorCodes RMWCycle(
+        int32_t handle,
+        uint32_t address,
+        void* data,
+        CVAddressModifier modifier,
+        CVDataWidth width
+    ) = 0;
+
+    virtual CVErrorCodes MultiRead(
+        int32_t handle,
+        uint32_t* addresses,
+        uint32_t* buffer,
+        int ncycles,
+        CVAddressModifier* modifiers,
+        CVDataWidth* widths,
+        CVErrorCodes* codes
+    ) = 0;
+
+    virtual CVErrorCodes MultiWrite(
+        int32_t handle,
+        uint32_t* addresses,
+        uint32_t* buffer,
+        int ncycles,
+        CVAddressModifier* modifiers,
+        CVDataWidth* widths,
+        CVErrorCodes* codes
+    ) = 0;
+
+    // `size` and `count` are in bytes
+    virtual CVErrorCodes BLTReadCycle(
+        int32_t handle,
+        uint32_t address,
+        void* buffer,
+        int size,
+        CVAddressModifier modifier,
+        CVDataWidth width,
+        int* count
+    ) = 0;
+
+    virtual CVErrorCodes BLTWriteCycle(
+        int32_t handle,
+        uint32_t address,
+        void* buffer,
+        int size,
+        CVAddressModifier modifier,
+        CVDataWidth width,
+        int* count
+    ) = 0;
+
+    virtual CVErrorCodes MBLTReadCycle(
+        int32_t handle,
+        uint32_t address,
+        void* buffer,
+        int size,
+        CVAddressModifier modifier,
+        int* count
+    ) = 0;
+
+    virtual CVErrorCodes MBLTWriteCycle(
+        int32_t handle,
+        uint32_t address,
+        void* buffer,
+        int size,
+        CVAddressModifier modifier,
+        int* count
+    ) = 0;
+
+    virtual CVErrorCodes FIFOBLTReadCycle(
+        int32_t handle,
+        uint32_t address,
+        void* buffer,
+        int size,
+        CVAddressModifier modifier,
+        CVDataWidth width,
+        int* count
+    ) = 0;
+
+    virtual CVErrorCodes FIFOBLTWriteCycle(
+        int32_t handle,
+        uint32_t address,
+        void* buffer,
+        int size,
+        CVAddressModifier modifier,
+        CVDataWidth width,
+        int* count
+    ) = 0;
+
+    virtual CVErrorCodes FIFOMBLTReadCycle(
+        int32_t handle,
+        uint32_t address,
+        void* buffer,
+        int size,
+        CVAddressModifier modifier,
+        int* count
+    ) = 0;
+
+    virtual CVErrorCodes FIFOMBLTWriteCycle(
+        int32_t handle,
+        uint32_t address,
+        void* buffer,
+        int size,
+        CVAddressModifier modifier,
+        int* count
+    ) = 0;
+
+    // The transport used by devices and bridges opened from now on. Initially
+    // the native transport. Passing nullptr restores it.
+    static Transport* current();
+    static void set_current(Transport*);
+};
+
+// Forwards to the CAEN libraries
+class NativeTransport: public Transport {
+  public:
+    bool native() const { return true; };
+
+    CAENComm_ErrorCode OpenDevice2(
+        CAENComm_ConnectionType, const void*, int, uint32_t, int*
+    );
+    CAENComm_ErrorCode CloseDevice(int);
+    CAENComm_ErrorCode Info(int, CAENCOMM_INFO, void*);
+    CAENComm_ErrorCode Read16(int, uint32_t, uint16_t*);
+    CAENComm_ErrorCode Read32(int, uint32_t, uint32_t*);
+    CAENComm_ErrorCode Write16(int, uint32_t, uint16_t);
+    CAENComm_ErrorCode Write32(int, uint32_t, uint32_t);
+    CAENComm_ErrorCode MultiRead16(
+        int, uint32_t*, int, uint16_t*, CAENComm_ErrorCode*
+    );
+    CAENComm_ErrorCode MultiRead32(
+        int, uint32_t*, int, uint32_t*, CAENComm_ErrorCode*
+    );
+    CAENComm_ErrorCode MultiWrite16(
+        int, uint32_t*, int, uint16_t*, CAENComm_ErrorCode*
+    );
+    CAENComm_ErrorCode MultiWrite32(
+        int, uint32_t*, int, uint32_t*, CAENComm_ErrorCode*
+    );
+    CAENComm_ErrorCode BLTRead(int, uint32_t, uint32_t*, int, int*);
+    CAENComm_ErrorCode MBLTRead(int, uint32_t, uint32_t*, int, int*);
+
+    CVErrorCodes Init2(CVBoardTypes, const void*, short, int32_t*);
+    CVErrorCodes End(int32_t);
+    CVErrorCodes ReadCycle(
+        int32_t, uint32_t, void*, CVAddressModifier, CVDataWidth
+    );
+    CVErrorCodes WriteCycle(
+        int32_t, uint32_t, void*, CVAddressModifier, CVDataWidth
+    );
+    CVErrorCodes RMWCycle(
+        int32_t, uint32_t, void*, CVAddressModifier, CVDataWidth
+    );
+    CVErrorCodes MultiRead(
+        int32_t, uint32_t*, uint32_t*, int,
+        CVAddressModifier*, CVDataWidth*, CVErrorCodes*
+    );
+    CVErrorCodes MultiWrite(
+        int32_t, uint32_t*, uint32_t*, int,
+        CVAddressModifier*, CVDataWidth*, CVErrorCodes*
+    );
+    CVErrorCodes BLTReadCycle(
+        int32_t, uint32_t, void*, int, CVAddressModifier, CVDataWidth, int*
+    );
+    CVErrorCodes BLTWriteCycle(
+        int32_t, uint32_t, void*, int, CVAddressModifier, CVDataWidth, int*
+    );
+    CVErrorCodes MBLTReadCycle(
+        int32_t, uint32_t, void*, int, CVAddressModifier, int*
+    );
+    CVErrorCodes MBLTWriteCycle(
+        int32_t, uint32_t, void*, int, CVAddressModifier, int*
+    );
+    CVErrorCodes FIFOBLTReadCycle(
+        int32_t, uint32_t, void*, int, CVAddressModifier, CVDataWidth, int*
+    );
+    CVErrorCodes FIFOBLTWriteCycle(
+        int32_t, uint32_t, void*, int, CVAddressModifier, CVDataWidth, int*
+    );
+    CVErrorCodes FIFOMBLTReadCycle(
+        int32_t, uint32_t, void*, int, CVAddressModifier, int*
+    );
+    CVErrorCodes FIFOMBLTWriteCycle(
+        int32_t, uint32_t, void*, int, CVAddressModifier, int*
+    );
+};
+
+} // namespace caen
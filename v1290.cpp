@@ -1,9 +1,14 @@
 #include <algorithm>
+#include <array>
+#include <sstream>
+#include <stdexcept>
 #include <thread>
 #include <chrono>
+#include <utility>
 
 #include <cmath>
 
+#include "simd.hpp"
 #include "v1290.hpp"
 
 namespace caen {
@@ -41,24 +46,104 @@ const float V1290::dead_times[4] = {
   100e-9
 };
 
+// Registers in V1290::Registers in the order of the structure fields
+static const uint32_t registers_addresses[] = {
+  0x1000, 0x100A, 0x100C, 0x100E, 0x1010, 0x1012, 0x1022, 0x1024, 0x102C
+};
+
+static const unsigned nregisters
+  = sizeof(registers_addresses) / sizeof(*registers_addresses);
+
+// Micro controller queries eligible for the micro cache: `count`
+// consecutive opcodes (one per channel or TDC, half as many on V1290N)
+// returning `nwords` words each
+static const struct MicroQuery {
+  uint16_t opcode;
+  uint8_t  nwords;
+  uint8_t  count;
+} micro_cacheable[] = {
+  { 0x0200, 1,  1 },
+  { 0x1600, 5,  1 },
+  { 0x2300, 1,  1 },
+  { 0x2600, 1,  1 },
+  { 0x2900, 1,  1 },
+  { 0x3200, 1,  1 },
+  { 0x3400, 1,  1 },
+  { 0x3A00, 1,  1 },
+  { 0x3C00, 1,  1 },
+  { 0x4500, 2,  1 },
+  { 0x4700, 2,  4 },
+  { 0x5100, 2,  1 },
+  { 0x5300, 1, 32 },
+  { 0x6000, 1,  4 },
+  { 0x6100, 1,  1 },
+  { 0xC400, 1,  1 }
+};
+
 bool V1290::check() const {
   return oui() == OUI && id() == 1290;
 };
 
 V1290::V1290(const Connection& connection): Device(connection) {
-  version_ = static_cast<Version>(read16(0x4030));
+  load_rom({ { 0x4000, 34 } });
+  version_ = static_cast<Version>(rom(0x4030));
+
+  // Configuration registers eligible for the shadow cache
+  for (uint32_t address: registers_addresses) cache_.set_cacheable(address);
+
+  for (const MicroQuery& query: micro_cacheable)
+    for (unsigned i = 0; i < query.count; ++i)
+      micro_cache_.set_cacheable(
+          micro_key(query.opcode | i, 0), query.nwords, 1
+      );
 };
 
-V1290::Resolution V1290::resolution() const {
-  auto mode = edge_detection();
+V1290::Registers V1290::registers() const {
+  std::array<Cycle, nregisters> cycles;
+  for (unsigned i = 0; i < nregisters; ++i)
+    cycles[i] = Cycle(registers_addresses[i]);
+  batch_read(cycles);
+
+  Registers result;
+  result.control           = cycles[0].data;
+  result.interrupt_level   = cycles[1].data & 0x7;
+  result.interrupt_vector  = cycles[2].data;
+  result.geo_address       = cycles[3].data & 0x1F;
+  result.mcst_base_address = cycles[4].data;
+  result.mcst_control      = cycles[5].data & 0x3;
+  result.almost_full_level = cycles[6].data;
+  result.blt_event_number  = cycles[7].data;
+  result.out_prog          = cycles[8].data & 0x7;
+  return result;
+};
 
-  micro_write(0x2600);
-  uint16_t res = micro_read();
+void V1290::set_registers(const Registers& registers) {
+  const uint32_t values[nregisters] = {
+    registers.control,
+    registers.interrupt_level,
+    registers.interrupt_vector,
+    registers.geo_address,
+    registers.mcst_base_address,
+    registers.mcst_control,
+    registers.almost_full_level,
+    registers.blt_event_number,
+    registers.out_prog
+  };
+
+  std::array<Cycle, nregisters> cycles;
+  for (unsigned i = 0; i < nregisters; ++i)
+    cycles[i] = Cycle(registers_addresses[i], 16, values[i]);
+  batch_write(cycles);
+};
+
+V1290::Resolution V1290::resolution() const {
+  bool pair = edge_detection().pair();
+  uint16_t res = micro_query(0x2600);
 
   Resolution result;
-  if (mode & 3 == 3) {
+  if (pair) {
     result.edge  = pair_resolution[res & 7];
-    result.pulse = pair_resolution[res >> 3 & 0xF];
+    result.pulse = pair_resolution[res >> 8 & 0xF];
   } else {
     result.edge  = single_resolution[res & 3];
     result.pulse = 0;
@@ -81,49 +166,52 @@ static uint8_t find_nearest(
 };
 
 void V1290::set_resolution(float edge, float pulse) {
-  auto mode = edge_detection();
-
-  if (mode & 3 == 3) {
-    uint8_t iedge  = find_nearest(pair_resolution, 14, edge);
+  if (edge_detection().pair()) {
+    uint8_t iedge  = find_nearest(pair_resolution, 8, edge);
     uint8_t ipulse = find_nearest(pair_resolution, 14, pulse);
-    micro_write(0x2500);
+    micro_opcode(0x2500);
     micro_write(ipulse << 8 | iedge);
+    micro_store(0x2600, ipulse << 8 | iedge);
   } else {
     uint8_t iedge = find_nearest(single_resolution, 4, edge, false);
-    micro_write(0x2400);
+    micro_opcode(0x2400);
     micro_write(iedge);
+    micro_store(0x2600, iedge);
   };
 };
 
 void V1290::set_dead_time(float time) {
   uint8_t t = find_nearest(dead_times, 4, time);
-  micro_write(0x2800);
+  micro_opcode(0x2800);
   micro_write(t);
+  micro_store(0x2900, t);
 };
 
 V1290::TriggerConfiguration V1290::trigger_configuration() const {
+  uint16_t words[5];
+  micro_query(0x1600, words, 5);
+
   TriggerConfiguration result;
-  micro_write(0x1600);
-  result.window_width  = cycles_to_seconds(micro_read());
-  result.window_offset = cycles_to_seconds(micro_read());
-  result.search_margin = cycles_to_seconds(micro_read());
-  result.reject_margin = cycles_to_seconds(micro_read());
-  result.time_subtraction_enabled = micro_read() & 1;
+  result.window_width  = cycles_to_seconds(words[0]);
+  result.window_offset = cycles_to_seconds(words[1]);
+  result.search_margin = cycles_to_seconds(words[2]);
+  result.reject_margin = cycles_to_seconds(words[3]);
+  result.time_subtraction_enabled = words[4] & 1;
   return result;
 };
 
 void V1290::set_edge_detection(bool leading, bool trailing) {
   uint16_t value = 0;
   if (trailing) value |= 1;
-  if (leading)  value |= 3;
+  if (leading)  value |= 2;
 
-  micro_write(0x2200);
+  micro_opcode(0x2200);
   micro_write(value);
+  micro_store(0x2300, value);
 };
 
 int V1290::event_size() const {
-  micro_write(0x3400);
-  uint16_t code = micro_read();
+  uint16_t code = micro_query(0x3400);
   if (code == 9) return -1;
   if (code == 0) return 0;
   return 1 << code - 1;
@@ -150,8 +238,9 @@ void V1290::set_event_size(int size) {
   else
     code = log2_ceil(size) + 1;
 
-  micro_write(0x3300);
+  micro_opcode(0x3300);
   micro_write(code);
+  micro_store(0x3400, code);
 };
 
 void V1290::set_fifo_size(unsigned nwords) {
@@ -163,58 +252,91 @@ void V1290::set_fifo_size(unsigned nwords) {
   else
     code = log2_ceil(nwords) - 1;
 
-  micro_write(0x3B00);
+  micro_opcode(0x3B00);
   micro_write(code);
+  micro_store(0x3C00, code);
 };
 
 void V1290::enable_channels(uint32_t mask) {
-  micro_write(0x4400);
+  micro_opcode(0x4400);
   micro_write(mask & 0xFFFF);
   if (version_ == V1290A) micro_write(mask >> 16);
+  micro_store(0x4500, mask & 0xFFFF, 0);
+  micro_store(0x4500, mask >> 16, 1);
+  forget_tdc_channels();
 };
 
 uint32_t V1290::enabled_channels() const {
-  micro_write(0x4500);
-  uint32_t result = micro_read();
-  if (version_ == V1290A) result = micro_read() << 16 | result;
-  return result;
+  uint16_t words[2];
+  micro_query(0x4500, words, version_ == V1290A ? 2 : 1);
+  if (version_ == V1290A) return uint32_t(words[1]) << 16 | words[0];
+  return words[0];
+};
+
+void V1290::set_channel_enabled(uint8_t channel, bool enabled) {
+  micro_opcode((enabled ? 0x4000 : 0x4100) | channel);
+
+  forget_tdc_channels();
+
+  // Update the mask if it is known. The V1290N has 16 channels, its mask
+  // is a single word.
+  uint32_t low, high = 0;
+  if (
+      micro_cache_.lookup(micro_key(0x4500, 0), low)
+      && (
+          version_ != V1290A
+          || micro_cache_.lookup(micro_key(0x4500, 1), high)
+      )
+  ) {
+    uint32_t mask = high << 16 | low;
+    if (enabled)
+      mask |= uint32_t(1) << channel;
+    else
+      mask &= ~(uint32_t(1) << channel);
+    micro_store(0x4500, mask & 0xFFFF, 0);
+    micro_store(0x4500, mask >> 16, 1);
+  } else {
+    micro_cache_.invalidate(micro_key(0x4500, 0));
+  };
 };
 
 uint32_t V1290::enabled_tdc_channels(uint8_t tdc) const {
-  micro_write(0x4700 | tdc);
-  uint32_t result = micro_read();
-  result = micro_read() << 16 | result;
-  return result;
+  uint16_t words[2];
+  micro_query(0x4700 | tdc, words, 2);
+  return uint32_t(words[1]) << 16 | words[0];
 };
 
 void V1290::enable_tdc_channels(uint8_t tdc, uint32_t mask) {
-  micro_write(0x4600 | tdc);
+  micro_opcode(0x4600 | tdc);
   micro_write(mask & 0xFFFF);
   micro_write(mask >> 16);
+  micro_store(0x4700 | tdc, mask & 0xFFFF, 0);
+  micro_store(0x4700 | tdc, mask >> 16, 1);
+  forget_channels();
 };
 
 uint64_t V1290::tdc_status(uint8_t tdc) const {
-  micro_write(0x7600 | tdc);
+  micro_opcode(0x7600 | tdc);
   uint64_t result = 0;
   for (int i = 0; i < 4; ++i) result = result << 16 | micro_read();
   return result;
 };
 
 void V1290::eeprom_write(uint16_t address, uint8_t byte) {
-  micro_write(0xC000);
+  micro_opcode(0xC000);
   micro_write(address);
   micro_write(byte);
 };
 
 uint8_t V1290::eeprom_read(uint16_t address) const {
-  micro_write(0xC100);
+  micro_opcode(0xC100);
   micro_write(address);
   return micro_read();
 };
 
 V1290::MicroRevision V1290::micro_revision_date() const {
   MicroRevision result;
-  micro_write(0xC200);
+  micro_opcode(0xC200);
   result.version = micro_read();
   result.day     = micro_read();
   result.month   = micro_read();
@@ -223,19 +345,93 @@ V1290::MicroRevision V1290::micro_revision_date() const {
 };
 
 void V1290::enable_test_mode(uint32_t test_word) {
-  micro_write(0xC500);
+  micro_opcode(0xC500);
   micro_write(test_word & 0xFFFF);
   micro_write(test_word >> 16);
 };
 
 void V1290::scan_path_read(uint8_t tdc, uint16_t* path) const {
-  micro_write(0xC900 | tdc);
+  micro_opcode(0xC900 | tdc);
   for (int i = 0; i < scan_path_length; ++i) path[i] = micro_read();
 };
 
+const char* V1290::MicroTimeout::what() const noexcept {
+  if (message.empty()) {
+    std::ostringstream stream;
+    stream << "caen::V1290: micro controller timeout, opcode 0x"
+           << std::hex << std::uppercase << opcode_;
+    message = stream.str();
+  };
+  return message.c_str();
+};
+
 void V1290::micro_wait(uint8_t bit) const {
-  while (!(read16(0x1030) & bit))
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  using std::chrono::steady_clock;
+
+  const WaitStrategy& strategy = wait_strategy_;
+  steady_clock::time_point start = steady_clock::now();
+  steady_clock::time_point deadline = start + strategy.timeout;
+  std::chrono::microseconds backoff = strategy.backoff;
+
+  MicroTiming& timing = micro_statistics_[opcode_ >> 8];
+  ++timing.handshakes;
+
+  for (unsigned polls = 1;; ++polls) {
+    ++timing.polls;
+    if (read16(0x1030) & bit) break;
+    if (polls < strategy.spins) continue;
+
+    steady_clock::time_point now = steady_clock::now();
+    if (now >= deadline) {
+      ++timing.timeouts;
+      timing.total += now - start;
+      timing.max = std::max<std::chrono::nanoseconds>(timing.max, now - start);
+      throw MicroTimeout(opcode_);
+    };
+    std::this_thread::sleep_for(
+        std::min<steady_clock::duration>(backoff, deadline - now)
+    );
+    backoff = std::min(backoff * 2, strategy.max_backoff);
+  };
+
+  std::chrono::nanoseconds elapsed = steady_clock::now() - start;
+  timing.total += elapsed;
+  timing.max = std::max(timing.max, elapsed);
+};
+
+void V1290::micro_query(uint16_t opcode, uint16_t* words, unsigned n) const {
+  unsigned known = 0;
+  for (; known < n; ++known) {
+    uint32_t word;
+    if (!micro_cache_.lookup(micro_key(opcode, known), word)) break;
+    words[known] = word;
+  };
+  if (known == n) return;
+
+  micro_opcode(opcode);
+  for (unsigned i = 0; i < n; ++i) {
+    words[i] = micro_read();
+    micro_cache_.store(micro_key(opcode, i), words[i]);
+  };
+};
+
+void V1290::refresh_micro_cache() {
+  micro_cache_.set_enabled(true);
+
+  MicroProgram program = micro_program();
+  for (const MicroQuery& query: micro_cacheable) {
+    unsigned count = query.count;
+    unsigned nwords = query.nwords;
+    if (version_ != V1290A) {
+      count = (count + 1) / 2;
+      if (query.opcode == 0x4500) nwords = 1;
+    };
+    for (unsigned i = 0; i < count; ++i) program.query(query.opcode | i, nwords);
+  };
+
+  // `run` stores the results in the cache
+  micro_cache_.invalidate();
+  run(program);
 };
 
 uint16_t V1290::micro_read() const {
@@ -244,16 +440,1029 @@ uint16_t V1290::micro_read() const {
 };
 
 void V1290::micro_write(uint16_t value) {
-  micro_wait(1);
-  write16(0x102E, value);
+  // An operation interrupted between its words, e.g., by a timeout, leaves
+  // the settings unknown
+  try {
+    micro_wait(1);
+    write16(0x102E, value);
+  } catch (...) {
+    micro_cache_.invalidate();
+    throw;
+  };
 };
 
 void V1290::micro_write(uint16_t value) const {
   const_cast<V1290*>(this)->micro_write(value);
 };
 
-int16_t V1290::seconds_to_cycles(float seconds) const {
+int16_t V1290::seconds_to_cycles(float seconds) {
   return std::round(seconds / 25e-9);
 };
 
+V1290::MicroProgram& V1290::MicroProgram::operation(
+    uint16_t opcode, std::initializer_list<uint16_t> operands
+) {
+  words.push_back({ true, opcode, 0 });
+  for (uint16_t operand: operands) words.push_back({ false, operand, 0 });
+  return *this;
+};
+
+unsigned V1290::MicroProgram::query(uint16_t opcode, unsigned nresults) {
+  words.push_back({ true, opcode, nresults });
+  return nqueries++;
+};
+
+V1290::MicroProgram& V1290::MicroProgram::set_dead_time(float time) {
+  return operation(0x2800, { find_nearest(dead_times, 4, time) });
+};
+
+V1290::MicroProgram& V1290::MicroProgram::set_event_size(int size) {
+  uint16_t code;
+  if (size < 0 || size > 128)
+    code = 9;
+  else if (size == 0)
+    code = 0;
+  else
+    code = log2_ceil(size) + 1;
+  return operation(0x3300, { code });
+};
+
+V1290::MicroProgram& V1290::MicroProgram::set_fifo_size(unsigned nwords) {
+  uint16_t code;
+  if (nwords <= 2)
+    code = 0;
+  else if (nwords >= 256)
+    code = 7;
+  else
+    code = log2_ceil(nwords) - 1;
+  return operation(0x3B00, { code });
+};
+
+V1290::MicroProgram& V1290::MicroProgram::enable_channels(uint32_t mask) {
+  if (version_ == V1290A)
+    return operation(
+        0x4400, { uint16_t(mask & 0xFFFF), uint16_t(mask >> 16) }
+    );
+  return operation(0x4400, { uint16_t(mask & 0xFFFF) });
+};
+
+V1290::TriggerConfiguration
+V1290::MicroProgram::Results::trigger_configuration(unsigned query) const {
+  const uint16_t* w = (*this)[query];
+  TriggerConfiguration result;
+  result.window_width  = cycles_to_seconds(w[0]);
+  result.window_offset = cycles_to_seconds(w[1]);
+  result.search_margin = cycles_to_seconds(w[2]);
+  result.reject_margin = cycles_to_seconds(w[3]);
+  result.time_subtraction_enabled = w[4] & 1;
+  return result;
+};
+
+uint32_t V1290::MicroProgram::Results::channels(unsigned query) const {
+  const uint16_t* w = (*this)[query];
+  return size(query) > 1 ? uint32_t(w[1]) << 16 | w[0] : w[0];
+};
+
+uint64_t V1290::MicroProgram::Results::tdc_status(unsigned query) const {
+  const uint16_t* w = (*this)[query];
+  uint64_t result = 0;
+  for (int i = 0; i < 4; ++i) result = result << 16 | w[i];
+  return result;
+};
+
+V1290::MicroProgram::Results V1290::run(const MicroProgram& program) {
+  MicroProgram::Results results;
+  results.offsets.reserve(program.nqueries);
+
+  // Handshake bits known from the last batched read; 0 when unknown
+  uint16_t handshake = 0;
+
+  // Counts a handshake that needed no polling
+  auto folded = [this]() { ++micro_statistics_[opcode_ >> 8].handshakes; };
+
+  // A program interrupted by a timeout may have written some settings
+  try {
+    for (const MicroProgram::Step& step: program.words) {
+      if (step.opcode) opcode_ = step.word;
+
+      if (handshake & 1)
+        folded();
+      else
+        micro_wait(1);
+      write16(0x102E, step.word);
+      handshake = 0;
+
+      if (step.nresults) results.offsets.push_back(results.words.size());
+      for (unsigned i = 0; i < step.nresults; ++i) {
+        if (handshake & 2)
+          folded();
+        else
+          micro_wait(2);
+        std::array<Cycle, 2> cycles = { Cycle(0x102E), Cycle(0x1030) };
+        batch_read(cycles);
+        results.words.push_back(cycles[0].data);
+        handshake = cycles[1].data & 3;
+      };
+    };
+  } catch (...) {
+    micro_cache_.invalidate();
+    throw;
+  };
+
+  // Keep the micro cache coherent: the settings written by the program are
+  // unknown, the results of the queries that follow them are known
+  unsigned query = 0;
+  for (const MicroProgram::Step& step: program.words) {
+    if (!step.opcode) continue;
+    if (!step.nresults) {
+      micro_cache_.invalidate();
+      continue;
+    };
+    const uint16_t* words = results[query++];
+    for (unsigned i = 0; i < step.nresults; ++i)
+      micro_cache_.store(micro_key(step.word, i), words[i]);
+  };
+
+  return results;
+};
+
+bool V1290::Health::ok() const {
+  if (!failure.empty()) return false;
+  for (unsigned i = 0; i < ntdcs; ++i)
+    if (!tdcs[i].dll_locked || tdcs[i].errors.value_) return false;
+  return true;
+};
+
+bool V1290::HealthReport::ok() const {
+  for (const Health& board: boards) if (!board.ok()) return false;
+  return true;
+};
+
+V1290::Health V1290::health() {
+  auto start = std::chrono::steady_clock::now();
+
+  Health result;
+  result.board = metrics_name();
+  result.ntdcs = version_ == V1290A ? 4 : 2;
+
+  MicroProgram program = micro_program();
+  unsigned errors = program.internal_errors();
+  unsigned queries[4][3];
+  for (unsigned i = 0; i < result.ntdcs; ++i) {
+    queries[i][0] = program.dll_locked(i);
+    queries[i][1] = program.tdc_errors(i);
+    queries[i][2] = program.tdc_status(i);
+  };
+  MicroProgram::Results results = run(program);
+
+  result.internal_errors = results[errors][0];
+  for (unsigned i = 0; i < result.ntdcs; ++i) {
+    result.tdcs[i].dll_locked = results[queries[i][0]][0] & 1;
+    result.tdcs[i].errors     = results[queries[i][1]][0];
+    result.tdcs[i].status     = results.tdc_status(queries[i][2]);
+  };
+
+  result.time = std::chrono::steady_clock::now() - start;
+  return result;
+};
+
+V1290::HealthReport V1290::health_scan(const std::vector<V1290*>& boards) {
+  auto start = std::chrono::steady_clock::now();
+
+  // Indices of the boards by link
+  std::map<std::string, std::vector<size_t>> links;
+  for (size_t i = 0; i < boards.size(); ++i)
+    links[boards[i]->link()].push_back(i);
+
+  HealthReport report;
+  report.boards.resize(boards.size());
+  report.nlinks = links.size();
+
+  // Each worker fills in the reports of its own boards
+  auto scan = [&](const std::vector<size_t>& indices) {
+    for (size_t i: indices) {
+      Health& health = report.boards[i];
+      try {
+        health = boards[i]->health();
+      } catch (const std::exception& e) {
+        health.board   = boards[i]->metrics_name();
+        health.failure = e.what();
+      };
+    };
+  };
+
+  std::vector<std::thread> workers;
+  workers.reserve(links.size());
+  for (const auto& link: links) workers.emplace_back(scan, link.second);
+  for (std::thread& worker: workers) worker.join();
+
+  report.time = std::chrono::steady_clock::now() - start;
+  return report;
+};
+
+uint32_t V1290::readout_events(
+    uint32_t* buffer, uint32_t size, std::vector<uint16_t>& sizes
+) {
+  // Pop the entries of the stored events in one batched transaction
+  unsigned nstored = event_fifo_stored();
+  if (nstored) {
+    std::vector<Cycle> cycles(nstored, Cycle(0x1038, 32));
+    batch_read(cycles);
+    for (const Cycle& cycle: cycles)
+      pending_events_.push_back(cycle.data & 0xFFFF);
+  };
+
+  uint32_t nwords = 0;
+  unsigned nevents = 0;
+  for (uint16_t event: pending_events_) {
+    if (nwords + event > size) break;
+    nwords += event;
+    ++nevents;
+  };
+  if (nevents == 0) return 0;
+
+  // MBLT moves 64-bit words: an odd word is read with a single cycle.
+  // CAENComm block sizes are in bytes.
+  uint32_t nblock = nwords & ~1U;
+  uint32_t nread = 0;
+  CAENComm_ErrorCode status = CAENComm_Success;
+  if (nblock)
+    status = try_mblt_read(0, buffer, nblock * sizeof(uint32_t), nread);
+  if (status == CAENComm_Success && nread == nblock && nwords > nblock)
+    status = try_read32(0, buffer[nread++]);
+
+  // The words transferred before the error are lost, so the pending sizes
+  // are out of step with the data left on the board, as on a short transfer
+  if (status != CAENComm_Success) {
+    pending_events_.clear();
+    if (metrics::enabled())
+      account_readout(nwords * sizeof(uint32_t), nread, status);
+    throw Error(status);
+  };
+
+  // Deliver the events read entirely. A short transfer means the output
+  // buffer and the Event FIFO are out of step: forget the pending sizes.
+  uint32_t ndelivered = 0;
+  unsigned ndelivered_events = 0;
+  for (; nevents; --nevents) {
+    uint16_t event = pending_events_.front();
+    if (ndelivered + event > nread) break;
+    ndelivered += event;
+    ++ndelivered_events;
+    sizes.push_back(event);
+    pending_events_.pop_front();
+  };
+  if (nread < nwords) pending_events_.clear();
+
+  if (metrics::enabled())
+    account_readout(
+        nwords * sizeof(uint32_t), nread, status, ndelivered_events
+    );
+  return ndelivered;
+};
+
+void V1290::Decoded::Hits::resize(size_t n) {
+  event.resize(n);
+  channel.resize(n);
+  trailing.resize(n);
+  time.resize(n);
+};
+
+void V1290::Decoded::Pulses::resize(size_t n) {
+  event.resize(n);
+  channel.resize(n);
+  leading.resize(n);
+  width.resize(n);
+};
+
+void V1290::Decoded::clear() {
+  hits.resize(0);
+  pulses.resize(0);
+  events.count.clear();
+  events.geo.clear();
+  events.ettt.clear();
+  events.nwords.clear();
+  events.status.clear();
+  errors.event.clear();
+  errors.tdc.clear();
+  errors.errors.clear();
+};
+
+// Decode a word other than a measurement
+static void decode_word(uint32_t word, V1290::Decoded& decoded) {
+  V1290::Decoded::Events& events = decoded.events;
+  switch (word >> 27) {
+    case V1290::Packet::Type::GlobalHeader: {
+      V1290::GlobalHeader header(word);
+      events.count.push_back(header.event());
+      events.geo.push_back(header.geo());
+      events.ettt.push_back(0);
+      events.nwords.push_back(0);
+      events.status.push_back(0);
+      break;
+    };
+    case V1290::Packet::Type::ExtendedTriggerTimeTag:
+      if (events.size())
+        events.ettt.back() = V1290::ExtendedTriggerTimeTag(word).value();
+      break;
+    case V1290::Packet::Type::GlobalTrailer:
+      if (events.size()) {
+        events.nwords.back() = V1290::GlobalTrailer(word).nwords();
+        events.status.back() = word >> 24 & 0x7;
+      };
+      break;
+    case V1290::Packet::Type::TDCError: {
+      V1290::TDCError error(word);
+      decoded.errors.event.push_back(events.size() - 1);
+      decoded.errors.tdc.push_back(error.tdc());
+      decoded.errors.errors.push_back(error.errors());
+      break;
+    };
+  };
+};
+
+void V1290::decode_scalar(
+    const uint32_t* data, size_t nwords, Decoded& decoded
+) {
+  Decoded::Hits& hits = decoded.hits;
+  for (size_t i = 0; i < nwords; ++i) {
+    uint32_t word = data[i];
+    if (word >> 27 != Packet::Type::TDCMeasurement) {
+      decode_word(word, decoded);
+      continue;
+    };
+    hits.event.push_back(decoded.events.size() - 1);
+    hits.channel.push_back(word >> 21 & 0x1F);
+    hits.trailing.push_back(word >> 26 & 1);
+    hits.time.push_back(word & 0x1FFFFF);
+  };
+};
+
+// Stores single mode measurements into the hit arrays
+class HitStore {
+  public:
+    HitStore(V1290::Decoded& decoded): hits(decoded.hits) {};
+
+    size_t size() const { return hits.size(); };
+    void resize(size_t n) { hits.resize(n); };
+
+    void set(size_t i, uint32_t word, uint32_t event) {
+      hits.event[i]    = event;
+      hits.channel[i]  = word >> 21 & 0x1F;
+      hits.trailing[i] = word >> 26 & 1;
+      hits.time[i]     = word & 0x1FFFFF;
+    };
+
+    void store(size_t i, simd::Vector words, uint32_t event) {
+      using namespace simd;
+      store_bytes(
+          &hits.channel[i], bit_and(shift_right<21>(words), broadcast(0x1F))
+      );
+      store_bytes(
+          &hits.trailing[i], bit_and(shift_right<26>(words), broadcast(1))
+      );
+      simd::store(&hits.event[i], broadcast(event));
+      simd::store(&hits.time[i], bit_and(words, broadcast(0x1FFFFF)));
+    };
+
+  private:
+    V1290::Decoded::Hits& hits;
+};
+
+// Picoseconds per unit of V1290::pair_resolution
+static constexpr uint32_t pair_picoseconds[14] = {
+  100, 200, 400, 800, 1600, 3200, 6250, 12500,
+  25000, 50000, 100000, 200000, 400000, 800000
+};
+
+// Stores pair mode measurements into the pulse arrays, converting the
+// leading edge times and widths with resolutions known at compile time
+template <unsigned Edge, unsigned Width> class PulseStore {
+  public:
+    static constexpr uint32_t edge  = pair_picoseconds[Edge];
+    static constexpr uint32_t width = pair_picoseconds[Width];
+
+    PulseStore(V1290::Decoded& decoded): pulses(decoded.pulses) {};
+
+    size_t size() const { return pulses.size(); };
+    void resize(size_t n) { pulses.resize(n); };
+
+    void set(size_t i, uint32_t word, uint32_t event) {
+      pulses.event[i]   = event;
+      pulses.channel[i] = word >> 21 & 0x1F;
+      pulses.leading[i] = (word & 0xFFF) * edge;
+      pulses.width[i]   = (word >> 12 & 0x7F) * width;
+    };
+
+    void store(size_t i, simd::Vector words, uint32_t event) {
+      using namespace simd;
+      store_bytes(
+          &pulses.channel[i], bit_and(shift_right<21>(words), broadcast(0x1F))
+      );
+      simd::store(&pulses.event[i], broadcast(event));
+      simd::store(
+          &pulses.leading[i],
+          multiply(bit_and(words, broadcast(0xFFF)), broadcast(edge))
+      );
+      simd::store(
+          &pulses.width[i],
+          multiply(
+              bit_and(shift_right<12>(words), broadcast(0x7F)),
+              broadcast(width)
+          )
+      );
+    };
+
+  private:
+    V1290::Decoded::Pulses& pulses;
+};
+
+// Decode several words at a time, storing the measurements with `Store`
+template <typename Store>
+static void decode_blocks(
+    const uint32_t* data, size_t nwords, V1290::Decoded& decoded
+) {
+  using namespace simd;
+  using Type = V1290::Packet::Type;
+
+  // Grow the arrays to the worst case once, plus the slack needed by
+  // full-width stores, and trim them at the end
+  Store measurements(decoded);
+  size_t n = measurements.size();
+  measurements.resize(n + nwords + width);
+
+  auto decode = [&](uint32_t word) {
+    if (word >> 27 == Type::TDCMeasurement)
+      measurements.set(n++, word, decoded.events.size() - 1);
+    else
+      decode_word(word, decoded);
+  };
+
+  const Vector measurement = broadcast(Type::TDCMeasurement);
+  const Vector header      = broadcast(Type::GlobalHeader);
+
+  size_t i = 0;
+  for (; i + width <= nwords; i += width) {
+    Vector words = load(data + i);
+    Vector types = shift_right<27>(words);
+
+    // A global header changes the event of the measurements that follow
+    if (equal(types, header)) {
+      for (unsigned j = 0; j < width; ++j) decode(data[i + j]);
+      continue;
+    };
+
+    Mask mask = equal(types, measurement);
+    if (mask) {
+      measurements.store(
+          n, left_pack(words, mask), decoded.events.size() - 1
+      );
+      n += count(mask);
+    };
+
+    for (Mask others = ~mask & all; others; others &= others - 1)
+      decode_word(data[i + first(others)], decoded);
+  };
+  for (; i < nwords; ++i) decode(data[i]);
+
+  measurements.resize(n);
+};
+
+void V1290::decode(const uint32_t* data, size_t nwords, Decoded& decoded) {
+  decode_blocks<HitStore>(data, nwords, decoded);
+};
+
+typedef void (*PairDecoder)(const uint32_t*, size_t, V1290::Decoded&);
+
+// Decoders by edge (3 bits) and width (14 values) resolution setting
+template <size_t... I>
+static constexpr std::array<PairDecoder, sizeof...(I)> pair_decoders(
+    std::index_sequence<I...>
+) {
+  return {{ &decode_blocks<PulseStore<I / 14, I % 14>>... }};
+};
+
+void V1290::decode_pairs(
+    const uint32_t* data,
+    size_t nwords,
+    Resolution resolution,
+    Decoded& decoded
+) {
+  static constexpr auto decoders = pair_decoders(
+      std::make_index_sequence<8 * 14>()
+  );
+
+  uint8_t edge  = find_nearest(pair_resolution, 8, resolution.edge);
+  uint8_t width = find_nearest(pair_resolution, 14, resolution.pulse);
+  decoders[edge * 14 + width](data, nwords, decoded);
+};
+
+const char* V1290::simd_instruction_set() {
+  return simd::instruction_set;
+};
+
+void V1290::Compensation::apply(Decoded::Hits& hits, size_t from) const {
+  using namespace simd;
+  if (table_.empty()) return;
+
+  const int8_t* table = table_.data();
+  const Vector bin  = broadcast(nbins - 1);
+  const Vector mask = broadcast(0x1FFFFF);
+
+  size_t i = from;
+  for (; i + width <= hits.size(); i += width) {
+    Vector time   = load(&hits.time[i]);
+    Vector offset = add(
+        shift_left<8>(load_bytes(&hits.channel[i])), bit_and(time, bin)
+    );
+    store(&hits.time[i], bit_and(add(time, gather_bytes(table, offset)), mask));
+  };
+  for (; i < hits.size(); ++i)
+    hits.time[i] = correct(hits.channel[i], hits.time[i]);
+};
+
+void V1290::read_compensation() {
+  Compensation compensation;
+  compensation.table_.resize(
+      Compensation::nchannels * Compensation::nbins + 3
+  );
+  unsigned nchannels = version_ == V1290A ? 32 : 16;
+
+  // The SRAM is readable only with the readout of the tables enabled
+  Control c = control();
+  bool restore = !c.read_compensation_sram_enabled();
+  if (restore) {
+    Control enabled = c;
+    enabled.set_read_compensation_sram_enabled(true);
+    set_control(enabled);
+  };
+
+  try {
+    std::array<Cycle, Compensation::nbins> cycles;
+    for (unsigned channel = 0; channel < nchannels; ++channel) {
+      set_compensation_sram_page(channel);
+      for (unsigned i = 0; i < Compensation::nbins; ++i)
+        cycles[i] = Cycle(0x8000 + 2 * i);
+      batch_read(cycles);
+      for (unsigned i = 0; i < Compensation::nbins; ++i)
+        compensation.table_[channel * Compensation::nbins + i] =
+          static_cast<int8_t>(cycles[i].data & 0xFF);
+    };
+  } catch (...) {
+    if (restore) set_control(c);
+    throw;
+  };
+  if (restore) set_control(c);
+
+  compensation_ = std::move(compensation);
+};
+
+// Half the range of the 21-bit hit times: the tolerance of the unwrapping
+static const int64_t half_range = 1 << 20;
+
+V1290::Stream::Stream(V1290& tdc, size_t capacity):
+  tdc_(tdc),
+  resolution_(tdc.resolution().edge),
+  words_(32 * 1024)
+{
+  size_t n = 1;
+  while (n < capacity) n <<= 1;
+  ring_.resize(n);
+};
+
+void V1290::Stream::set_window(float offset, float width) {
+  offset_ = std::llround(offset / resolution_);
+  width_  = std::llround(width / resolution_);
+};
+
+void V1290::Stream::reset() {
+  head_ = 0;
+  size_ = 0;
+  triggers_.clear();
+  started_ = false;
+  last_    = 0;
+  time_    = 0;
+  latest_  = 0;
+};
+
+size_t V1290::Stream::poll() {
+  size_t nhits = 0;
+  uint32_t size = words_.size() * sizeof(uint32_t);
+  uint32_t nwords;
+  do {
+    CAENComm_ErrorCode status = tdc_.try_readout(words_.data(), size, nwords);
+    if (status != CAENComm_Success) throw Error(status);
+    ++statistics_.readouts;
+    statistics_.words += nwords;
+
+    for (uint32_t i = 0; i < nwords; ++i) {
+      uint32_t word = words_[i];
+      if (word >> 27 == Packet::Type::TDCError) ++statistics_.errors;
+      if (word >> 27 != Packet::Type::TDCMeasurement) continue;
+
+      TDCMeasurement measurement(word);
+      uint32_t t = measurement.value();
+      if (started_) {
+        int64_t delta = (t - last_) & 0x1FFFFF;
+        time_ += delta < half_range ? delta : delta - 2 * half_range;
+      } else {
+        time_    = t;
+        started_ = true;
+      };
+      last_   = t;
+      latest_ = std::max(latest_, time_);
+
+      Hit hit {
+        uint64_t(time_), measurement.channel(), measurement.trailing()
+      };
+      push(hit);
+      ++nhits;
+      if (!hit.trailing && triggers_mask_ >> hit.channel & 1) {
+        triggers_.push_back(hit);
+        ++statistics_.triggers;
+      };
+    };
+  } while (nwords * sizeof(uint32_t) == size);
+
+  statistics_.hits += nhits;
+  drop();
+  return nhits;
+};
+
+void V1290::Stream::push(const Hit& hit) {
+  size_t mask = ring_.size() - 1;
+  if (size_ == ring_.size()) {
+    head_ = head_ + 1 & mask;
+    --size_;
+    ++statistics_.dropped;
+  };
+  ring_[head_ + size_ & mask] = hit;
+  ++size_;
+};
+
+void V1290::Stream::drop() {
+  // Triggers yet to be read may come late by up to the unwrapping tolerance
+  int64_t before = triggers_.empty()
+    ? latest_ + offset_ - half_range
+    : int64_t(triggers_.front().time) + offset_;
+
+  size_t mask = ring_.size() - 1;
+  while (size_ && int64_t(ring_[head_].time) < before) {
+    head_ = head_ + 1 & mask;
+    --size_;
+  };
+};
+
+bool V1290::Stream::next(Trigger& trigger) {
+  if (triggers_.empty()) return false;
+
+  const Hit& first = triggers_.front();
+  int64_t begin = int64_t(first.time) + offset_;
+  int64_t end   = begin + width_;
+  if (latest_ < end) return false;
+
+  trigger.time    = first.time;
+  trigger.channel = first.channel;
+  trigger.hits.clear();
+
+  // The hits are in time order but for the reordering by the TDCs
+  size_t mask = ring_.size() - 1;
+  for (size_t i = 0; i < size_; ++i) {
+    const Hit& hit = ring_[head_ + i & mask];
+    int64_t time = hit.time;
+    if (time >= end + half_range) break;
+    if (time >= begin && time < end) trigger.hits.push_back(hit);
+  };
+
+  triggers_.pop_front();
+  drop();
+  return true;
+};
+
+V1290::Generator::Generator(const Settings& settings):
+  settings_(settings),
+  ntdcs_(settings.version == V1290A ? 4 : 2),
+  state_(settings.seed),
+  hits_(4 * settings.max_hits)
+{
+  unsigned nchannels = ntdcs_ * 8;
+  double total = 0;
+  for (unsigned i = 0; i < nchannels; ++i) total += settings.occupancy[i];
+  if (!(total > 0))
+    throw std::invalid_argument("V1290::Generator: no channel occupied");
+  if (!(settings.trigger_rate > 0))
+    throw std::invalid_argument("V1290::Generator: trigger rate not positive");
+
+  // Poisson multiplicity truncated at max_hits, and channels by occupancy
+  double p = std::exp(-settings.multiplicity);
+  double cdf = p;
+  unsigned k = 0;
+  double channel_cdf = settings.occupancy[0] / total;
+  unsigned channel = 0;
+  for (unsigned i = 0; i < multiplicities_.size(); ++i) {
+    double u = (i + 0.5) / multiplicities_.size();
+    while (cdf < u && k < settings.max_hits) {
+      ++k;
+      p *= settings.multiplicity / k;
+      cdf += p;
+    };
+    multiplicities_[i] = k;
+
+  };
+
+  for (unsigned i = 0; i < channels_.size(); ++i) {
+    double u = (i + 0.5) / channels_.size();
+    while (channel_cdf < u && channel < nchannels - 1)
+      channel_cdf += settings.occupancy[++channel] / total;
+    channels_[i] = channel;
+  };
+
+  period_ = std::min(
+      double(0xFFFFFFFFU),
+      std::max(1.0, std::round(1 / (settings.trigger_rate * 25e-9)))
+  );
+  error_threshold_ = std::min(settings.error_rate, 1.0) * 0xFFFFFFFFU;
+
+  unsigned edges = settings.both_edges ? 2 : 1;
+  max_event_ = 2 + ntdcs_ * 3 + settings.max_hits * edges
+             + settings.ettt_enabled;
+};
+
+size_t V1290::Generator::generate(uint32_t* data, size_t nwords) {
+  const Settings& s = settings_;
+  size_t n = 0;
+  while (n + max_event_ <= nwords) {
+    uint32_t* begin = data + n;
+    uint32_t* p = begin;
+
+    if (s.ettt_enabled) time_ += period_ / 2 + random() % period_;
+    uint32_t tag = time_;
+    uint16_t id  = event_ & 0xFFF;
+    *p++ = GlobalHeader(s.geo, event_++);
+
+    // Measurements grouped by TDC, 8 channels each
+    unsigned nhits = multiplicities_[random() & 0xFFF];
+    unsigned counts[4] = {};
+    uint64_t r = 0;
+    for (unsigned i = 0; i < nhits; ++i) {
+      // Two hits per random number: 10 bits of channel, 21 bits of time
+      r = i & 1 ? r >> 32 : random();
+      uint8_t channel = channels_[r & 0x3FF];
+      uint32_t* hits = &hits_[(channel >> 3) * s.max_hits];
+      hits[counts[channel >> 3]++] =
+        TDCMeasurement(r >> 10 & 0x1FFFFF, channel, false);
+    };
+
+    bool errors = false;
+    for (unsigned tdc = 0; tdc < ntdcs_; ++tdc) {
+      uint32_t* block = p;
+      if (s.tdc_headers_enabled) *p++ = TDCHeader(tag & 0xFFF, id, tdc);
+
+      const uint32_t* hits = &hits_[tdc * s.max_hits];
+      for (unsigned i = 0; i < counts[tdc]; ++i) {
+        *p++ = hits[i];
+        if (s.both_edges) {
+          // A pulse of up to 1024 units, from other bits of the time
+          TDCMeasurement trailing(hits[i]);
+          trailing.set_value(trailing.value() + (hits[i] >> 8 & 0x3FF) + 1);
+          trailing.set_trailing(true);
+          *p++ = trailing;
+        };
+      };
+
+      uint64_t r = random();
+      if (uint32_t(r) < error_threshold_) {
+        *p++ = TDCError((r >> 32 & 0x7FFF) | 1, tdc);
+        errors = true;
+      };
+
+      if (s.tdc_headers_enabled) {
+        *p = TDCTrailer(p - block + 1, id, tdc);
+        ++p;
+      };
+    };
+
+    if (s.ettt_enabled) *p++ = ExtendedTriggerTimeTag(tag >> 5, 0);
+    uint8_t geo = s.ettt_enabled ? tag & 0x1F : s.geo;
+    *p = GlobalTrailer(geo, p - begin + 1, errors, false, false);
+    n += p - begin + 1;
+  };
+  return n;
+};
+
+V1290::Parser::Parser(size_t max_event): max_event_(max_event) {
+  partial_.reserve(max_event);
+};
+
+void V1290::Parser::feed(const uint32_t* data, size_t nwords) {
+  data_     = data;
+  size_     = nwords;
+  position_ = 0;
+};
+
+void V1290::Parser::reset() {
+  partial_.clear();
+  discarding_ = false;
+  completed_  = false;
+  feed(nullptr, 0);
+};
+
+bool V1290::Parser::next(Event& event) {
+  // The event completed by the previous call is no longer viewed
+  if (completed_) {
+    partial_.clear();
+    completed_ = false;
+  };
+
+  // Complete the event kept from the previous data
+  if (!partial_.empty()) {
+    const uint32_t* begin = data_ + position_;
+    const uint32_t* end   = data_ + size_;
+    const uint32_t* p     = begin;
+    bool complete = false;
+    for (; p != end; ++p) {
+      uint8_t type = *p >> 27;
+      if (type == Packet::Type::GlobalHeader) {
+        complete = true;
+        break;
+      };
+      if (type == Packet::Type::GlobalTrailer) {
+        complete = true;
+        ++p;
+        break;
+      };
+    };
+    position_ = p - data_;
+    keep(begin, p);
+    if (complete && !partial_.empty()) {
+      scan(partial_.data(), partial_.data() + partial_.size(), event);
+      completed_ = true;
+      return true;
+    };
+    if (!complete) return false;
+  };
+
+  // Skip to the next global header
+  for (; position_ < size_; ++position_) {
+    uint8_t type = data_[position_] >> 27;
+    if (type == Packet::Type::GlobalHeader) break;
+    if (type != Packet::Type::Filler && !discarding_)
+      ++statistics_.stray_words;
+  };
+  if (position_ == size_) return false;
+  discarding_ = false;
+
+  const uint32_t* begin = data_ + position_;
+  const uint32_t* end   = data_ + size_;
+  for (const uint32_t* p = begin + 1; p != end; ++p) {
+    uint8_t type = *p >> 27;
+    if (type == Packet::Type::GlobalTrailer)
+      ++p;
+    else if (type != Packet::Type::GlobalHeader)
+      continue;
+    position_ = p - data_;
+    scan(begin, p, event);
+    return true;
+  };
+
+  // The rest of the event is yet to be read out
+  position_ = size_;
+  keep(begin, end);
+  return false;
+};
+
+// Append the words of an incomplete event, dropping the event if too long
+void V1290::Parser::keep(const uint32_t* begin, const uint32_t* end) {
+  if (discarding_) return;
+  for (const uint32_t* p = begin; p != end; ++p) {
+    if (*p >> 27 == Packet::Type::Filler) continue;
+    if (partial_.size() == max_event_) {
+      ++statistics_.oversized;
+      partial_.clear();
+      discarding_ = true;
+      return;
+    };
+    partial_.push_back(*p);
+  };
+};
+
+void V1290::Parser::scan(
+    const uint32_t* begin, const uint32_t* end, Event& event
+) {
+  event.header   = GlobalHeader(*begin);
+  event.trailer  = GlobalTrailer();
+  event.ettt     = ExtendedTriggerTimeTag();
+  event.has_ettt = false;
+  event.ntdcs    = 0;
+  event.problems = 0;
+  event.begin    = begin;
+  event.end      = end;
+
+  // TDC event IDs count triggers modulo 4096, as the event counter does
+  uint16_t id = event.header.event() & 0xFFF;
+  bool trailer = false;
+  unsigned nwords = 0;
+  TDCBlock* block = nullptr; // open
+  unsigned block_words = 0;
+
+  for (const uint32_t* p = begin; p != end; ++p) {
+    uint8_t type = *p >> 27;
+    if (type == Packet::Type::Filler) continue;
+    ++nwords;
+    ++block_words;
+
+    switch (type) {
+      case Packet::Type::TDCHeader:
+        if (block) {
+          event.problems |= Event::Structure;
+          block->end = p;
+        };
+        block = nullptr;
+        if (event.ntdcs == Event::max_tdcs) {
+          event.problems |= Event::Structure;
+          break;
+        };
+        block = &event.tdcs[event.ntdcs++];
+        block->header  = TDCHeader(*p);
+        block->trailer = TDCTrailer();
+        block->begin   = p + 1;
+        block->end     = end;
+        block_words    = 1;
+        if (block->header.event() != id) event.problems |= Event::EventID;
+        break;
+
+      case Packet::Type::TDCTrailer:
+        if (!block) {
+          event.problems |= Event::Structure;
+          break;
+        };
+        block->trailer = TDCTrailer(*p);
+        block->end     = p;
+        if (block->trailer.nwords() != block_words)
+          event.problems |= Event::TDCWordCount;
+        if (block->trailer.event() != block->header.event())
+          event.problems |= Event::EventID;
+        block = nullptr;
+        break;
+
+      case Packet::Type::ExtendedTriggerTimeTag:
+        event.ettt     = ExtendedTriggerTimeTag(*p);
+        event.has_ettt = true;
+        break;
+
+      case Packet::Type::GlobalTrailer:
+        event.trailer = GlobalTrailer(*p);
+        trailer       = true;
+        break;
+    };
+  };
+
+  if (block) event.problems |= Event::Structure;
+  if (!trailer)
+    event.problems |= Event::Truncated;
+  else if (event.trailer.nwords() != nwords)
+    event.problems |= Event::WordCount;
+
+  ++statistics_.events;
+  if (event.problems) {
+    ++statistics_.corrupted;
+    if (event.problems & Event::Truncated)    ++statistics_.truncated;
+    if (event.problems & Event::WordCount)    ++statistics_.word_count;
+    if (event.problems & Event::TDCWordCount) ++statistics_.tdc_word_count;
+    if (event.problems & Event::EventID)      ++statistics_.event_id;
+    if (event.problems & Event::Structure)    ++statistics_.structure;
+  };
+};
+
+CAENComm_ErrorCode V1290::try_readout(
+    uint32_t* buffer, uint32_t size, uint32_t& nwords
+) noexcept {
+  CAENComm_ErrorCode status = try_mblt_read(0, buffer, size, nwords);
+  if (metrics::enabled())
+    account_readout(
+        size, nwords, status,
+        status == CAENComm_Success ? count_events(buffer, nwords) : 0
+    );
+  return status;
+};
+
+uint32_t V1290::strip_fillers(
+    uint32_t* data, uint32_t& nwords
+) const noexcept {
+  uint32_t n = simd::remove_matching(
+      data, nwords, 0xF8000000, Packet::Type::Filler << 27
+  );
+  uint32_t result = nwords - n;
+  nwords = n;
+  if (result && metrics::enabled()) account_stripped(result);
+  return result;
+};
+
+uint32_t V1290::count_events(const uint32_t* data, uint32_t nwords) {
+  uint32_t result = 0;
+  for (uint32_t i = 0; i < nwords; ++i)
+    result += data[i] >> 27 == Packet::Type::GlobalTrailer;
+  return result;
+};
+
 };
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <chrono>
+#include <deque>
+#include <map>
+
 #include "comm.hpp"
 
 namespace caen {
@@ -142,6 +146,13 @@ class V1290: public Device {
         bool full()       const { return bit(1); };
     };
 
+    // Event FIFO entry: the board stores one for each event written to the
+    // output buffer when the Event FIFO is enabled
+    struct EventFIFOEntry {
+      uint16_t event;  // event counter, 16 least significant bits
+      uint16_t nwords; // size of the event in the output buffer
+    };
+
     struct TriggerConfiguration {
       float window_width;
       float window_offset;
@@ -159,6 +170,9 @@ class V1290: public Device {
 
         bool leading()  const { return bit(1); };
         void set_leading(bool value) { set_bit(1, value); };
+
+        // Pair mode: the leading edge time and the pulse width are measured
+        bool pair() const { return !bits(0, 1); };
     };
 
     struct Resolution {
@@ -216,6 +230,20 @@ class V1290: public Device {
       uint8_t  fine;
     };
 
+    // Board configuration available through plain VME registers (as opposed
+    // to the micro controller opcodes). See `registers` and `set_registers`.
+    struct Registers {
+      uint16_t control;
+      uint8_t  interrupt_level;
+      uint8_t  interrupt_vector;
+      uint8_t  geo_address;
+      uint8_t  mcst_base_address;
+      uint8_t  mcst_control;
+      uint16_t almost_full_level;
+      uint8_t  blt_event_number;
+      uint8_t  out_prog;
+    };
+
     // Microcontroller firmware revision and date
     struct MicroRevision {
       uint16_t version;
@@ -345,6 +373,11 @@ class V1290: public Device {
         bool     trailing() const { return bit(26);      };
         uint8_t  type()     const { return bits(27, 31); };
 
+        // In pair mode the value holds the leading edge time and the pulse
+        // width, in units of the respective resolution
+        uint16_t leading_time() const { return bits( 0, 11); };
+        uint8_t  width()        const { return bits(12, 18); };
+
         void set_value   (uint32_t value)     { set_bits( 0, 20, value  ); };
         void set_channel (uint8_t  channel)   { set_bits(21, 25, channel); };
         void set_trailing(bool     trailing)  { set_bit(26, trailing);     };
@@ -435,7 +468,7 @@ class V1290: public Device {
         void set_nwords      (uint16_t nwords)   { set_bits(5, 20, nwords); };
         void set_errors      (bool     errors)   { set_bit(24, errors);     };
         void set_overflow    (bool     overflow) { set_bit(25, overflow);   };
-        void set_trigger_lost(bool trigger_lost) { set_bits(26, trigger_lost); };
+        void set_trigger_lost(bool trigger_lost) { set_bit(26, trigger_lost);   };
     };
 
     class Filler: public Packet {
@@ -459,6 +492,488 @@ class V1290: public Device {
         };
     };
 
+    // Data decoded into structure-of-arrays form for analysis: TDC
+    // measurements, and side tables of events and TDC errors. Measurements
+    // and errors refer to their event by index into the event tables; those
+    // preceding the first global header of the data have index -1.
+    struct Decoded {
+      struct Hits {
+        std::vector<uint32_t> event;
+        std::vector<uint8_t>  channel;
+        std::vector<uint8_t>  trailing; // edge: 0 leading, 1 trailing
+        std::vector<uint32_t> time;     // 21 bits
+
+        size_t size() const { return time.size(); };
+        void resize(size_t n);
+      } hits;
+
+      // Measurements in pair mode, see decode_pairs
+      struct Pulses {
+        std::vector<uint32_t> event;
+        std::vector<uint8_t>  channel;
+        std::vector<uint32_t> leading; // ps
+        std::vector<uint32_t> width;   // ps
+
+        size_t size() const { return width.size(); };
+        void resize(size_t n);
+      } pulses;
+
+      // One entry per global header
+      struct Events {
+        std::vector<uint32_t> count;   // event counter of the global header
+        std::vector<uint8_t>  geo;
+        std::vector<uint32_t> ettt;    // extended trigger time tag, 0 if none
+        std::vector<uint16_t> nwords;  // from the global trailer, 0 if none
+        std::vector<uint8_t>  status;  // global trailer bits 24-26: errors,
+                                       // overflow, trigger lost
+
+        size_t size() const { return count.size(); };
+      } events;
+
+      struct Errors {
+        std::vector<uint32_t> event;
+        std::vector<uint8_t>  tdc;
+        std::vector<uint16_t> errors;
+
+        size_t size() const { return errors.size(); };
+      } errors;
+
+      void clear();
+    };
+
+    // Decode `nwords` words of data, appending to `decoded`. Events may span
+    // several calls. TDC headers, TDC trailers and fillers are skipped. The
+    // packet types are classified and the measurements compacted several
+    // words at a time with the SIMD instructions of the target (see
+    // simd_instruction_set); `decode_scalar` is the reference
+    // implementation word by word.
+    static void decode(const uint32_t* data, size_t nwords, Decoded& decoded);
+    static void decode_scalar(
+        const uint32_t* data, size_t nwords, Decoded& decoded
+    );
+
+    static void decode(const Buffer& buffer, Decoded& decoded) {
+      decode(buffer.raw(), buffer.size(), decoded);
+    };
+
+    // Decode data taken in pair mode (see EdgeDetection::pair), where a
+    // measurement holds the leading edge time and the pulse width, into
+    // `decoded.pulses` in picoseconds. `resolution` is the one configured,
+    // as returned by resolution(). The decoder is specialized at compile time
+    // for each combination of resolutions.
+    static void decode_pairs(
+        const uint32_t* data,
+        size_t nwords,
+        Resolution resolution,
+        Decoded& decoded
+    );
+
+    static void decode_pairs(
+        const Buffer& buffer, Resolution resolution, Decoded& decoded
+    ) {
+      decode_pairs(buffer.raw(), buffer.size(), resolution, decoded);
+    };
+
+    // The instruction set `decode` was built for, e.g., "AVX2"
+    static const char* simd_instruction_set();
+
+    // INL compensation tables of the channels, see `compensation`. Each table
+    // holds 256 signed corrections in units of 25 ps, indexed by the 8 least
+    // significant bits of a measurement. With the tables applied in software
+    // the board can run with Control::compensation_enabled off.
+    class Compensation {
+      public:
+        static const unsigned nchannels = 32;
+        static const unsigned nbins     = 256;
+
+        // No correction
+        Compensation() {};
+
+        bool empty() const { return table_.empty(); };
+
+        int8_t correction(uint8_t channel, uint32_t time) const {
+          return table_.empty() ? 0 : table_[channel * nbins + (time & 0xFF)];
+        };
+
+        // Corrected 21-bit time of a measurement at 25 ps resolution
+        uint32_t correct(uint8_t channel, uint32_t time) const {
+          return time + correction(channel, time) & 0x1FFFFF;
+        };
+
+        // Correct the times of the hits from index `from` on, taken at
+        // 25 ps resolution, several at a time with table gathers
+        void apply(Decoded::Hits& hits, size_t from = 0) const;
+
+      private:
+        friend class V1290;
+
+        // Tables of all channels, plus slack for 32-bit gathers
+        std::vector<int8_t> table_;
+    };
+
+    // Packets of type P in a range of words, skipping the other types
+    template <typename P> class Packets {
+      public:
+        class iterator {
+          public:
+            iterator(const uint32_t* p, const uint32_t* end, uint8_t type):
+              p(p), end(end), type(type) { skip(); };
+
+            P operator*() const { return P(*p); };
+            iterator& operator++() { ++p; skip(); return *this; };
+            bool operator!=(const iterator& i) const { return p != i.p; };
+
+          private:
+            const uint32_t* p;
+            const uint32_t* end;
+            uint8_t type;
+
+            void skip() { while (p != end && *p >> 27 != type) ++p; };
+        };
+
+        Packets(const uint32_t* begin, const uint32_t* end):
+          begin_(begin), end_(end) {};
+
+        iterator begin() const { return { begin_, end_, P().type() }; };
+        iterator end()   const { return { end_,   end_, P().type() }; };
+
+      private:
+        const uint32_t* begin_;
+        const uint32_t* end_;
+    };
+
+    // Words of a TDC, from its header to its trailer, both excluded. Empty
+    // when the TDC headers and trailers are disabled.
+    struct TDCBlock {
+      TDCHeader  header;
+      TDCTrailer trailer;
+      const uint32_t* begin;
+      const uint32_t* end;
+
+      Packets<TDCMeasurement> measurements() const { return { begin, end }; };
+      Packets<TDCError> errors() const { return { begin, end }; };
+    };
+
+    // View of an event yielded by Parser, valid until the next call to
+    // Parser::next or Parser::feed
+    struct Event {
+      // Structural problems found
+      enum Problem: uint8_t {
+        Truncated    = 1 << 0, // the next global header came first
+        WordCount    = 1 << 1, // global trailer word count mismatch
+        TDCWordCount = 1 << 2, // TDC trailer word count mismatch
+        EventID      = 1 << 3, // TDC event ID mismatch
+        Structure    = 1 << 4  // misplaced TDC header or trailer
+      };
+
+      static const unsigned max_tdcs = 4;
+
+      GlobalHeader           header;
+      GlobalTrailer          trailer;  // none if truncated
+      ExtendedTriggerTimeTag ettt;     // none if not enabled
+      bool                   has_ettt;
+      TDCBlock               tdcs[max_tdcs];
+      unsigned               ntdcs;
+      uint8_t                problems;
+      const uint32_t*        begin;    // from the global header
+      const uint32_t*        end;      // past the global trailer
+
+      bool valid() const { return !problems; };
+
+      // All the measurements and errors of the event, across the TDCs
+      Packets<TDCMeasurement> measurements() const { return { begin, end }; };
+      Packets<TDCError> errors() const { return { begin, end }; };
+    };
+
+    // Streaming parser of the data read out, yielding events as views.
+    // Events may span several readouts: the words of an incomplete event are
+    // kept until the rest is fed, in a buffer allocated once. Corrupted events
+    // are yielded too, flagged with their problems and counted. Words outside
+    // events are skipped and counted, except for fillers.
+    //
+    //   V1290::Parser parser;
+    //   V1290::Event event;
+    //   for (;;) {
+    //     tdc.readout(buffer);
+    //     parser.feed(buffer);
+    //     while (parser.next(event))
+    //       if (event.valid()) ...
+    //   };
+    class Parser {
+      public:
+        struct Statistics {
+          uint64_t events         = 0;
+          uint64_t corrupted      = 0; // events with any problem
+          uint64_t truncated      = 0;
+          uint64_t word_count     = 0;
+          uint64_t tdc_word_count = 0;
+          uint64_t event_id       = 0;
+          uint64_t structure      = 0;
+          uint64_t oversized      = 0; // longer than max_event, dropped
+          uint64_t stray_words    = 0;
+        };
+
+        // `max_event` is the largest event in words that can span readouts
+        Parser(size_t max_event = 32 * 1024);
+
+        // The words fed must stay valid until the next call
+        void feed(const uint32_t* data, size_t nwords);
+        void feed(const Buffer& buffer) { feed(buffer.raw(), buffer.size()); };
+
+        // Next complete event of the data fed. False when the data is
+        // exhausted; the rest of an incomplete event is then awaited.
+        bool next(Event& event);
+
+        const Statistics& statistics() const { return statistics_; };
+        void reset_statistics() { statistics_ = Statistics(); };
+
+        // Discard an incomplete event, e.g., after clearing the board
+        void reset();
+
+      private:
+        const uint32_t* data_ = nullptr;
+        size_t size_ = 0;
+        size_t position_ = 0;
+
+        std::vector<uint32_t> partial_; // incomplete event, capacity max_event
+        size_t max_event_;
+        bool   discarding_ = false;     // the rest of an oversized event
+        bool   completed_  = false;     // partial_ yielded, cleared by next
+
+        Statistics statistics_;
+
+        void scan(const uint32_t* begin, const uint32_t* end, Event& event);
+        void keep(const uint32_t* begin, const uint32_t* end);
+    };
+
+    // Reconstructs 64-bit trigger times, in units of 25 ns since the last
+    // clear of the board, from the 27-bit extended trigger time tag and the
+    // 5 least significant bits the global trailer carries in place of the GEO
+    // address (see Control::set_ettt_enabled). The 32-bit time tag rolls
+    // over every 107 s; rollovers are unwrapped across events, so the times
+    // are monotonic provided that consecutive triggers are less than 107 s
+    // apart. Without the trailer bits (`fine` false) the resolution is 800 ns.
+    // Events without a time tag or a trailer (see Event::has_ettt and
+    // Event::Truncated) leave the clock alone and give `invalid`.
+    //
+    //   V1290::TriggerClock clock;
+    //   while (parser.next(event)) {
+    //     uint64_t t = clock(event);
+    //     if (t == V1290::TriggerClock::invalid) continue;
+    //     ...
+    //   };
+    class TriggerClock {
+      public:
+        static constexpr double tick = 25e-9; // s
+        static constexpr uint64_t invalid = ~uint64_t(0);
+
+        TriggerClock(bool fine = true): fine_(fine) {};
+
+        uint64_t operator()(
+            ExtendedTriggerTimeTag ettt, GlobalTrailer trailer
+        ) noexcept {
+          uint32_t tag = ettt.value() << 5 | (fine_ ? trailer.geo() : 0);
+          if (tag < last_) epoch_ += uint64_t(1) << 32;
+          last_ = tag;
+          return epoch_ | tag;
+        };
+
+        uint64_t operator()(const Event& event) noexcept {
+          if (!event.has_ettt || event.problems & Event::Truncated)
+            return invalid;
+          return (*this)(event.ettt, event.trailer);
+        };
+
+        static double seconds(uint64_t time) { return time * tick; };
+
+        // Number of rollovers unwrapped
+        uint64_t rollovers() const { return epoch_ >> 32; };
+
+        // Start over, e.g., after clearing the board
+        void reset() { epoch_ = 0; last_ = 0; };
+
+      private:
+        bool     fine_;
+        uint64_t epoch_ = 0;
+        uint32_t last_  = 0;
+    };
+
+    // Readout engine of the continuous storage mode (set_triggered_mode
+    // (false)), where the board outputs every hit as a bare TDC measurement.
+    // `poll` drains the board with back-to-back block transfers, unwraps the
+    // 21-bit hit times into 64-bit ones and keeps the hits in a ring buffer.
+    // Leading edges on the trigger channels open software trigger windows,
+    // defined like the hardware ones (see set_window_offset and
+    // set_window_width); `next` yields the hits in each window once a hit
+    // past its end has been read.
+    //
+    // Hit times roll over every 2^21 TDC units (52 us at 25 ps): times are
+    // unwrapped correctly as long as consecutive hits are less than half of
+    // that apart, and hits read out of order by less than half of that.
+    //
+    //   V1290::Stream stream(tdc);
+    //   stream.set_trigger_channel(31);
+    //   stream.set_window(-1e-6, 2e-6);
+    //   V1290::Stream::Trigger trigger;
+    //   for (;;) {
+    //     stream.poll();
+    //     while (stream.next(trigger)) ...
+    //   };
+    class Stream {
+      public:
+        struct Hit {
+          uint64_t time;     // in units of the resolution
+          uint8_t  channel;
+          bool     trailing;
+        };
+
+        struct Trigger {
+          uint64_t time;
+          uint8_t  channel;
+          std::vector<Hit> hits; // in the window, in readout order
+        };
+
+        struct Statistics {
+          uint64_t readouts  = 0; // block transfers
+          uint64_t words     = 0;
+          uint64_t hits      = 0;
+          uint64_t triggers  = 0;
+          uint64_t errors    = 0; // TDC error words
+          uint64_t dropped   = 0; // hits overwritten in a full ring buffer
+        };
+
+        // The resolution is read from the board. `capacity` is the number of
+        // hits kept, rounded up to a power of two.
+        Stream(V1290& tdc, size_t capacity = 1 << 20);
+
+        void set_trigger_channel(uint8_t channel, bool enabled = true) {
+          uint32_t bit = uint32_t(1) << channel;
+          if (enabled)
+            triggers_mask_ |= bit;
+          else
+            triggers_mask_ &= ~bit;
+        };
+
+        // Window relative to the trigger time, in seconds
+        void set_window(float offset, float width);
+
+        // Drain the board until a transfer comes back short. Returns the
+        // number of hits read. Throws Error if a transfer fails.
+        size_t poll();
+
+        // Next trigger whose window is complete
+        bool next(Trigger& trigger);
+
+        float resolution() const { return resolution_; };
+
+        const Statistics& statistics() const { return statistics_; };
+
+        // Forget the hits and triggers, e.g., after clearing the board
+        void reset();
+
+      private:
+        V1290& tdc_;
+        float  resolution_;
+
+        uint32_t triggers_mask_ = 0;
+        int64_t  offset_ = 0; // window, in units of the resolution
+        int64_t  width_  = 0;
+
+        std::vector<uint32_t> words_;   // of a block transfer
+        std::vector<Hit>      ring_;
+        size_t                head_ = 0;
+        size_t                size_ = 0;
+        std::deque<Hit>       triggers_;
+
+        // Unwrapping of the hit times
+        bool     started_ = false;
+        uint32_t last_    = 0;
+        int64_t  time_    = 0;
+        int64_t  latest_  = 0;
+
+        Statistics statistics_;
+
+        void push(const Hit& hit);
+
+        // Drop the hits before the windows of the pending and future triggers
+        void drop();
+    };
+
+    // Generator of synthetic data for benchmarks of the decoding, event
+    // building and storage without a board. Events are built from the
+    // packet classes as the board would output them in triggered mode; the
+    // random numbers are drawn from lookup tables built once, so that the
+    // generation is bound by memory bandwidth.
+    //
+    //   V1290::Generator::Settings settings;
+    //   settings.multiplicity = 20;
+    //   settings.ettt_enabled = true;
+    //   V1290::Generator generator(settings);
+    //   V1290::Buffer buffer;
+    //   generator.generate(buffer);
+    class Generator {
+      public:
+        struct Settings {
+          Version  version      = V1290A; // 32 channels on 4 TDCs or 16 on 2
+          uint8_t  geo          = 0;
+          double   multiplicity = 8;      // mean hits per event (Poisson)
+          unsigned max_hits     = 256;    // per event
+          // Relative occupancy of the channels: all 1, unused ones at 0
+          std::array<float, 32> occupancy;
+          bool     both_edges   = false;  // a trailing edge after each hit
+          bool     tdc_headers_enabled = true;
+          double   error_rate   = 0;      // TDC error words per TDC and event
+          bool     ettt_enabled = false;
+          double   trigger_rate = 100e3;  // Hz, > 0, for the time tags
+          uint64_t seed         = 1;
+
+          Settings() { occupancy.fill(1); };
+        };
+
+        Generator(const Settings& settings = Settings());
+
+        // Write whole events into `data`, as many as fit in `nwords` words.
+        // Returns the number of words written.
+        size_t generate(uint32_t* data, size_t nwords);
+
+        void generate(Buffer& buffer) {
+          buffer.resize(generate(buffer.raw(), buffer.max_size()));
+        };
+
+        const Settings& settings() const { return settings_; };
+
+        // Events generated so far
+        uint32_t events() const { return event_; };
+
+        // Largest event in words
+        size_t max_event() const { return max_event_; };
+
+      private:
+        Settings settings_;
+        unsigned ntdcs_;
+        size_t   max_event_;
+
+        uint64_t state_;         // random number generator
+        uint32_t event_ = 0;
+        uint64_t time_  = 0;     // trigger time, in 25 ns units
+        uint32_t period_;        // mean time between triggers, in 25 ns units
+        uint32_t error_threshold_;
+
+        // Inverse cumulative distributions sampled by random bits
+        std::array<uint16_t, 4096> multiplicities_;
+        std::array<uint8_t,  1024> channels_;
+
+        std::vector<uint32_t> hits_; // measurements of an event
+
+        uint64_t random() {
+          // splitmix64
+          uint64_t z = state_ += 0x9E3779B97F4A7C15;
+          z = (z ^ z >> 30) * 0xBF58476D1CE4E5B9;
+          z = (z ^ z >> 27) * 0x94D049BB133111EB;
+          return z ^ z >> 31;
+        };
+    };
+
     // TDC time resolution in single mode (only the leading or the trailing
     // edge of the signal is detected) in seconds. Descending order.
     static const float single_resolution[4];
@@ -474,19 +989,30 @@ class V1290: public Device {
     V1290(const Connection& connection);
 
     V1290(V1290&& device):
-      Device(std::move(device)), version_(device.version_)
+      Device(std::move(device)),
+      version_(device.version_),
+      wait_strategy_(device.wait_strategy_),
+      micro_statistics_(std::move(device.micro_statistics_)),
+      micro_cache_(std::move(device.micro_cache_)),
+      pending_events_(std::move(device.pending_events_)),
+      compensation_(std::move(device.compensation_))
     {};
 
     V1290& operator=(V1290&& device) {
       Device::operator=(std::move(device));
-      version_ = device.version_;
+      version_          = device.version_;
+      wait_strategy_    = device.wait_strategy_;
+      micro_statistics_ = std::move(device.micro_statistics_);
+      micro_cache_      = std::move(device.micro_cache_);
+      pending_events_   = std::move(device.pending_events_);
+      compensation_     = std::move(device.compensation_);
       return *this;
     };
 
     const char* kind() const { return "V1290"; };
 
     uint16_t rom_checksum() const {
-      return read16(0x4000);
+      return rom(0x4000);
     };
 
     // should be 0x20
@@ -501,12 +1027,12 @@ class V1290: public Device {
 
     // ROM C code --- should be 0x43
     uint16_t rom_c_code() const {
-      return read16(0x401C);
+      return rom(0x401C);
     };
 
     // ROM R code --- should be 0x52
     uint16_t rom_r_code() const {
-      return read16(0x4020);
+      return rom(0x4020);
     };
 
     // Manufacturer identifier (OUI) --- should be 0x40E6
@@ -662,11 +1188,17 @@ class V1290: public Device {
     // Module reset
     void reset() {
       write16(0x1014, 1);
+      invalidate_cache();
+      micro_cache_.invalidate();
+      pending_events_.clear();
     };
 
     // Software clear
     void clear() {
       write16(0x1016, 1);
+      invalidate_cache();
+      micro_cache_.invalidate();
+      pending_events_.clear();
     };
 
     // Software event reset
@@ -730,6 +1262,11 @@ class V1290: public Device {
       write16(0x102C, value);
     };
 
+    // Read or write all the registers in V1290::Registers in a single batched
+    // transaction
+    Registers registers() const;
+    void set_registers(const Registers&);
+
     // Micro Handshake: all read and write operations with the Micro register
     // can be performed, respectively, when the bit `read_ok` or `write_ok` is
     // set
@@ -744,6 +1281,78 @@ class V1290: public Device {
     bool micro_write_ok() const { return micro_handshake().write_ok(); };
     bool micro_read_ok()  const { return micro_handshake().read_ok();  };
 
+    // How the functions below that talk to the micro controller wait for the
+    // handshake. The register is polled `spins` times back to back, then
+    // with sleeps starting at `backoff` and doubling up to `max_backoff`. If
+    // the micro controller is not ready within `timeout`, MicroTimeout is
+    // thrown.
+    struct WaitStrategy {
+      unsigned                  spins = 32;
+      std::chrono::microseconds backoff     { 10 };
+      std::chrono::microseconds max_backoff { 10000 };
+      std::chrono::milliseconds timeout     { 5000 };
+    };
+
+    const WaitStrategy& wait_strategy() const { return wait_strategy_; };
+    void set_wait_strategy(const WaitStrategy& strategy) {
+      wait_strategy_ = strategy;
+    };
+
+    // The micro controller did not become ready in time
+    class MicroTimeout: public caen::Error {
+      public:
+        MicroTimeout(uint16_t opcode): opcode_(opcode) {};
+
+        // The operation that timed out
+        uint16_t opcode() const { return opcode_; };
+
+        const char* what() const noexcept;
+
+      private:
+        uint16_t opcode_;
+        mutable std::string message;
+    };
+
+    // Time spent waiting for the micro controller handshakes of an opcode
+    struct MicroTiming {
+      uint64_t handshakes = 0; // micro register reads and writes
+      uint64_t polls      = 0; // reads of the handshake register
+      uint64_t timeouts   = 0;
+      std::chrono::nanoseconds total { 0 };
+      std::chrono::nanoseconds max   { 0 };
+
+      std::chrono::nanoseconds mean() const {
+        return handshakes ? total / int64_t(handshakes) : total;
+      };
+    };
+
+    // Timing by opcode (the most significant byte of the command word, e.g.,
+    // 0x26 for "read edge detection"), accumulated since the board was
+    // opened or the statistics were reset
+    const std::map<uint8_t, MicroTiming>& micro_statistics() const {
+      return micro_statistics_;
+    };
+    void reset_micro_statistics() { micro_statistics_.clear(); };
+
+    // Shadow of the micro controller settings. When enabled, the setters
+    // below remember what they write and the corresponding getters (trigger
+    // configuration, edge detection, resolution, dead time, channel enables,
+    // offsets and adjustments, ...) are answered without bus traffic. Like
+    // the register cache it is disabled by default; loading a configuration
+    // (`load_default_configuration`, `load_user_configuration`), `reset` and
+    // `clear` invalidate it. Entries are keyed by the query opcode shifted
+    // by 8 bits, plus the index of the result word.
+    RegisterCache&       micro_cache()       { return micro_cache_; };
+    const RegisterCache& micro_cache() const { return micro_cache_; };
+
+    void set_micro_cache_enabled(bool enabled) {
+      micro_cache_.set_enabled(enabled);
+    };
+
+    // Read all the cached settings from the micro controller in one micro
+    // program (see `run`). Enables the micro cache.
+    void refresh_micro_cache();
+
     // Dummy32 --- for testing
     uint32_t dummy32() const {
       return read32(0x1200);
@@ -769,12 +1378,35 @@ class V1290: public Device {
     };
 
     // XXX: Flash memory access is not implemented yet
-    // XXX: SRAM compensation page support is not implemented yet
-    // XXX: Event FIFO support is not implemented yet
+
+    // Compensation SRAM page: the channel whose INL compensation table is
+    // mapped at 0x8000
+    uint16_t compensation_sram_page() const {
+      return read16(0x1026);
+    };
+    void set_compensation_sram_page(uint16_t page) {
+      write16(0x1026, page);
+    };
+
+    // INL compensation tables of all channels. Read from the compensation
+    // SRAM on first use (one batch of 256 reads per channel) and kept until
+    // `read_compensation` is called again.
+    const Compensation& compensation() {
+      if (compensation_.empty()) read_compensation();
+      return compensation_;
+    };
+
+    void read_compensation();
 
     // Number of events stored in Event FIFO
     uint16_t event_fifo_stored() const {
-      return read16(0x103C) & 0x3ff;
+      return read16(0x103C) & 0x7ff;
+    };
+
+    // Pop an entry from the Event FIFO
+    EventFIFOEntry event_fifo_read() {
+      uint32_t value = read32(0x1038);
+      return { uint16_t(value >> 16), uint16_t(value & 0xFFFF) };
     };
 
     EventFIFOStatus event_fifo_status() const {
@@ -789,66 +1421,69 @@ class V1290: public Device {
     bool event_fifo_full()  const { return event_fifo_status().full();       };
 
     void set_triggered_mode(bool enabled) {
-      micro_write(enabled ? 0x0000 : 0x0100);
+      micro_opcode(enabled ? 0x0000 : 0x0100);
+      micro_store(0x0200, enabled);
     };
 
     bool triggered_mode() const {
-      micro_write(0x0200);
-      return micro_read() & 1;
+      return micro_query(0x0200) & 1;
     };
 
     void set_keep_token(bool keep) {
-      micro_write(keep ? 0x0300 : 0x0400);
+      micro_opcode(keep ? 0x0300 : 0x0400);
     };
 
     void load_default_configuration() {
-      micro_write(0x0500);
+      micro_opcode(0x0500);
+      micro_cache_.invalidate();
     };
 
     void save_user_configuration() {
-      micro_write(0x0600);
+      micro_opcode(0x0600);
     };
 
     void load_user_configuration() {
-      micro_write(0x0700);
+      micro_opcode(0x0700);
+      micro_cache_.invalidate();
     };
 
     void set_autoload_user_configuration(bool load) {
-      micro_write(load ? 0x0800 : 0x0900);
+      micro_opcode(load ? 0x0800 : 0x0900);
     };
 
     void set_window_width(float seconds) {
-      set_time_value(0x1000, seconds);
+      set_time_value(0x1000, seconds, 0);
     };
 
     void set_window_offset(float seconds) {
-      set_time_value(0x1100, seconds);
+      set_time_value(0x1100, seconds, 1);
     };
 
     void set_search_margin(float seconds) {
-      set_time_value(0x1200, seconds);
+      set_time_value(0x1200, seconds, 2);
     };
 
     void set_reject_margin(float seconds) {
-      set_time_value(0x1300, seconds);
+      set_time_value(0x1300, seconds, 3);
     };
 
     void set_trigger_time_subtraction(bool enabled) {
-      micro_write(enabled ? 0x1400 : 0x1500);
+      micro_opcode(enabled ? 0x1400 : 0x1500);
+      micro_store(0x1600, enabled, 4);
     };
 
     TriggerConfiguration trigger_configuration() const;
 
     EdgeDetection edge_detection() const {
-      micro_write(0x2300);
-      return micro_read();
+      return micro_query(0x2300);
     };
 
     void set_edge_detection(bool leading, bool trailing);
 
     void set_edge_detection(EdgeDetection detection) {
-      micro_write(0x2200);
+      micro_opcode(0x2200);
       micro_write(detection);
+      micro_store(0x2300, detection);
     };
 
     Resolution resolution() const;
@@ -858,20 +1493,19 @@ class V1290: public Device {
     };
 
     float dead_time() const {
-      micro_write(0x2900);
-      return dead_times[micro_read() & 3];
+      return dead_times[micro_query(0x2900) & 3];
     };
 
     void set_dead_time(float time);
 
     // Whether TDC's header and trailer packets are added to the data
     bool header_and_trailer_enabled() const {
-      micro_write(0x3200);
-      return micro_read();
+      return micro_query(0x3200);
     };
 
     void set_header_and_trailer_enabled(bool enabled) {
-      micro_write(enabled ? 0x3000 : 0x3100);
+      micro_opcode(enabled ? 0x3000 : 0x3100);
+      micro_store(0x3200, enabled);
     };
 
     // < 0: unlimited
@@ -881,37 +1515,37 @@ class V1290: public Device {
 
     // Put an error mark in the data when a global error occurs (default)
     void enable_error_mark(bool enable) {
-      micro_write(enable ? 0x3500 : 0x3600);
+      micro_opcode(enable ? 0x3500 : 0x3600);
     };
 
     // Enable TDCs' bypass when a global error occurs
     void enable_error_bypass(bool enable) {
-      micro_write(enable ? 0x3700 : 0x3800);
+      micro_opcode(enable ? 0x3700 : 0x3800);
     };
 
     InternalErrors internal_errors() const {
-      micro_write(0x3A00);
-      return micro_read();
+      return micro_query(0x3A00);
     };
 
     void set_internal_errors(InternalErrors errors) {
-      micro_write(0x3900);
+      micro_opcode(0x3900);
       micro_write(errors);
+      micro_store(0x3A00, errors);
     };
 
     unsigned fifo_size() const {
-      micro_write(0x3C00);
-      return 2 << micro_read();
+      return 2 << micro_query(0x3C00);
     };
 
     void set_fifo_size(unsigned nwords);
 
-    void set_channel_enabled(uint8_t channel, bool enabled) {
-      micro_write((enabled ? 0x4000 : 0x4100) | channel);
-    };
+    void set_channel_enabled(uint8_t channel, bool enabled);
 
     void set_channels_enabled(bool enabled) {
-      micro_write(enabled ? 0x4200 : 0x4300);
+      micro_opcode(enabled ? 0x4200 : 0x4300);
+      micro_store(0x4500, enabled ? 0xFFFF : 0, 0);
+      micro_store(0x4500, enabled ? 0xFFFF : 0, 1);
+      forget_tdc_channels();
     };
 
     uint32_t enabled_channels() const;
@@ -926,17 +1560,20 @@ class V1290: public Device {
     void enable_tdc_channels(uint8_t tdc, uint32_t mask);
 
     GlobalOffset global_offset() const {
+      uint16_t words[2];
+      micro_query(0x5100, words, 2);
       GlobalOffset result;
-      micro_write(0x5100);
-      result.coarse = micro_read();
-      result.fine   = micro_read();
+      result.coarse = words[0];
+      result.fine   = words[1];
       return result;
     };
 
     void set_global_offset(uint16_t coarse, uint8_t fine) {
-      micro_write(0x5000);
+      micro_opcode(0x5000);
       micro_write(coarse);
       micro_write(fine);
+      micro_store(0x5100, coarse, 0);
+      micro_store(0x5100, fine, 1);
     };
 
     void set_global_offset(GlobalOffset o) {
@@ -944,76 +1581,110 @@ class V1290: public Device {
     };
 
     uint8_t channel_adjust(uint8_t channel) const {
-      micro_write(0x5300 | channel);
-      return micro_read();
+      return micro_query(0x5300 | channel);
     };
 
     void adjust_channel(uint8_t channel, uint8_t value) {
-      micro_write(0x5200 | channel);
+      micro_opcode(0x5200 | channel);
       micro_write(value);
+      micro_store(0x5300 | channel, value);
     };
 
     uint16_t rc_adjust(uint8_t tdc) const {
-      micro_write(0x5500 | tdc);
+      micro_opcode(0x5500 | tdc);
       return micro_read();
     };
 
     void adjust_rc(uint8_t tdc, uint16_t set) {
-      micro_write(0x5400);
+      micro_opcode(0x5400);
       micro_write(set);
     };
 
     void save_rc_adjust() {
-      micro_write(0x5600);
+      micro_opcode(0x5600);
     };
 
     uint16_t tdc_id(uint8_t tdc) const {
-      micro_write(0x6000 | tdc);
-      return micro_read();
+      return micro_query(0x6000 | tdc);
     };
 
     uint16_t micro_revision() const {
-      micro_write(0x6100);
-      return micro_read();
+      return micro_query(0x6100);
     };
 
     // Resets TDCs' PLL (Phase Locked Loop) and DLL (Delay Locked Loop)
     void reset_timers() {
-      micro_write(0x6200);
+      micro_opcode(0x6200);
     };
 
     void scan_path_write(uint8_t address, uint16_t word) {
-      micro_write(0x7000 | address);
+      micro_opcode(0x7000 | address);
       micro_write(word);
     };
 
     uint16_t scan_path_read(uint8_t address) {
-      micro_write(0x7100 | address);
+      micro_opcode(0x7100 | address);
       return micro_read();
     };
 
     void scan_path_load() {
-      micro_write(0x7200);
+      micro_opcode(0x7200);
     };
 
     void scan_path_reload() {
-      micro_write(0x7300);
+      micro_opcode(0x7300);
     };
 
     InternalErrors tdc_errors(uint8_t tdc) const {
-      micro_write(0x7400 | tdc);
+      micro_opcode(0x7400 | tdc);
       return micro_read();
     };
 
     bool dll_locked(uint8_t tdc) const {
-      micro_write(0x7500 | tdc);
+      micro_opcode(0x7500 | tdc);
       return micro_read() & 1;
     };
 
     uint64_t tdc_status(uint8_t tdc) const;
 
+    // Health of the TDCs of a board, see `health`
+    struct Health {
+      struct TDC {
+        bool           dll_locked = false;
+        InternalErrors errors     = 0;
+        uint64_t       status     = 0;  // see tdc_status
+      };
+
+      std::string    board;                // metrics name
+      InternalErrors internal_errors = 0;  // error types enabled
+      TDC            tdcs[4];
+      unsigned       ntdcs = 0;
+      std::string    failure;              // empty if scanned
+      std::chrono::nanoseconds time { 0 }; // of the scan
+
+      // Scanned, with all the DLLs locked and no TDC errors
+      bool ok() const;
+    };
+
+    // DLL lock, errors and status of every TDC and the enabled error types,
+    // queried in a single micro program (see `run`)
+    Health health();
+
+    struct HealthReport {
+      std::vector<Health> boards; // in the order given
+      unsigned nlinks = 0;        // scanned concurrently
+      std::chrono::nanoseconds time { 0 };
+
+      bool ok() const;
+    };
+
+    // Scan the health of `boards` concurrently, one thread per link (see
+    // Device::link) scanning the boards on it in turn. Failures are reported
+    // per board rather than thrown.
+    static HealthReport health_scan(const std::vector<V1290*>& boards);
+
     void scan_path_load(uint8_t tdc) {
-      micro_write(0x7700 | tdc);
+      micro_opcode(0x7700 | tdc);
     };
 
     void eeprom_write(uint16_t address, uint8_t byte);
@@ -1022,23 +1693,23 @@ class V1290: public Device {
     MicroRevision micro_revision_date() const;
 
     void spare_write(uint16_t value) {
-      micro_write(0xC300);
+      micro_opcode(0xC300);
       micro_write(value);
+      micro_store(0xC400, value);
     };
 
     uint16_t spare_read() const {
-      micro_write(0xC400);
-      return micro_read();
+      return micro_query(0xC400);
     };
 
     void enable_test_mode(uint32_t test_word);
 
     void disable_test_mode() {
-      micro_write(0xC600);
+      micro_opcode(0xC600);
     };
 
     void tdc_test_output(uint8_t tdc, uint8_t output) {
-      micro_write(0xC700 | tdc);
+      micro_opcode(0xC700 | tdc);
       micro_write(output);
     };
 
@@ -1047,43 +1718,328 @@ class V1290: public Device {
     // 2 PLL 160 MHz clock (medium resolution)
     // 3 PLL 320 MHz clock (high resolution)
     void set_dll_clock(uint8_t clock) {
-      micro_write(0xC800);
+      micro_opcode(0xC800);
       micro_write(clock);
     };
 
     static const unsigned scan_path_length = 41; // of uint16_t
     void scan_path_read(uint8_t tdc, uint16_t* scan_path) const;
 
+    // A sequence of micro controller operations executed back to back by
+    // `run`. Setters mirror the ones of V1290 and return the program for
+    // chaining. Queries return the index of their result in
+    // MicroProgram::Results. Get an empty program with `micro_program`.
+    //
+    //   auto program = tdc.micro_program();
+    //   program.set_window_width(1e-6).set_window_offset(-1e-6);
+    //   for (uint8_t i = 0; i < 32; ++i) program.adjust_channel(i, adjust[i]);
+    //   unsigned trigger = program.trigger_configuration();
+    //   auto results = tdc.run(program);
+    //   auto configuration = results.trigger_configuration(trigger);
+    class MicroProgram {
+      public:
+        // Words read back by the queries of a program
+        class Results {
+          public:
+            const uint16_t* operator[](unsigned query) const {
+              return words.data() + offsets[query];
+            };
+
+            // Number of words of `query`
+            unsigned size(unsigned query) const {
+              return (
+                  query + 1 < offsets.size() ? offsets[query + 1] : words.size()
+              ) - offsets[query];
+            };
+
+            unsigned nqueries() const { return offsets.size(); };
+
+            // Results of the corresponding queries
+            TriggerConfiguration trigger_configuration(unsigned query) const;
+            uint32_t channels(unsigned query) const;
+            uint64_t tdc_status(unsigned query) const;
+
+          private:
+            std::vector<uint16_t> words;
+            std::vector<unsigned> offsets; // of the first word of each query
+
+            friend class V1290;
+        };
+
+        MicroProgram(Version version = V1290A): version_(version) {};
+
+        // Generic operation: `opcode` followed by `operands`
+        MicroProgram& operation(
+            uint16_t opcode, std::initializer_list<uint16_t> operands = {}
+        );
+
+        // Generic query: `opcode` followed by `nresults` words read back
+        unsigned query(uint16_t opcode, unsigned nresults = 1);
+
+        size_t size() const { return words.size(); };
+        bool empty() const { return words.empty(); };
+        void clear() { words.clear(); nqueries = 0; };
+
+        MicroProgram& set_triggered_mode(bool enabled) {
+          return operation(enabled ? 0x0000 : 0x0100);
+        };
+
+        MicroProgram& set_keep_token(bool keep) {
+          return operation(keep ? 0x0300 : 0x0400);
+        };
+
+        MicroProgram& set_window_width(float seconds) {
+          return operation(0x1000, { uint16_t(seconds_to_cycles(seconds)) });
+        };
+
+        MicroProgram& set_window_offset(float seconds) {
+          return operation(0x1100, { uint16_t(seconds_to_cycles(seconds)) });
+        };
+
+        MicroProgram& set_search_margin(float seconds) {
+          return operation(0x1200, { uint16_t(seconds_to_cycles(seconds)) });
+        };
+
+        MicroProgram& set_reject_margin(float seconds) {
+          return operation(0x1300, { uint16_t(seconds_to_cycles(seconds)) });
+        };
+
+        MicroProgram& set_trigger_time_subtraction(bool enabled) {
+          return operation(enabled ? 0x1400 : 0x1500);
+        };
+
+        MicroProgram& set_edge_detection(EdgeDetection detection) {
+          return operation(0x2200, { detection });
+        };
+
+        MicroProgram& set_dead_time(float time);
+
+        MicroProgram& set_header_and_trailer_enabled(bool enabled) {
+          return operation(enabled ? 0x3000 : 0x3100);
+        };
+
+        MicroProgram& set_event_size(int size);
+        MicroProgram& set_fifo_size(unsigned nwords);
+
+        MicroProgram& enable_error_mark(bool enable) {
+          return operation(enable ? 0x3500 : 0x3600);
+        };
+
+        MicroProgram& enable_error_bypass(bool enable) {
+          return operation(enable ? 0x3700 : 0x3800);
+        };
+
+        MicroProgram& set_internal_errors(InternalErrors errors) {
+          return operation(0x3900, { errors });
+        };
+
+        MicroProgram& set_channel_enabled(uint8_t channel, bool enabled) {
+          return operation((enabled ? 0x4000 : 0x4100) | channel);
+        };
+
+        MicroProgram& set_channels_enabled(bool enabled) {
+          return operation(enabled ? 0x4200 : 0x4300);
+        };
+
+        MicroProgram& enable_channels(uint32_t mask);
+
+        MicroProgram& enable_tdc_channels(uint8_t tdc, uint32_t mask) {
+          return operation(
+              0x4600 | tdc, { uint16_t(mask & 0xFFFF), uint16_t(mask >> 16) }
+          );
+        };
+
+        MicroProgram& set_global_offset(uint16_t coarse, uint8_t fine) {
+          return operation(0x5000, { coarse, fine });
+        };
+
+        MicroProgram& adjust_channel(uint8_t channel, uint8_t value) {
+          return operation(0x5200 | channel, { value });
+        };
+
+        MicroProgram& reset_timers() { return operation(0x6200); };
+
+        // Queries, see the corresponding V1290 functions and Results
+        unsigned trigger_configuration() { return query(0x1600, 5); };
+        unsigned edge_detection()        { return query(0x2300); };
+        unsigned enabled_channels() {
+          return query(0x4500, version_ == V1290A ? 2 : 1);
+        };
+        unsigned enabled_tdc_channels(uint8_t tdc) {
+          return query(0x4700 | tdc, 2);
+        };
+        unsigned global_offset()             { return query(0x5100, 2); };
+        unsigned channel_adjust(uint8_t ch)  { return query(0x5300 | ch); };
+        unsigned tdc_id(uint8_t tdc)         { return query(0x6000 | tdc); };
+        unsigned tdc_errors(uint8_t tdc)     { return query(0x7400 | tdc); };
+        unsigned dll_locked(uint8_t tdc)     { return query(0x7500 | tdc); };
+        unsigned tdc_status(uint8_t tdc)     { return query(0x7600 | tdc, 4); };
+        unsigned internal_errors()           { return query(0x3A00); };
+
+      private:
+        // A word written to the micro register, or `nresults` words read
+        // from it
+        struct Step {
+          bool     opcode;   // the word starts an operation
+          uint16_t word;
+          unsigned nresults;
+        };
+
+        Version           version_;
+        std::vector<Step> words;
+        unsigned          nqueries = 0;
+
+        friend class V1290;
+    };
+
+    MicroProgram micro_program() const { return MicroProgram(version_); };
+
+    // Execute `program`. The micro controller handshake is polled before
+    // each word as the individual functions do, except that the result
+    // words are read together with the handshake register in one batched
+    // transaction, which tells whether the next word can be transferred
+    // without polling. Returns the results of the queries.
+    MicroProgram::Results run(const MicroProgram& program);
+
     uint32_t readout(uint32_t* buffer, uint16_t size) {
-      return mblt_read(0, buffer, size);
+      uint32_t nwords;
+      CAENComm_ErrorCode status = try_readout(buffer, size, nwords);
+      if (status != CAENComm_Success) throw Error(status);
+      return nwords;
     };
 
     uint32_t readout(Packet* buffer, uint16_t size) {
       return readout(reinterpret_cast<uint32_t*>(buffer), size);
     };
 
+    // Exact-size readout through the Event FIFO, which must be enabled (see
+    // Control::set_event_fifo_enabled). The sizes of the stored events are
+    // taken from the FIFO and exactly these events are transferred, so the
+    // block transfer never asks for more words than the output buffer holds
+    // and no fillers or bus errors terminate it. Only whole events are read:
+    // the ones that do not fit into `size` words are left for the next call.
+    // The sizes in words of the events read are appended to `sizes`. Returns
+    // the number of words read. A failed or short transfer forgets the sizes
+    // popped from the Event FIFO: clear the board to resynchronize.
+    uint32_t readout_events(
+        uint32_t* buffer, uint32_t size, std::vector<uint16_t>& sizes
+    );
+
+    void readout_events(Buffer& buffer, std::vector<uint16_t>& sizes) {
+      buffer.resize(readout_events(buffer.raw(), buffer.max_size(), sizes));
+    };
+
     void readout(Buffer& buffer) {
       buffer.resize(readout(buffer.raw(), buffer.max_size()));
     };
 
+    // Non-throwing version of `readout`, see Device::try_mblt_read. The buffer
+    // is left empty on failure.
+    CAENComm_ErrorCode try_readout(Buffer& buffer) noexcept {
+      uint32_t nwords = 0;
+      CAENComm_ErrorCode status = try_readout(
+          buffer.raw(), buffer.max_size(), nwords
+      );
+      buffer.resize(status == CAENComm_Success ? nwords : 0);
+      return status;
+    };
+
+    // Non-throwing version of `readout` into a raw buffer. Readouts are
+    // accounted in the board metrics, see metrics.hpp.
+    CAENComm_ErrorCode try_readout(
+        uint32_t* buffer, uint32_t size, uint32_t& nwords
+    ) noexcept;
+
+    // Number of events (global trailers) in `nwords` words of data
+    static uint32_t count_events(const uint32_t* data, uint32_t nwords);
+
+    // Remove the fillers padding the data read out with the bus error
+    // disabled (see Control::bus_error_enabled) in place, several words at a
+    // time. Returns the number of words removed, which are accounted in the
+    // board metrics.
+    uint32_t strip_fillers(uint32_t* data, uint32_t& nwords) const noexcept;
+
+    uint32_t strip_fillers(Buffer& buffer) const noexcept {
+      uint32_t nwords = buffer.size();
+      uint32_t result = strip_fillers(buffer.raw(), nwords);
+      buffer.resize(nwords);
+      return result;
+    };
+
   private:
     Version version_;
 
+    WaitStrategy wait_strategy_;
+    mutable std::map<uint8_t, MicroTiming> micro_statistics_;
+    mutable uint16_t opcode_ = 0; // of the operation in progress
+    mutable RegisterCache micro_cache_;
+
+    // Sizes of the events popped from the Event FIFO but not read yet
+    std::deque<uint16_t> pending_events_;
+
+    Compensation compensation_;
+
     void micro_wait(uint8_t bit) const;
     uint16_t micro_read() const;
     void micro_write(uint16_t value);
     // Not every call to `micro_write` changes the visible state of the board
     void micro_write(uint16_t value) const;
 
-    float cycles_to_seconds(int16_t cycles) const {
+    // Start an operation: write its opcode, the operands and results follow
+    void micro_opcode(uint16_t opcode) {
+      opcode_ = opcode;
+      micro_write(opcode);
+    };
+    void micro_opcode(uint16_t opcode) const {
+      opcode_ = opcode;
+      micro_write(opcode);
+    };
+
+    static uint32_t micro_key(uint16_t opcode, unsigned index) {
+      return uint32_t(opcode) << 8 | index;
+    };
+
+    // Results of the query `opcode`: `n` words from the micro cache if they
+    // are known, from the micro controller otherwise
+    void micro_query(uint16_t opcode, uint16_t* words, unsigned n) const;
+
+    uint16_t micro_query(uint16_t opcode) const {
+      uint16_t word;
+      micro_query(opcode, &word, 1);
+      return word;
+    };
+
+    // Remember word `index` of the results of the query `opcode`
+    void micro_store(uint16_t opcode, uint16_t word, unsigned index = 0) {
+      micro_cache_.store(micro_key(opcode, index), word);
+    };
+
+    // The channel mask and the TDC channel masks are views of the same
+    // state: the setters of one forget the other
+    void forget_channels() {
+      micro_cache_.invalidate(micro_key(0x4500, 0));
+      micro_cache_.invalidate(micro_key(0x4500, 1));
+    };
+
+    void forget_tdc_channels() {
+      for (uint16_t tdc = 0; tdc < 4; ++tdc) {
+        micro_cache_.invalidate(micro_key(0x4700 | tdc, 0));
+        micro_cache_.invalidate(micro_key(0x4700 | tdc, 1));
+      };
+    };
+
+    static float cycles_to_seconds(int16_t cycles) {
       return cycles * 25e-9;
     };
 
-    int16_t seconds_to_cycles(float seconds) const;
+    static int16_t seconds_to_cycles(float seconds);
 
-    void set_time_value(uint16_t opcode, float seconds) {
-      micro_write(opcode);
-      micro_write(seconds_to_cycles(seconds));
+    // Set a value of the trigger configuration, word `index` of its query
+    void set_time_value(uint16_t opcode, float seconds, unsigned index) {
+      int16_t cycles = seconds_to_cycles(seconds);
+      micro_opcode(opcode);
+      micro_write(cycles);
+      micro_store(0x1600, cycles, index);
     };
 
     bool check() const;
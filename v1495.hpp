@@ -8,7 +8,9 @@ class V1495: public Device {
   public:
     static const uint16_t buffer_size = 0x1000 / sizeof(uint32_t);
 
-    V1495(const Connection& connection): Device(connection) {};
+    V1495(const Connection& connection): Device(connection) {
+      load_rom({ { 0x8100, 34 } });
+    };
 
     V1495(V1495&& device): Device(std::move(device)) {};
 
@@ -20,11 +22,25 @@ class V1495: public Device {
     const char* kind() const { return "V1495"; };
 
     uint32_t readout(uint32_t* buffer, unsigned size = buffer_size) const {
-      return mblt_read(0, buffer, size);
+      uint32_t nwords;
+      CAENComm_ErrorCode status = try_readout(buffer, nwords, size);
+      if (status != CAENComm_Success) throw Error(status);
+      return nwords;
+    };
+
+    // Non-throwing version of `readout`, see Device::try_mblt_read. Readouts
+    // are accounted in the board metrics (see metrics.hpp); the data format
+    // is defined by the user firmware, so events are not counted.
+    CAENComm_ErrorCode try_readout(
+        uint32_t* buffer, uint32_t& nwords, unsigned size = buffer_size
+    ) const noexcept {
+      CAENComm_ErrorCode status = try_mblt_read(0, buffer, size, nwords);
+      if (metrics::enabled()) account_readout(size, nwords, status);
+      return status;
     };
 
     uint32_t rom_checksum() const {
-      return read32(0x8100);
+      return rom(0x8100);
     };
 
     // guessed
@@ -38,11 +54,11 @@ class V1495: public Device {
     };
 
     uint32_t rom_c_code() const {
-      return read32(0x811C);
+      return rom(0x811C);
     };
 
     uint32_t rom_r_code() const {
-      return read32(0x8120);
+      return rom(0x8120);
     };
 
     // Manufacturer identifier --- should be 0x40E6
@@ -51,7 +67,7 @@ class V1495: public Device {
     };
 
     uint32_t version() const {
-      return read32(0x8130);
+      return rom(0x8130);
     };
 
     // Board ID: 0x05D7 (1495)
@@ -73,6 +89,7 @@ class V1495: public Device {
 
     void reset() {
       write16(0x800C, 1);
+      invalidate_cache();
     };
 
     uint16_t firmware_revision() const {
@@ -97,6 +114,7 @@ class V1495: public Device {
 
     void reload() {
       write16(0x8016, 1);
+      invalidate_cache();
     };
 
   private:
@@ -14,10 +14,103 @@ uint16_t V6534::read_channel(uint8_t channel, uint8_t offset) const {
   return read16(0x80 * channel + offset);
 };
 
+// Channel settings registers in the order of V6534::ChannelSettings fields
+static const uint8_t settings_offsets[] = {
+  0x80, 0x84, 0x98, 0x9c, 0xa0, 0xa4, 0xa8, 0xb4, 0x90
+};
+
+static const unsigned nsettings
+  = sizeof(settings_offsets) / sizeof(*settings_offsets);
+
+// Channel monitoring registers in the order of V6534::ChannelMonitor fields
+static const uint8_t monitor_offsets[] = { 0x88, 0x8c, 0xb8, 0x94, 0xb0 };
+
+static const unsigned nmonitor
+  = sizeof(monitor_offsets) / sizeof(*monitor_offsets);
+
+V6534::ChannelSettings V6534::channel_settings(uint8_t channel) const {
+  if (channel > 5) throw Error("bad channel: " + std::to_string(channel));
+
+  std::array<Cycle, nsettings> cycles;
+  for (unsigned i = 0; i < nsettings; ++i)
+    cycles[i] = Cycle(0x80 * channel + settings_offsets[i]);
+  batch_read(cycles);
+
+  ChannelSettings result;
+  result.vset       = cycles[0].data;
+  result.iset       = cycles[1].data;
+  result.trip_time  = cycles[2].data;
+  result.svmax      = cycles[3].data;
+  result.ramp_down  = cycles[4].data;
+  result.ramp_up    = cycles[5].data;
+  result.pwdown     = static_cast<PowerDownMode>(cycles[6].data);
+  result.imon_range = static_cast<IMonRange>(cycles[7].data);
+  result.power      = cycles[8].data;
+  return result;
+};
+
+void V6534::set_channel_settings(
+    uint8_t channel, const ChannelSettings& settings
+) {
+  if (channel > 5) throw Error("bad channel: " + std::to_string(channel));
+
+  const uint16_t values[nsettings] = {
+    std::min<uint16_t>(settings.vset,      60000),
+    std::min<uint16_t>(settings.iset,      52500),
+    std::min<uint16_t>(settings.trip_time, 10000),
+    std::min<uint16_t>(settings.svmax,     60000),
+    std::min<uint16_t>(settings.ramp_down, 500),
+    std::min<uint16_t>(settings.ramp_up,   500),
+    static_cast<uint16_t>(settings.pwdown),
+    static_cast<uint16_t>(settings.imon_range),
+    settings.power
+  };
+
+  std::array<Cycle, nsettings> cycles;
+  for (unsigned i = 0; i < nsettings; ++i)
+    cycles[i] = Cycle(0x80 * channel + settings_offsets[i], 16, values[i]);
+  batch_write(cycles);
+};
+
+static V6534::ChannelMonitor channel_monitor(const Device::Cycle* cycles) {
+  V6534::ChannelMonitor result;
+  result.vmon        = cycles[0].data;
+  result.imonH       = cycles[1].data;
+  result.imonL       = cycles[2].data;
+  result.status      = cycles[3].data;
+  result.temperature = cycles[4].data;
+  return result;
+};
+
+V6534::ChannelMonitor V6534::monitor(uint8_t channel) const {
+  if (channel > 5) throw Error("bad channel: " + std::to_string(channel));
+
+  std::array<Cycle, nmonitor> cycles;
+  for (unsigned i = 0; i < nmonitor; ++i)
+    cycles[i] = Cycle(0x80 * channel + monitor_offsets[i]);
+  batch_read(cycles);
+
+  return channel_monitor(cycles.data());
+};
+
+std::array<V6534::ChannelMonitor, 6> V6534::monitor() const {
+  std::array<Cycle, 6 * nmonitor> cycles;
+  for (uint8_t channel = 0; channel < 6; ++channel)
+    for (unsigned i = 0; i < nmonitor; ++i)
+      cycles[channel * nmonitor + i]
+        = Cycle(0x80 * channel + monitor_offsets[i]);
+  batch_read(cycles);
+
+  std::array<ChannelMonitor, 6> result;
+  for (uint8_t channel = 0; channel < 6; ++channel)
+    result[channel] = channel_monitor(cycles.data() + channel * nmonitor);
+  return result;
+};
+
 std::string V6534::read_string(uint16_t address, uint16_t size) const {
   std::string string(size, 0);
   for (uint16_t i = 0; i < size;) {
-    uint16_t x = read16(address);
+    uint16_t x = rom(address);
     address += 2;
     string[i++] = x & 0xff;
     string[i++] = x >> 8;
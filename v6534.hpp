@@ -22,7 +22,39 @@ class V6534: public Device {
         std::string message;
     };
 
-    V6534(const Connection& connection): Device(connection) {};
+    // Current monitor range control
+    enum class IMonRange { high = 0, low = 1 };
+
+    // Power down mode
+    enum class PowerDownMode { kill = 0, ramp = 1 };
+
+    // Channel settings, raw register values. See the per-register accessors
+    // below for the units.
+    struct ChannelSettings {
+      uint16_t      vset;
+      uint16_t      iset;
+      uint16_t      trip_time;
+      uint16_t      svmax;
+      uint16_t      ramp_down;
+      uint16_t      ramp_up;
+      PowerDownMode pwdown;
+      IMonRange     imon_range;
+      bool          power;
+    };
+
+    // Channel monitoring values, raw register values. See the per-register
+    // accessors below for the units.
+    struct ChannelMonitor {
+      uint16_t vmon;
+      uint16_t imonH;
+      uint16_t imonL;
+      uint16_t status;
+      int16_t  temperature;
+    };
+
+    V6534(const Connection& connection): Device(connection) {
+      load_rom({ { 0x8100, 17, 2 } });
+    };
     
     V6534(V6534&& device): Device(std::move(device)) {};
 
@@ -104,8 +136,6 @@ class V6534: public Device {
       return vmon(channel) * 0.1;
     };
 
-    // Current monitor range control
-    enum class IMonRange { high = 0, low = 1 };
     IMonRange imon_range(uint8_t channel) const {
       return static_cast<IMonRange>(read_channel(channel, 0xb4));
     };
@@ -209,8 +239,6 @@ class V6534: public Device {
       write_channel(channel, 0xa4, std::min<uint16_t>(value, 500));
     };
 
-    // Power down mode
-    enum class PowerDownMode { kill = 0, ramp = 1 };
     PowerDownMode pwdown(uint8_t channel) const {
       return static_cast<PowerDownMode>(read_channel(channel, 0xa8));
     };
@@ -228,6 +256,16 @@ class V6534: public Device {
       return read_channel(channel, 0xb0);
     };
 
+    // Read or write all the settings of a channel in a single batched
+    // transaction
+    ChannelSettings channel_settings(uint8_t channel) const;
+    void set_channel_settings(uint8_t channel, const ChannelSettings&);
+
+    // Read the monitoring values of a channel or of all channels in a single
+    // batched transaction
+    ChannelMonitor monitor(uint8_t channel) const;
+    std::array<ChannelMonitor, 6> monitor() const;
+
     // Board description
     // For V6534 it is "6 Ch 6KV/1mA"
     std::string description() const {
@@ -239,16 +277,16 @@ class V6534: public Device {
     };
 
     uint16_t serial_number() const {
-      return read16(0x811e);
+      return rom(0x811e);
     };
 
     uint16_t vme_fwrel() const {
-      return read16(0x8120);
+      return rom(0x8120);
     };
 
     // Number of channels
     uint16_t chnum() const {
-      return read16(0x8100);
+      return rom(0x8100);
     };
 
     uint16_t nchannels() const { return 6; };
@@ -1,12 +1,17 @@
+#include <algorithm>
 #include <cmath>
+#include <iterator>
 
 #include <CAENVMElib.h>
 
+#include "profile.hpp"
+#include "simd.hpp"
 #include "v792.hpp"
 
 namespace caen {
 
 V792::V792(const Connection& connection): Device(connection) {
+  load_rom({ { 0x8026, 11 }, { 0x8F02, 2 } });
   // Known versions: 0x11 (V792AA), 0x13 (V792AC), 0xE1 (V792NA), 0xE3 (V792NC)
   init(connection, version() & 0xF0 == 0xE0 ? V792N : V792A);
 };
@@ -15,6 +20,13 @@ void V792::init(const Connection& connection, Version version) {
   channel_step_ = version == V792A ? 2 : 4;
   vme_handle_   = vme_handle();
   vme_address_  = connection.address;
+
+  // Configuration registers eligible for the shadow cache
+  for (uint32_t address: {
+      0x100A, 0x100C, 0x1010, 0x1020, 0x102E, 0x103C, 0x1060, 0x106A
+  })
+    cache_.set_cacheable(address);
+  cache_.set_cacheable(0x1080, nchannels(), channel_step_);
 };
 
 bool V792::check() const {
@@ -46,20 +58,109 @@ void V792::test_event_write(TestEvent events[32]) {
   test_event_write(reinterpret_cast<uint16_t*>(events));
 };
 
+void V792::channel_settings_cycles(std::array<Cycle, 32>& cycles) const {
+  for (uint8_t i = 0; i < nchannels(); ++i)
+    cycles[i] = Cycle(0x1080 + i * channel_step_);
+};
+
+std::array<uint8_t, 32> V792::thresholds() const {
+  std::array<Cycle, 32> cycles;
+  channel_settings_cycles(cycles);
+  batch_read(cycles.data(), nchannels());
+
+  std::array<uint8_t, 32> result {};
+  for (uint8_t i = 0; i < nchannels(); ++i)
+    result[i] = ChannelSettings(cycles[i].data).threshold();
+  return result;
+};
+
+void V792::set_thresholds(const std::array<uint8_t, 32>& thresholds) {
+  std::array<Cycle, 32> cycles;
+  channel_settings_cycles(cycles);
+  batch_read(cycles.data(), nchannels());
+
+  std::array<ChannelSettings, 32> settings;
+  for (uint8_t i = 0; i < nchannels(); ++i) {
+    settings[i] = cycles[i].data;
+    settings[i].set_threshold(thresholds[i]);
+  };
+  write_channel_settings(cycles, settings);
+};
+
+uint32_t V792::enabled_channels() const {
+  std::array<Cycle, 32> cycles;
+  channel_settings_cycles(cycles);
+  batch_read(cycles.data(), nchannels());
+
+  uint32_t mask = 0;
+  for (uint8_t i = 0; i < nchannels(); ++i)
+    if (!ChannelSettings(cycles[i].data).disabled()) mask |= 1U << i;
+  return mask;
+};
+
+void V792::set_enabled_channels(uint32_t mask) {
+  std::array<Cycle, 32> cycles;
+  channel_settings_cycles(cycles);
+  batch_read(cycles.data(), nchannels());
+
+  std::array<ChannelSettings, 32> settings;
+  for (uint8_t i = 0; i < nchannels(); ++i) {
+    settings[i] = cycles[i].data;
+    settings[i].set_disabled(!(mask >> i & 1));
+  };
+  write_channel_settings(cycles, settings);
+};
+
+std::array<V792::ChannelSettings, 32> V792::channel_settings_all() const {
+  std::array<Cycle, 32> cycles;
+  channel_settings_cycles(cycles);
+  batch_read(cycles.data(), nchannels());
+
+  std::array<ChannelSettings, 32> result;
+  for (uint8_t i = 0; i < nchannels(); ++i) result[i] = cycles[i].data;
+  return result;
+};
+
+void V792::set_channel_settings_all(
+    const std::array<ChannelSettings, 32>& settings
+) {
+  std::array<Cycle, 32> cycles;
+  channel_settings_cycles(cycles);
+  batch_read(cycles.data(), nchannels());
+  write_channel_settings(cycles, settings);
+};
+
+void V792::write_channel_settings(
+    std::array<Cycle, 32>& cycles,
+    const std::array<ChannelSettings, 32>& settings
+) {
+  // Pack the cycles of the channels to change at the front
+  unsigned n = 0;
+  for (uint8_t i = 0; i < nchannels(); ++i)
+    if (settings[i].value_ != cycles[i].data) {
+      cycles[n] = cycles[i];
+      cycles[n++].data = settings[i].value_;
+    };
+  if (n) batch_write(cycles.data(), n);
+};
+
 // This is a workaround for the packet duplication problem. CAENComm_BLTRead
 // calls CAENVME_FIFO_BLTReadCycle under the hood with the cvA32_U_BLT as the
 // address modifier. We change the modifier, but the board stops asserting the
 // bus error when there is no more data to transfer
 uint32_t V792::readout_wa(uint32_t* buffer, uint32_t size) {
   int result;
-  CVErrorCodes status = CAENVME_FIFOBLTReadCycle(
-      vme_handle_,
-      vme_address_,
-      buffer,
-      size * sizeof(uint32_t),
-      cvA32_U_DATA,
-      cvD32,
-      &result
+  CVErrorCodes status = CAEN_PROFILE(
+      "CAENVME_FIFOBLTReadCycle",
+      transport_->FIFOBLTReadCycle(
+          vme_handle_,
+          vme_address_,
+          buffer,
+          size * sizeof(uint32_t),
+          cvA32_U_DATA,
+          cvD32,
+          &result
+      )
   );
 
   if (status != cvSuccess && status != cvBusError) {
@@ -96,4 +197,277 @@ uint32_t V792::readout_wa(uint32_t* buffer, uint32_t size) {
   return result / 4;
 };
 
+CAENComm_ErrorCode V792::try_readout(
+    uint32_t* buffer, uint32_t size, uint32_t& nwords
+) noexcept {
+  CAENComm_ErrorCode status = try_mblt_read(0, buffer, size, nwords);
+  if (metrics::enabled())
+    account_readout(
+        size, nwords, status,
+        status == CAENComm_Success ? count_events(buffer, nwords) : 0
+    );
+  return status;
+};
+
+uint32_t V792::readout_events(
+    uint32_t* buffer, uint32_t size, std::vector<Event>& events
+) {
+  // The words of the event cut by the previous transfer come first
+  uint32_t npartial = partial_.size();
+  if (npartial > size) return 0;
+  std::copy(partial_.begin(), partial_.end(), buffer);
+  partial_.clear();
+
+  // Events stored: the ones counted since the last event read. The board
+  // memory holds 32 events.
+  const uint32_t max_event = 2 + nchannels();
+  uint32_t nstored = 32;
+  if (tracking_)
+    nstored = std::min<uint32_t>(
+        (event_counter() - next_event_) & 0xFFFFFF, 32
+    );
+
+  // MBLT moves 64-bit words; CAENComm block sizes are in bytes
+  uint32_t nrequest = std::min(nstored * max_event, size - npartial) & ~1U;
+  uint32_t nread = 0;
+  CAENComm_ErrorCode status = CAENComm_Success;
+  if (nrequest)
+    status = try_mblt_read(
+        0, buffer + npartial, nrequest * sizeof(uint32_t), nread
+    );
+  if (status != CAENComm_Success) {
+    if (metrics::enabled())
+      account_readout(nrequest * sizeof(uint32_t), nread, status);
+    std::copy(buffer, buffer + npartial, std::back_inserter(partial_));
+    throw Error(status);
+  };
+  uint32_t nwords = nread;
+  strip_invalid(buffer + npartial, nwords);
+  nwords += npartial;
+
+  // Event boundaries. Words out of a header and end of block pair are left
+  // in place and not reported.
+  uint32_t end = 0;
+  uint32_t nevents = 0;
+  uint32_t header = nwords;
+  for (uint32_t i = 0; i < nwords; ++i) {
+    switch (buffer[i] >> 24 & 0x7) {
+      case Packet::Type::Header:
+        header = i;
+        break;
+      case Packet::Type::EndOfBlock:
+        if (header == nwords) break;
+        events.push_back({ header, uint16_t(i + 1 - header) });
+        next_event_ = EndOfBlock(buffer[i]).event() + 1;
+        tracking_   = true;
+        header = nwords;
+        end = i + 1;
+        ++nevents;
+        break;
+    };
+  };
+  if (header < nwords && nwords - header <= max_event)
+    partial_.assign(buffer + header, buffer + nwords);
+
+  if (metrics::enabled() && nrequest)
+    account_readout(nrequest * sizeof(uint32_t), nread, status, nevents);
+  return end;
+};
+
+void V792::Decoded::clear() {
+  channels.clear();
+  geo.clear();
+  crate.clear();
+  count.clear();
+  event.clear();
+};
+
+// Channel field of the data packets
+template <V792::Version version> struct ChannelField {
+  static const unsigned shift = version == V792::V792A ? 16 : 17;
+  static const uint32_t mask  = version == V792::V792A ? 0x1F : 0xF;
+};
+
+template <V792::Version version>
+static void decode_word(uint32_t word, V792::Decoded& decoded) {
+  switch (word >> 24 & 0x7) {
+    case V792::Packet::Type::Header: {
+      V792::Header header(word);
+      decoded.channels.emplace_back();
+      decoded.channels.back().fill(V792::Decoded::empty);
+      decoded.geo.push_back(header.geo());
+      decoded.crate.push_back(header.crate());
+      decoded.count.push_back(header.count());
+      decoded.event.push_back(0);
+      break;
+    };
+    case V792::Packet::Type::Data:
+      if (decoded.size()) {
+        unsigned channel = word >> ChannelField<version>::shift
+                         & ChannelField<version>::mask;
+        decoded.channels.back()[channel] = word & 0x3FFF;
+      };
+      break;
+    case V792::Packet::Type::EndOfBlock:
+      if (decoded.size())
+        decoded.event.back() = V792::EndOfBlock(word).event();
+      break;
+  };
+};
+
+template <V792::Version version>
+void V792::decode_scalar(
+    const uint32_t* data, size_t nwords, Decoded& decoded
+) {
+  for (size_t i = 0; i < nwords; ++i) decode_word<version>(data[i], decoded);
+};
+
+template <V792::Version version>
+void V792::decode(const uint32_t* data, size_t nwords, Decoded& decoded) {
+  using namespace simd;
+
+  // Words before the first header belong to the last event of the previous
+  // call; data before any header is dropped
+  size_t i = 0;
+  for (; i < nwords; ++i) {
+    if ((data[i] >> 24 & 0x7) == Packet::Type::Header) break;
+    decode_word<version>(data[i], decoded);
+  };
+
+  // The events are decoded in batches, in a table of 32-bit entries that
+  // stays in the cache: a row per event of the channels, the event number,
+  // the header and a slot for the other packets. Each word is stored in
+  // the row of its event, counting the headers up to it, at the slot of
+  // its type plus its channel for the data, keeping the bits of the type.
+  static const size_t batch = 128;
+  static const size_t stride = 36;
+  static const uint32_t event_slot  = 32;
+  static const uint32_t header_slot = 33;
+  static const uint32_t other_slot  = 34;
+  alignas(32) static const uint32_t slots[8] = {
+    0, other_slot, header_slot, other_slot,
+    event_slot, other_slot, other_slot, other_slot
+  };
+  alignas(32) static const uint32_t channel_bits[8] = {
+    ChannelField<version>::mask, 0, 0, 0, 0, 0, 0, 0
+  };
+  alignas(32) static const uint32_t value_bits[8] = {
+    0x3FFF, 0, ~0u, 0, 0xFFFFFF, 0, 0, 0
+  };
+
+  // The rows are emptied as the events are appended. A batch ends once
+  // `batch` events are started, but a vector may start `width` more.
+  uint32_t rows[(batch + width) * stride];
+
+  const Vector type   = broadcast(0x7);
+  const Vector header = broadcast(Packet::Type::Header);
+  const Vector row_size = broadcast(stride);
+  const Vector empty = broadcast(Decoded::empty);
+
+  for (size_t r = 0; r < batch + width; ++r) {
+    uint32_t* row = rows + r * stride;
+    for (unsigned c = 0; c < 32; c += width) store(row + c, empty);
+    row[event_slot] = 0;
+  };
+
+  // Rows of the events started in the batch, the last one still open
+  size_t started = 0;
+  while (i < nwords) {
+    for (; started <= batch && i + width <= nwords; i += width) {
+      Vector words = load(data + i);
+      Vector types = bit_and(shift_right<24>(words), type);
+      Mask headers = equal(types, header);
+      Vector row = add(broadcast(started - 1), prefix_count(headers));
+      started += count(headers);
+      Vector slot = add(
+          lookup(slots, types),
+          bit_and(
+              shift_right<ChannelField<version>::shift>(words),
+              lookup(channel_bits, types)
+          )
+      );
+      scatter(
+          rows, add(multiply(row, row_size), slot),
+          bit_and(words, lookup(value_bits, types))
+      );
+    };
+    for (; started <= batch && i < nwords; ++i) {
+      uint32_t word = data[i];
+      uint32_t t = word >> 24 & 0x7;
+      started += t == Packet::Type::Header;
+      rows[(started - 1) * stride + slots[t]
+           + (word >> ChannelField<version>::shift & channel_bits[t])] =
+          word & value_bits[t];
+    };
+
+    // Append the events, but the open one unless the data ends
+    size_t m = i < nwords ? started - 1 : started;
+    size_t e0 = decoded.size();
+    decoded.channels.resize(e0 + m);
+    decoded.geo.resize(e0 + m);
+    decoded.crate.resize(e0 + m);
+    decoded.count.resize(e0 + m);
+    decoded.event.resize(e0 + m);
+    // Through pointers: the byte stores would reload the vectors' data
+    std::array<uint16_t, 32>* channels = decoded.channels.data() + e0;
+    uint8_t*  geos   = decoded.geo.data() + e0;
+    uint8_t*  crates = decoded.crate.data() + e0;
+    uint8_t*  counts = decoded.count.data() + e0;
+    uint32_t* events = decoded.event.data() + e0;
+    for (size_t j = 0; j < m; ++j) {
+      uint32_t* row = rows + j * stride;
+      for (unsigned c = 0; c < 32; c += width) {
+        store_halves(channels[j].data() + c, load(row + c));
+        store(row + c, empty);
+      };
+      Header h(row[header_slot]);
+      geos[j]   = h.geo();
+      crates[j] = h.crate();
+      counts[j] = h.count();
+      events[j] = row[event_slot];
+      row[event_slot] = 0;
+    };
+
+    if (i < nwords) {
+      uint32_t* open = rows + m * stride;
+      std::copy(open, open + stride, rows);
+      for (unsigned c = 0; c < 32; c += width) store(open + c, empty);
+      open[event_slot] = 0;
+      started = 1;
+    };
+  };
+};
+
+template void V792::decode<V792::V792A>(
+    const uint32_t*, size_t, Decoded&
+);
+template void V792::decode<V792::V792N>(
+    const uint32_t*, size_t, Decoded&
+);
+template void V792::decode_scalar<V792::V792A>(
+    const uint32_t*, size_t, Decoded&
+);
+template void V792::decode_scalar<V792::V792N>(
+    const uint32_t*, size_t, Decoded&
+);
+
+uint32_t V792::strip_invalid(
+    uint32_t* data, uint32_t& nwords
+) const noexcept {
+  uint32_t n = simd::remove_matching(
+      data, nwords, 0x07000000, Packet::Type::Invalid << 24
+  );
+  uint32_t result = nwords - n;
+  nwords = n;
+  if (result && metrics::enabled()) account_stripped(result);
+  return result;
+};
+
+uint32_t V792::count_events(const uint32_t* data, uint32_t nwords) {
+  uint32_t result = 0;
+  for (uint32_t i = 0; i < nwords; ++i)
+    result += (data[i] >> 24 & 0x7) == Packet::Type::EndOfBlock;
+  return result;
+};
+
 };
@@ -105,7 +105,7 @@ class V792: public Device {
 
     class ChannelSettings: public BitField<16> {
       public:
-        ChannelSettings(uint16_t value): BitField<16>(value) {};
+        ChannelSettings(uint16_t value = 0): BitField<16>(value) {};
 
         uint8_t threshold() const { return bits(0, 7); };
         void    set_threshold(uint8_t value) { set_bits(0, 7, value); };
@@ -275,6 +275,53 @@ class V792: public Device {
         };
     };
 
+    // Data decoded into dense per-event arrays: a row of 32 channels per
+    // event (the V792N fills the first 16) and side tables of the headers
+    // and end of block packets.
+    struct Decoded {
+      // Channel entry: bits 0-11 the value, bit 12 overflow, bit 13
+      // underflow, as in Data. Channels without data in the event (see the
+      // thresholds and suppressions) are `empty`.
+      static constexpr uint16_t empty = 0x8000;
+
+      std::vector<std::array<uint16_t, 32>> channels;
+      std::vector<uint8_t>  geo;
+      std::vector<uint8_t>  crate;
+      std::vector<uint8_t>  count; // of the data packets, from the header
+      std::vector<uint32_t> event; // from the end of block, 0 if none
+
+      size_t size() const { return channels.size(); };
+      void clear();
+    };
+
+    // Decode `nwords` words of data of a board of the given version,
+    // appending an event to `decoded` for each header. Events may span
+    // several calls. The words are classified and scattered to the rows of
+    // their events several at a time with the SIMD instructions of the
+    // target; `decode_scalar` is the reference implementation word by word.
+    template <Version version>
+    static void decode(const uint32_t* data, size_t nwords, Decoded& decoded);
+
+    template <Version version>
+    static void decode_scalar(
+        const uint32_t* data, size_t nwords, Decoded& decoded
+    );
+
+    // Dispatch on the version at run time
+    static void decode(
+        Version version, const uint32_t* data, size_t nwords, Decoded& decoded
+    ) {
+      if (version == V792N)
+        decode<V792N>(data, nwords, decoded);
+      else
+        decode<V792A>(data, nwords, decoded);
+    };
+
+    static void decode(
+        Version version, const Buffer& buffer, Decoded& decoded
+    ) {
+      decode(version, buffer.raw(), buffer.size(), decoded);
+    };
 
     V792(const Connection&);
     // Use this constructor to override the board version
@@ -285,7 +332,10 @@ class V792: public Device {
       Device(std::move(device)),
       vme_handle_(device.vme_handle_),
       vme_address_(device.vme_address_),
-      channel_step_(device.channel_step_)
+      channel_step_(device.channel_step_),
+      next_event_(device.next_event_),
+      tracking_(device.tracking_),
+      partial_(std::move(device.partial_))
     {};
 
     V792& operator=(V792&& device) {
@@ -293,6 +343,9 @@ class V792: public Device {
       vme_handle_  = device.vme_handle_;
       vme_address_  = device.vme_address_;
       channel_step_ = device.channel_step_;
+      next_event_   = device.next_event_;
+      tracking_     = device.tracking_;
+      partial_      = std::move(device.partial_);
       return *this;
     };
 
@@ -346,6 +399,7 @@ class V792: public Device {
     void reset() {
       write16(0x1006, 0x80);
       write16(0x1008, 0x80);
+      invalidate_cache();
     };
 
     uint8_t interrupt_level() const {
@@ -500,6 +554,8 @@ class V792: public Device {
     void clear() {
       write16(0x1032, 4);
       write16(0x1034, 4);
+      invalidate_cache();
+      forget_events();
     };
 
     void test_memory_write(uint16_t address, uint32_t word);
@@ -517,6 +573,7 @@ class V792: public Device {
 
     void reset_event_counter() {
       write16(0x1040, 1);
+      forget_events();
     };
 
     // XXX: pedestal step is not defined
@@ -589,13 +646,37 @@ class V792: public Device {
       set_channel_settings(channel, s);
     };
 
+    // Number of channels: 32 for V792A, 16 for V792N
+    uint8_t nchannels() const {
+      return 64 / channel_step_;
+    };
+
+    // Bulk versions of the per-channel accessors above. Each call reads
+    // and/or writes the settings of all channels in a single batched
+    // transaction.
+    std::array<uint8_t, 32> thresholds() const;
+    void set_thresholds(const std::array<uint8_t, 32>& thresholds);
+
+    // Bit mask of enabled channels
+    uint32_t enabled_channels() const;
+    void set_enabled_channels(uint32_t mask);
+
+    // Settings of all channels (the first `nchannels`). The setter reads the
+    // current settings, from the register cache when it is enabled (see
+    // Device::set_cache_enabled), and writes only the channels that differ,
+    // in a single batched transaction. The bulk setters above do the same.
+    std::array<ChannelSettings, 32> channel_settings_all() const;
+    void set_channel_settings_all(
+        const std::array<ChannelSettings, 32>& settings
+    );
+
     // Manufacturer identifier (OUI) --- should be 0x40E6
     uint32_t oui() const {
       return read(0x8026, 3, 4);
     };
 
     uint8_t version() const {
-      return read16(0x8032);
+      return rom(0x8032);
     };
 
     // Board ID: 792
@@ -604,7 +685,7 @@ class V792: public Device {
     };
 
     uint16_t revision() const {
-      return read16(0x804E);
+      return rom(0x804E);
     };
 
     uint16_t serial() const {
@@ -612,7 +693,10 @@ class V792: public Device {
     };
 
     uint32_t readout(uint32_t* buffer, uint32_t size) {
-      return mblt_read(0, buffer, size);
+      uint32_t nwords;
+      CAENComm_ErrorCode status = try_readout(buffer, size, nwords);
+      if (status != CAENComm_Success) throw Error(status);
+      return nwords;
     };
 
     uint32_t readout(Packet* buffer, uint32_t size) {
@@ -623,6 +707,66 @@ class V792: public Device {
       buffer.resize(readout(buffer.raw(), buffer.max_size()));
     };
 
+    // Non-throwing version of `readout`, see Device::try_mblt_read. The buffer
+    // is left empty on failure.
+    CAENComm_ErrorCode try_readout(Buffer& buffer) noexcept {
+      uint32_t nwords = 0;
+      CAENComm_ErrorCode status = try_readout(
+          buffer.raw(), buffer.max_size(), nwords
+      );
+      buffer.resize(status == CAENComm_Success ? nwords : 0);
+      return status;
+    };
+
+    // Non-throwing version of `readout` into a raw buffer. Readouts are
+    // accounted in the board metrics, see metrics.hpp.
+    CAENComm_ErrorCode try_readout(
+        uint32_t* buffer, uint32_t size, uint32_t& nwords
+    ) noexcept;
+
+    // Event found in the data read out by `readout_events`
+    struct Event {
+      uint32_t offset; // of the header, in words
+      uint16_t nwords; // from the header to the end of block, inclusive
+    };
+
+    // Multi-event readout: reads as many of the events stored in the board
+    // (up to 32) as fit into `size` words with a single block transfer. The
+    // transfer is sized from the event counter and the number of the last
+    // event read, so that a transfer asks for no more than the words the
+    // stored events can hold. The board must send all the events in a
+    // transfer, that is, `block_readout` must be disabled; with the bus error
+    // disabled the invalid packets padding the data are stripped.
+    //
+    // The events read entirely are appended to `events`; an event cut by the
+    // end of the transfer is kept and completed by the next call. Returns the
+    // number of words up to the end of the last event appended. The counter
+    // must count accepted triggers only (`all_triggers` disabled) for the
+    // sizing to be tight; `clear` and `reset_event_counter` restart it.
+    uint32_t readout_events(
+        uint32_t* buffer, uint32_t size, std::vector<Event>& events
+    );
+
+    // Buffer holds the 32 events of the board memory
+    void readout_events(Buffer& buffer, std::vector<Event>& events) {
+      buffer.resize(readout_events(buffer.raw(), buffer.max_size(), events));
+    };
+
+    // Number of events (end of block packets) in `nwords` words of data
+    static uint32_t count_events(const uint32_t* data, uint32_t nwords);
+
+    // Remove the invalid packets padding the data read out with the bus
+    // error disabled in place, several words at a time. Returns the number of
+    // words removed, which are accounted in the board metrics.
+    uint32_t strip_invalid(uint32_t* data, uint32_t& nwords) const noexcept;
+
+    uint32_t strip_invalid(Buffer& buffer) const noexcept {
+      uint32_t nwords = buffer.size();
+      uint32_t result = strip_invalid(buffer.raw(), nwords);
+      buffer.resize(nwords);
+      return result;
+    };
+
     // My board V792AA (board revision 4, firmware revision 0x501) duplicates
     // packets and corrupts the event structure with `readout`. If yours does
     // so too, consider using this function. Unfortunately, the board does not
@@ -650,8 +794,28 @@ class V792: public Device {
     uint32_t vme_address_;
     uint8_t  channel_step_;
 
+    // State of `readout_events`: the number of the next event expected
+    // (valid once an event has been read) and the words of a cut event
+    uint32_t next_event_ = 0;
+    bool     tracking_   = false;
+    std::vector<uint32_t> partial_;
+
+    void forget_events() {
+      tracking_ = false;
+      partial_.clear();
+    };
+
     void init(const Connection&, Version);
     bool check() const;
+
+    // Fill `cycles` with reads of the channel settings registers
+    void channel_settings_cycles(std::array<Cycle, 32>& cycles) const;
+
+    // Write the `settings` differing from the ones read into `cycles`
+    void write_channel_settings(
+        std::array<Cycle, 32>& cycles,
+        const std::array<ChannelSettings, 32>& settings
+    );
 };
 
 };
@@ -8,15 +8,34 @@ bool V812::check() const {
   return id() == 0x851;
 };
 
+uint8_t V812::threshold_code(float voltage) {
+  if (voltage < -255e-3) return 255;
+  if (voltage > -1e-3)   return 0;
+  return std::round(voltage / -1e-3);
+};
+
 void V812::set_threshold(uint8_t channel, float voltage) {
-  uint8_t value;
-  if (voltage < -255e-3)
-    value = 255;
-  else if (voltage > -1e-3)
-    value = 0;
-  else
-    value = std::round(voltage / -1e-3);
-  write16(channel << 1, value);
+  write16(channel << 1, threshold_code(voltage));
+};
+
+void V812::set_thresholds(const std::array<float, 16>& voltages) {
+  std::array<Cycle, 16> cycles;
+  for (uint8_t i = 0; i < 16; ++i)
+    cycles[i] = Cycle(i << 1, 16, threshold_code(voltages[i]));
+  batch_write(cycles);
+};
+
+void V812::configure(const Configuration& configuration) {
+  std::array<Cycle, 16 + 6> cycles;
+  for (uint8_t i = 0; i < 16; ++i)
+    cycles[i] = Cycle(i << 1, 16, threshold_code(configuration.thresholds[i]));
+  cycles[16] = Cycle(0x40, 16, configuration.output_width[0]);
+  cycles[17] = Cycle(0x42, 16, configuration.output_width[1]);
+  cycles[18] = Cycle(0x44, 16, configuration.dead_time[0]);
+  cycles[19] = Cycle(0x46, 16, configuration.dead_time[1]);
+  cycles[20] = Cycle(0x48, 16, configuration.majority_threshold);
+  cycles[21] = Cycle(0x4A, 16, configuration.enabled_channels);
+  batch_write(cycles);
 };
 
 };
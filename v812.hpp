@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <bitset>
 
 #include "comm.hpp"
@@ -9,7 +10,9 @@ namespace caen {
 class V812: public Device {
   public:
 
-    V812(const Connection& connection): Device(connection) {};
+    V812(const Connection& connection): Device(connection) {
+      load_rom({ { 0xFA, 3, 2 } });
+    };
     V812(V812&& device): Device(std::move(device)) {};
 
     V812& operator=(V812&& device) {
@@ -22,6 +25,22 @@ class V812: public Device {
     // -1 to -255 mV, in volts
     void set_threshold(uint8_t channel, float voltage);
 
+    // Set thresholds of all channels in a single batched transaction
+    void set_thresholds(const std::array<float, 16>& voltages);
+
+    // Complete board configuration. See the functions below for the meaning
+    // of the fields.
+    struct Configuration {
+      std::array<float, 16> thresholds;      // V
+      uint8_t               output_width[2]; // per channels set
+      uint8_t               dead_time[2];    // per channels set
+      uint8_t               majority_threshold;
+      uint16_t              enabled_channels;
+    };
+
+    // Write the whole configuration in a single batched transaction
+    void configure(const Configuration&);
+
     void enable_channels(uint16_t mask) {
       write16(0x4A, mask);
     };
@@ -61,24 +80,27 @@ class V812: public Device {
     };
 
     uint16_t serial() const {
-      return read16(0xFE) & 0xFFF;
+      return rom(0xFE) & 0xFFF;
     };
 
     uint8_t version() const {
-      return read16(0xFE) >> 12;
+      return rom(0xFE) >> 12;
     };
 
     uint16_t id() const {
-      return read16(0xFC);
+      return rom(0xFC);
     };
 
     // 0xFAF5
     uint16_t constant() const {
-      return read16(0xFA);
+      return rom(0xFA);
     };
 
   private:
     bool check() const;
+
+    // Convert threshold voltage to the register value
+    static uint8_t threshold_code(float voltage);
 };
 
 };
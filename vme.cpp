@@ -2,6 +2,7 @@
 
 #include <cstring>
 
+#include "profile.hpp"
 #include "vme.hpp"
 
 namespace caen {
@@ -12,7 +13,21 @@ const char* Bridge::Error::what() const throw() {
 
 #define VME(function, ...) \
   do { \
-    CVErrorCodes status__ = CAENVME_ ## function(__VA_ARGS__); \
+    CVErrorCodes status__ = CAEN_PROFILE( \
+        "CAENVME_" #function, transport_->function(__VA_ARGS__) \
+    ); \
+    if (status__ != cvSuccess) \
+      throw Bridge::Error(status__); \
+  } while (false)
+
+// Bridge functions beyond the data path are not provided by transports and
+// are only available when the bridge is opened with a native transport
+#define BRIDGE(function, ...) \
+  do { \
+    if (!transport_->native()) throw Bridge::Error(cvNotSupported); \
+    CVErrorCodes status__ = CAEN_PROFILE( \
+        "CAENVME_" #function, CAENVME_ ## function(__VA_ARGS__) \
+    ); \
     if (status__ != cvSuccess) \
       throw Bridge::Error(status__); \
   } while (false)
@@ -98,7 +113,9 @@ static CVBoardTypes vmeConnectionType(
 #undef bt
 };
 
-Bridge::Bridge(const Connection& connection) {
+Bridge::Bridge(const Connection& connection):
+  transport_(Transport::current())
+{
   CVBoardTypes type = vmeConnectionType(
       connection.bridge,
       connection.conet,
@@ -115,12 +132,15 @@ Bridge::Bridge(const Connection& connection) {
   VME(Init2, type, arg, connection.node, &handle);
 };
 
-Bridge::Bridge(CVBoardTypes type, const void* arg, short conet): own(true) {
+Bridge::Bridge(CVBoardTypes type, const void* arg, short conet):
+  transport_(Transport::current()), own(true)
+{
   VME(Init2, type, arg, conet, &handle);
 };
 
 Bridge& Bridge::operator=(Bridge&& bridge) {
-  if (own) CAENVME_End(handle);
+  if (own) transport_->End(handle);
+  transport_ = bridge.transport_;
   handle = bridge.handle;
   own    = bridge.own;
   bridge.own = false;
@@ -128,39 +148,52 @@ Bridge& Bridge::operator=(Bridge&& bridge) {
 };
 
 Bridge::~Bridge() {
-  if (own) CAENVME_End(handle);
+  if (own) transport_->End(handle);
 };
 
 std::string Bridge::firmwareRelease() const {
   char s[16];
-  VME(BoardFWRelease, handle, s);
+  BRIDGE(BoardFWRelease, handle, s);
   return s;
 };
 
 std::string Bridge::softwareRelease() {
   char s[16];
-  VME(SWRelease, s);
+  CVErrorCodes status = CAENVME_SWRelease(s);
+  if (status != cvSuccess) throw Error(status);
   return s;
 };
 
 std::string Bridge::driverRelease() const {
   char s[16];
-  VME(DriverRelease, handle, s);
+  BRIDGE(DriverRelease, handle, s);
   return s;
 };
 
 void Bridge::deviceReset() {
-  VME(DeviceReset, handle);
+  BRIDGE(DeviceReset, handle);
 };
 
 unsigned Bridge::readRegister(uint8_t address) const {
   unsigned result;
-  VME(ReadRegister, handle, static_cast<CVRegisters>(address), &result);
+  BRIDGE(ReadRegister, handle, static_cast<CVRegisters>(address), &result);
   return result;
 };
 
 void Bridge::writeRegister(uint8_t address, unsigned value) {
-  VME(WriteRegister, handle, static_cast<CVRegisters>(address), value);
+  BRIDGE(WriteRegister, handle, static_cast<CVRegisters>(address), value);
+};
+
+CVErrorCodes Bridge::tryReadCycle(
+    uint32_t          address,
+    CVAddressModifier modifier,
+    CVDataWidth       width,
+    void*             data
+) const noexcept {
+  return CAEN_PROFILE(
+      "CAENVME_ReadCycle",
+      transport_->ReadCycle(handle, address, data, modifier, width)
+  );
 };
 
 void Bridge::readCycle(
@@ -169,7 +202,8 @@ void Bridge::readCycle(
     CVDataWidth       width,
     void*             data
 ) const {
-  VME(ReadCycle, handle, address, data, modifier, width);
+  CVErrorCodes status = tryReadCycle(address, modifier, width, data);
+  if (status != cvSuccess) throw Error(status);
 };
 
 void Bridge::writeCycle(
@@ -209,6 +243,22 @@ void Bridge::multiWrite(
   VME(MultiWrite, handle, addresses, buffer, ncycles, modifiers, widths, codes);
 };
 
+CVErrorCodes Bridge::tryBLTReadCycle(
+    uint32_t          address,
+    CVAddressModifier modifier,
+    CVDataWidth       width,
+    void*             buffer,
+    int               size,
+    int&              count
+) const noexcept {
+  return CAEN_PROFILE(
+      "CAENVME_BLTReadCycle",
+      transport_->BLTReadCycle(
+          handle, address, buffer, size, modifier, width, &count
+      )
+  );
+};
+
 int Bridge::BLTReadCycle(
     uint32_t          address,
     CVAddressModifier modifier,
@@ -217,7 +267,10 @@ int Bridge::BLTReadCycle(
     int               size
 ) const {
   int count;
-  VME(BLTReadCycle, handle, address, buffer, size, modifier, width, &count);
+  CVErrorCodes status = tryBLTReadCycle(
+      address, modifier, width, buffer, size, count
+  );
+  if (status != cvSuccess) throw Error(status);
   return count;
 };
 
@@ -233,6 +286,21 @@ int Bridge::BLTWriteCycle(
   return count;
 };
 
+CVErrorCodes Bridge::tryMBLTReadCycle(
+    uint32_t          address,
+    CVAddressModifier modifier,
+    void*             buffer,
+    int               size,
+    int&              count
+) const noexcept {
+  return CAEN_PROFILE(
+      "CAENVME_MBLTReadCycle",
+      transport_->MBLTReadCycle(
+          handle, address, buffer, size, modifier, &count
+      )
+  );
+};
+
 int Bridge::MBLTReadCycle(
     uint32_t          address,
     CVAddressModifier modifier,
@@ -240,7 +308,8 @@ int Bridge::MBLTReadCycle(
     int               size
 ) const {
   int count;
-  VME(MBLTReadCycle, handle, address, buffer, size, modifier, &count);
+  CVErrorCodes status = tryMBLTReadCycle(address, modifier, buffer, size, count);
+  if (status != cvSuccess) throw Error(status);
   return count;
 };
 
@@ -255,6 +324,22 @@ int Bridge::MBLTWriteCycle(
   return count;
 };
 
+CVErrorCodes Bridge::tryFIFOBLTReadCycle(
+    uint32_t          address,
+    CVAddressModifier modifier,
+    CVDataWidth       width,
+    void*             buffer,
+    int               size,
+    int&              count
+) const noexcept {
+  return CAEN_PROFILE(
+      "CAENVME_FIFOBLTReadCycle",
+      transport_->FIFOBLTReadCycle(
+          handle, address, buffer, size, modifier, width, &count
+      )
+  );
+};
+
 int Bridge::FIFOBLTReadCycle(
     uint32_t          address,
     CVAddressModifier modifier,
@@ -263,7 +348,10 @@ int Bridge::FIFOBLTReadCycle(
     int               size
 ) const {
   int count;
-  VME(FIFOBLTReadCycle, handle, address, buffer, size, modifier, width, &count);
+  CVErrorCodes status = tryFIFOBLTReadCycle(
+      address, modifier, width, buffer, size, count
+  );
+  if (status != cvSuccess) throw Error(status);
   return count;
 };
 
@@ -279,6 +367,21 @@ int Bridge::FIFOBLTWriteCycle(
   return count;
 };
 
+CVErrorCodes Bridge::tryFIFOMBLTReadCycle(
+    uint32_t          address,
+    CVAddressModifier modifier,
+    void*             buffer,
+    int               size,
+    int&              count
+) const noexcept {
+  return CAEN_PROFILE(
+      "CAENVME_FIFOMBLTReadCycle",
+      transport_->FIFOMBLTReadCycle(
+          handle, address, buffer, size, modifier, &count
+      )
+  );
+};
+
 int Bridge::FIFOMBLTReadCycle(
     uint32_t          address,
     CVAddressModifier modifier,
@@ -286,7 +389,10 @@ int Bridge::FIFOMBLTReadCycle(
     int               size
 ) const {
   int count;
-  VME(FIFOMBLTReadCycle, handle, address, buffer, size, modifier, &count);
+  CVErrorCodes status = tryFIFOMBLTReadCycle(
+      address, modifier, buffer, size, count
+  );
+  if (status != cvSuccess) throw Error(status);
   return count;
 };
 
@@ -302,21 +408,21 @@ int Bridge::FIFOMBLTWriteCycle(
 };
 
 void Bridge::ADOCycle(uint32_t address, CVAddressModifier modifier) {
-  VME(ADOCycle, handle, address, modifier);
+  BRIDGE(ADOCycle, handle, address, modifier);
 };
 
 void Bridge::ADOHCycle(uint32_t address, CVAddressModifier modifier) {
-  VME(ADOHCycle, handle, address, modifier);
+  BRIDGE(ADOHCycle, handle, address, modifier);
 };
 
 #define defparameter_ex(type, getter, setter, vme_getter, vme_setter) \
   type Bridge::getter() const { \
     type value; \
-    VME(vme_getter, handle, &value); \
+    BRIDGE(vme_getter, handle, &value); \
     return value; \
   }; \
   void Bridge::setter(type value) { \
-    VME(vme_setter, handle, value); \
+    BRIDGE(vme_setter, handle, value); \
   }
 
 #define defparameter(type, name, Name) \
@@ -330,16 +436,16 @@ defparameter(CVVMETimeouts,    timeout,       Timeout);
 
 bool Bridge::FIFOMode() const {
   short enabled;
-  VME(GetFIFOMode, handle, &enabled);
+  BRIDGE(GetFIFOMode, handle, &enabled);
   return enabled;
 };
 
 void Bridge::setFIFOMode(bool enabled) {
-  VME(SetFIFOMode, handle, enabled);
+  BRIDGE(SetFIFOMode, handle, enabled);
 };
 
 void Bridge::readDisplay(CVDisplay* display) const {
-  VME(ReadDisplay, handle, display);
+  BRIDGE(ReadDisplay, handle, display);
 };
 
 void Bridge::setLocationMonitor(
@@ -349,11 +455,11 @@ void Bridge::setLocationMonitor(
     short             lword,
     short             iack
 ) {
-  VME(SetLocationMonitor, handle, address, modifier, write, lword, iack);
+  BRIDGE(SetLocationMonitor, handle, address, modifier, write, lword, iack);
 };
 
 void Bridge::reset() {
-  VME(SystemReset, handle);
+  BRIDGE(SystemReset, handle);
 };
 
 void Bridge::BLTReadAsync(
@@ -363,35 +469,35 @@ void Bridge::BLTReadAsync(
     void*             buffer,
     int               size
 ) const {
-  VME(BLTReadAsync, handle, address, buffer, size, modifier, width);
+  BRIDGE(BLTReadAsync, handle, address, buffer, size, modifier, width);
 };
 
 int Bridge::BLTReadWait() const {
   int count;
-  VME(BLTReadWait, handle, &count);
+  BRIDGE(BLTReadWait, handle, &count);
   return count;
 };
 
 void Bridge::IACKCycle(CVIRQLevels level, void* vector, CVDataWidth width) {
-  VME(IACKCycle, handle, level, vector, width);
+  BRIDGE(IACKCycle, handle, level, vector, width);
 };
 
 uint8_t Bridge::IRQCheck() const {
   uint8_t mask;
-  VME(IRQCheck, handle, &mask);
+  BRIDGE(IRQCheck, handle, &mask);
   return mask;
 };
 
 void Bridge::IRQEnable(uint32_t mask) {
-  VME(IRQEnable, handle, mask);
+  BRIDGE(IRQEnable, handle, mask);
 };
 
 void Bridge::IRQDisable(uint32_t mask) {
-  VME(IRQDisable, handle, mask);
+  BRIDGE(IRQDisable, handle, mask);
 };
 
 void Bridge::IRQWait(uint32_t mask, uint32_t timeout) const {
-  VME(IRQWait, handle, mask, timeout);
+  BRIDGE(IRQWait, handle, mask, timeout);
 };
 
 Bridge::PulserConf Bridge::pulserConf(CVPulserSelect pulser) const {
@@ -401,7 +507,7 @@ Bridge::PulserConf Bridge::pulserConf(CVPulserSelect pulser) const {
 };
 
 void Bridge::getPulserConf(CVPulserSelect pulser, PulserConf& conf) const {
-  VME(
+  BRIDGE(
       GetPulserConf,
       handle,
       pulser,
@@ -415,7 +521,7 @@ void Bridge::getPulserConf(CVPulserSelect pulser, PulserConf& conf) const {
 };
 
 void Bridge::setPulserConf(CVPulserSelect pulser, const PulserConf& conf) {
-  VME(
+  BRIDGE(
       SetPulserConf,
       handle,
       pulser,
@@ -429,11 +535,11 @@ void Bridge::setPulserConf(CVPulserSelect pulser, const PulserConf& conf) {
 };
 
 void Bridge::startPulser(CVPulserSelect pulser) {
-  VME(StartPulser, handle, pulser);
+  BRIDGE(StartPulser, handle, pulser);
 };
 
 void Bridge::stopPulser(CVPulserSelect pulser) {
-  VME(StopPulser, handle, pulser);
+  BRIDGE(StopPulser, handle, pulser);
 };
 
 Bridge::ScalerConf Bridge::scalerConf() const {
@@ -443,7 +549,7 @@ Bridge::ScalerConf Bridge::scalerConf() const {
 };
 
 void Bridge::getScalerConf(ScalerConf& conf) const {
-  VME(
+  BRIDGE(
       GetScalerConf,
       handle,
       &conf.limit,
@@ -455,7 +561,7 @@ void Bridge::getScalerConf(ScalerConf& conf) const {
 };
 
 void Bridge::setScalerConf(const ScalerConf& conf) {
-  VME(
+  BRIDGE(
       SetScalerConf,
       handle,
       conf.limit,
@@ -467,15 +573,15 @@ void Bridge::setScalerConf(const ScalerConf& conf) {
 };
 
 void Bridge::resetScalerCount() {
-  VME(ResetScalerCount, handle);
+  BRIDGE(ResetScalerCount, handle);
 };
 
 void Bridge::enableScalerGate() {
-  VME(EnableScalerGate, handle);
+  BRIDGE(EnableScalerGate, handle);
 };
 
 void Bridge::disableScalerGate() {
-  VME(DisableScalerGate, handle);
+  BRIDGE(DisableScalerGate, handle);
 };
 
 #define define_scaler_parameter(type, name) \
@@ -494,31 +600,31 @@ define_scaler_parameter(CVScalerSource, StartSource);
 
 bool Bridge::scalerContinuousRun() const {
   CVContinuosRun value;
-  VME(GetScaler_ContinuousRun, handle, &value);
+  BRIDGE(GetScaler_ContinuousRun, handle, &value);
   return value == cvOn;
 };
 
 void Bridge::setScalerContinuousRun(bool value) {
-  VME(SetScaler_ContinuousRun, handle, value ? cvOn : cvOff);
+  BRIDGE(SetScaler_ContinuousRun, handle, value ? cvOn : cvOff);
 };
 
 define_scaler_parameter(uint16_t, MaxHits);
 define_scaler_parameter(uint16_t, DWellTime);
 
 void Bridge::scalerStop() {
-  VME(SetScaler_SWStop, handle);
+  BRIDGE(SetScaler_SWStop, handle);
 };
 
 void Bridge::scalerReset() {
-  VME(SetScaler_SWReset, handle);
+  BRIDGE(SetScaler_SWReset, handle);
 };
 
 void Bridge::scalerOpenGate() {
-  VME(SetScaler_SWOpenGate, handle);
+  BRIDGE(SetScaler_SWOpenGate, handle);
 };
 
 void Bridge::scalerCloseGate() {
-  VME(SetScaler_SWCloseGate, handle);
+  BRIDGE(SetScaler_SWCloseGate, handle);
 };
 
 Bridge::OutputConf Bridge::outputConf(CVOutputSelect output) const {
@@ -528,7 +634,7 @@ Bridge::OutputConf Bridge::outputConf(CVOutputSelect output) const {
 };
 
 void Bridge::getOutputConf(CVOutputSelect output, OutputConf& conf) const {
-  VME(
+  BRIDGE(
       GetOutputConf,
       handle,
       output,
@@ -539,7 +645,7 @@ void Bridge::getOutputConf(CVOutputSelect output, OutputConf& conf) const {
 };
 
 void Bridge::setOutputConf(CVOutputSelect output, const OutputConf& conf) {
-  VME(
+  BRIDGE(
       SetOutputConf,
       handle,
       output,
@@ -550,15 +656,15 @@ void Bridge::setOutputConf(CVOutputSelect output, const OutputConf& conf) {
 };
 
 void Bridge::setOutputRegister(uint16_t mask) {
-  VME(SetOutputRegister, handle, mask);
+  BRIDGE(SetOutputRegister, handle, mask);
 };
 
 void Bridge::clearOutputRegister(uint16_t mask) {
-  VME(ClearOutputRegister, handle, mask);
+  BRIDGE(ClearOutputRegister, handle, mask);
 };
 
 void Bridge::pulseOutputRegister(uint16_t mask) {
-  VME(PulseOutputRegister, handle, mask);
+  BRIDGE(PulseOutputRegister, handle, mask);
 };
 
 Bridge::InputConf Bridge::inputConf(CVInputSelect input) const {
@@ -568,11 +674,11 @@ Bridge::InputConf Bridge::inputConf(CVInputSelect input) const {
 };
 
 void Bridge::getInputConf(CVInputSelect input, InputConf& conf) const {
-  VME(GetInputConf, handle, input, &conf.polarity, &conf.led_polarity);
+  BRIDGE(GetInputConf, handle, input, &conf.polarity, &conf.led_polarity);
 };
 
 void Bridge::setInputConf(CVInputSelect input, const InputConf& conf) {
-  VME(SetInputConf, handle, input, conf.polarity, conf.led_polarity);
+  BRIDGE(SetInputConf, handle, input, conf.polarity, conf.led_polarity);
 };
 
 };
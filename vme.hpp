@@ -5,6 +5,7 @@
 #include <CAENVMElib.h>
 
 #include "caen.hpp"
+#include "transport.hpp"
 
 namespace caen {
 
@@ -56,9 +57,13 @@ class Bridge {
     Bridge(CVBoardTypes, const void* arg, short conet); 
 
     // in case you already have a handle
-    Bridge(int32_t handle, bool own): handle(handle), own(own) {};
+    Bridge(int32_t handle, bool own):
+      transport_(Transport::current()), handle(handle), own(own)
+    {};
 
-    Bridge(Bridge&& bridge): handle(bridge.handle), own(bridge.own) {
+    Bridge(Bridge&& bridge):
+      transport_(bridge.transport_), handle(bridge.handle), own(bridge.own)
+    {
       bridge.own = false;
     };
 
@@ -68,6 +73,9 @@ class Bridge {
 
     int32_t vme_handle() const { return handle; };
 
+    // The transport the bridge was opened with, see Transport::current
+    Transport* transport() const { return transport_; };
+
     std::string firmwareRelease() const;
     static std::string softwareRelease();
     std::string driverRelease() const;
@@ -176,6 +184,52 @@ class Bridge {
         int               size
     );
 
+    // Non-throwing versions of the read cycles above for the readout hot
+    // path where link errors are expected and must be cheap. Return the status
+    // of the CAENVME call; the number of bytes transferred by block transfers
+    // is stored in `count`. Note that cvBusError is the normal way for a board
+    // to terminate a block transfer when it runs out of data.
+    CVErrorCodes tryReadCycle(
+        uint32_t          address,
+        CVAddressModifier modifier,
+        CVDataWidth       width,
+        void*             data
+    ) const noexcept;
+
+    CVErrorCodes tryBLTReadCycle(
+        uint32_t          address,
+        CVAddressModifier modifier,
+        CVDataWidth       width,
+        void*             buffer,
+        int               size,
+        int&              count
+    ) const noexcept;
+
+    CVErrorCodes tryMBLTReadCycle(
+        uint32_t          address,
+        CVAddressModifier modifier,
+        void*             buffer,
+        int               size,
+        int&              count
+    ) const noexcept;
+
+    CVErrorCodes tryFIFOBLTReadCycle(
+        uint32_t          address,
+        CVAddressModifier modifier,
+        CVDataWidth       width,
+        void*             buffer,
+        int               size,
+        int&              count
+    ) const noexcept;
+
+    CVErrorCodes tryFIFOMBLTReadCycle(
+        uint32_t          address,
+        CVAddressModifier modifier,
+        void*             buffer,
+        int               size,
+        int&              count
+    ) const noexcept;
+
     void ADOCycle(uint32_t address, CVAddressModifier modifier);
     void ADOHCycle(uint32_t address, CVAddressModifier modifier);
 
@@ -280,6 +334,7 @@ class Bridge {
     void setInputConf(CVInputSelect, const InputConf&);
 
   protected:
+    Transport* transport_;
     int32_t handle;
 
   private: